@@ -31,6 +31,7 @@
 #include <sys/un.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <glib/gprintf.h>
 #include <glib-unix.h>
 #include <gtk/gtkx.h>
@@ -72,6 +73,7 @@
 #include "task-process.h"
 #include "misc.h"
 #include "socket.h"
+#include "propcache.h"
 #include "util.h"
 #include "macros.h"
 #include "closures.h"
@@ -347,8 +349,29 @@
  * executed, where specifier `&percnt;n` will be replaced with the nodes to
  * refresh properties for.
  * You'll likely have noted the plural, because whenever a request to refresh a
- * custom property is triggered, donna will queue them for a short while
- * (800ms), so a single process can be executed for multiple nodes.
+ * custom property is triggered, donna will queue them so a single process can
+ * be executed for multiple nodes.
+ *
+ * When no process is running for the property, queued refreshes are sent as
+ * soon as donna is done with the current batch of work (e.g. drawing the
+ * visible rows), so a lone refresh doesn't wait. When processes are running,
+ * refreshes accumulate, and are sent once a process finishes, or after integer
+ * option `batch_latency` milliseconds (default: 100). Integer option
+ * `batch_max` (default: 4096) is the maximum number of nodes sent to a single
+ * process, and integer option `max_running` (default: 2) the maximum number of
+ * processes running at once for the property.
+ *
+ * Statistics about how refreshes were batched can be obtained via command
+ * custom_properties_get_stats()
+ *
+ * For properties of nodes in domain `fs`, boolean option `cache` can be set to
+ * true to have values cached on disk (in file `custom_properties.cache` in the
+ * configuration directory). A cached value is used, without running the
+ * command line, for as long as the file's mtime, size & inode remain the same.
+ * Cached values are ignored when refreshing from command tv_refresh() (in mode
+ * visible or simple), so the command line is run to get the actual values.
+ * The cache is saved on exit (if any value was added), at which point values
+ * for files that no longer exist (or changed) are dropped.
  *
  * The executed process will have its output parsed, where it is expected to
  * find, on every line, the full location of the node, then a pipe sign, then
@@ -368,6 +391,22 @@
  * shoud be in the forms:
  * &lt;FILENAME&gt;&lt;NUL&gt;|&lt;NUL&gt;|&lt;PROPERTY&gt;|&lt;VALUE&gt;&lt;NUL&gt;
  *
+ * Starting a new process for every batch can be costly, e.g. for scripts using
+ * a heavy runtime. Boolean option `persistent` can be set to true to have the
+ * command line started only once, and kept running. Instead of being given on
+ * the command line, the locations are then written to its standard input, each
+ * NUL terminated, with an extra NUL marking the end of a batch. The output must
+ * then always use the `use_nuls` format described above, with an extra NUL
+ * (i.e. an empty record) after all the values for a batch have been written.
+ * (Make sure to flush the output then.) Batches are sent without waiting for
+ * the previous ones to be answered, `max_running` being the maximum number of
+ * batches waiting for answers. Should the process end, it will be started
+ * again when needed.
+ * Note that in some cases (e.g. when a value is needed right away from another
+ * thread) the command line will be started just for one node, and its standard
+ * input closed after the location was written; The process should then simply
+ * exit after answering.
+ *
  * Sometimes, you might want to have one process used to refresh multiple
  * properties. This can be handled by setting boolean option `is_group` to
  * `true`, in which case the name of the category is the name of the group, and
@@ -538,12 +577,11 @@ enum
     TITLE_DOMAIN_CUSTOM
 };
 
-/* custom properties: when this many tasks are waiting for the timeout, we just
- * remove it and set up a PRIORITY_HIGH idle instead. Note that it is possible
- * that one go (i.e. task process) handles more than this many nodes at once.
- * This is not to ensure there isn't more than this many nodes per task really,
- * but that when reached we stop the wait (for the timeout) */
-#define CP_MAX_NODE_WAITING     20
+/* custom properties: defaults for the batching of refreshes, see
+ * cp_schedule() for how they're used */
+#define CP_DEF_BATCH_MAX        4096
+#define CP_DEF_BATCH_LATENCY    100
+#define CP_DEF_MAX_RUNNING      2
 
 struct cpi_task
 {
@@ -558,6 +596,8 @@ struct cp_item {
     DonnaNode *node;
     gchar *location;
     GPtrArray *tasks;  /* cpi_task[] */
+    gboolean has_key;
+    DonnaPropCacheKey key; /* for the cache, if has_key */
 };
 
 struct prop_def
@@ -566,17 +606,36 @@ struct prop_def
     GType type;
 };
 
+struct cp_stats
+{
+    guint nb_batches;   /* nb of processes started */
+    guint64 nb_nodes;   /* total nb of nodes sent to processes */
+    guint max_nodes;    /* max nb of nodes sent to one process */
+    gint64 time;        /* total time (us) spent running processes */
+};
+
 struct property
 {
     DonnaApp *app;
     gchar *cmdline;
     gboolean use_nuls;
     gboolean preload;
-    /* items & source shall both be accessed while under LOCK_PROVIDERS_WRITE
-     * since they could be accessed from different threads at once. (Everything
-     * else is read-only) */
+    gboolean cache;     /* use the values cache */
+    gboolean persistent;/* cmdline runs as a coprocess */
+    guint batch_max;    /* max nb of nodes per process */
+    guint batch_latency;/* max ms a refresh waits to be batched */
+    guint max_running;  /* max nb of processes running at once */
+    /* items(_idx), source, source_is_timeout, nb_running & stats shall all be
+     * accessed while under LOCK_PROVIDERS_WRITE since they could be accessed
+     * from different threads at once. (Everything else is read-only) */
     GArray *items;      /* cp_item[] for refresh_tasks */
-    GSource *source;    /* timeout to run the cmdline for tasks */
+    GHashTable *items_idx; /* node -> index in items + 1 (no ref) */
+    GSource *source;    /* timeout/idle to run the cmdline for tasks */
+    gboolean source_is_timeout;
+    guint nb_running;   /* nb of processes currently running */
+    struct cp_stats stats;
+    /* only used from thread UI, see cp_coproc_send() */
+    struct cp_coproc *coproc;
     guint nb_props;     /* nb of actual props, i.e. len of properties[] below */
     struct prop_def properties[];
 };
@@ -606,10 +665,29 @@ struct visuals
 struct intref
 {
     DonnaArgType type;
+    /* NULL when the slot is free */
     gpointer     ptr;
     gint64       last;
+    /* nb of objects kept alive (i.e. nb of elements for arrays) */
+    guint        pinned;
+    /* bumped each time the slot is free-d, so stale handles don't match */
+    guint        gen;
+    /* next free slot, when not in use */
+    guint        next_free;
 };
 
+/* entry in the expiry wheel; might be stale (gen doesn't match anymore) */
+struct intref_expiry
+{
+    guint        slot;
+    guint        gen;
+};
+
+#define INTREFS_EXPIRY          (G_USEC_PER_SEC * 60 * 15) /* 15min */
+#define INTREFS_WHEEL_TICK      60 /* 1min */
+#define INTREFS_WHEEL_SIZE      16
+#define INTREF_NO_SLOT          G_MAXUINT
+
 enum
 {
     ST_SCE_APP,
@@ -626,6 +704,9 @@ struct status_donna
     guint            sce_timeout;
     GLogLevelFlags   level;
     gchar           *message;
+    /* handles on options format & format_tooltip; only used under LOCK_STATUS */
+    DonnaConfigHandle *h_format;
+    DonnaConfigHandle *h_format_tooltip;
 };
 
 struct status_provider
@@ -649,6 +730,10 @@ struct socket
     GSList      *tasks;
     /* last task-id used */
     guint        last_id;
+    /* requests are prefixed with a request id, echoed back in replies */
+    gboolean     tagged;
+    /* arrays (of nodes/strings) are streamed back instead of using intrefs */
+    gboolean     stream;
 };
 
 /* visuals and providers (for custom properties) are under a RW lock so everyone
@@ -675,7 +760,11 @@ enum lock_for
     /* to access intrefs */
     LOCK_INTREFS            = (1 << 7),
     /* to access the status_donna (statusbar) */
-    LOCK_STATUS             = (1 << 8)
+    LOCK_STATUS             = (1 << 8),
+    /* to access events (dispatch tables) */
+    LOCK_EVENTS             = (1 << 9),
+    /* to access the cache of user parsing of full locations */
+    LOCK_FLS                = (1 << 10)
 };
 
 struct lock
@@ -721,6 +810,13 @@ struct _DonnaAppPrivate
     /* our lock, which separates the different things and has some under a
      * Read/Write lock while most are under a simple one */
     struct lock      lock;
+    /* options changed in config from other threads, waiting to be processed
+     * (in batch, from thread UI). pending_options owns the strings,
+     * pending_options_set is used to only process each option once */
+    GMutex           pending_options_mutex;
+    GPtrArray       *pending_options;
+    GHashTable      *pending_options_set;
+    guint            sid_pending_options;
     GHashTable      *visuals;
     GArray          *providers;
     struct col_type
@@ -732,9 +828,25 @@ struct _DonnaAppPrivate
     } column_types[NB_COL_TYPES];
     GSList          *col_ct_datas;
     GHashTable      *patterns;
-    GHashTable      *intrefs;
+    DonnaPropCache  *cp_cache;
+    /* slots of struct intref, handles being "<slot.gen>" */
+    GArray          *intrefs;
+    guint            intrefs_free;
+    /* expiry wheel, one bucket (of struct intref_expiry) per tick */
+    GArray          *intrefs_wheel[INTREFS_WHEEL_SIZE];
+    guint            intrefs_tick;
     guint            intrefs_timeout;
+    /* live intrefs, and nb of objects they keep alive */
+    guint            intrefs_live;
+    guint            intrefs_pinned;
     GArray          *status_donna;
+    /* "<source>/events/<event>" -> struct event_handlers; for config version
+     * events_version */
+    GHashTable      *events;
+    guint            events_version;
+    /* full location -> struct user_parsed; for config version fls_version */
+    GHashTable      *fls;
+    guint            fls_version;
 };
 
 struct argmt
@@ -754,6 +866,10 @@ static GSList *     event_confirm = NULL;
 /* internal from treeview.c */
 gboolean
 _donna_tree_view_register_extras (DonnaConfig *config, GError **error);
+DonnaArrangement *
+_donna_tree_view_dup_arrangement (DonnaArrangement *arr);
+void
+_donna_tree_view_free_arrangement (DonnaArrangement *arr);
 
 /* internal from contextmenu.c */
 gboolean
@@ -969,6 +1085,29 @@ free_arrangements (GSList *list)
     g_slist_free (list);
 }
 
+/* must be called with LOCK_INTREFS */
+static void
+free_intref (DonnaAppPrivate *priv, guint slot)
+{
+    struct intref *ir = &g_array_index (priv->intrefs, struct intref, slot);
+
+    if (ir->type & DONNA_ARG_IS_ARRAY)
+        g_ptr_array_unref (ir->ptr);
+    else if (ir->type & (DONNA_ARG_TYPE_TREE_VIEW | DONNA_ARG_TYPE_NODE
+                | DONNA_ARG_TYPE_TERMINAL))
+        g_object_unref (ir->ptr);
+    else
+        g_warning ("free_intref(): Invalid type: %d", ir->type);
+
+    --priv->intrefs_live;
+    priv->intrefs_pinned -= ir->pinned;
+
+    ir->ptr = NULL;
+    ++ir->gen;
+    ir->next_free = priv->intrefs_free;
+    priv->intrefs_free = slot;
+}
+
 static void
 app_free (DonnaApp *app)
 {
@@ -1004,8 +1143,28 @@ app_free (DonnaApp *app)
     }
     if (priv->intrefs)
     {
-        g_hash_table_destroy (priv->intrefs);
+        for (i = 0; i < priv->intrefs->len; ++i)
+            if (g_array_index (priv->intrefs, struct intref, i).ptr)
+                free_intref (priv, i);
+        g_array_free (priv->intrefs, TRUE);
         priv->intrefs = NULL;
+
+        for (i = 0; i < INTREFS_WHEEL_SIZE; ++i)
+            if (priv->intrefs_wheel[i])
+            {
+                g_array_free (priv->intrefs_wheel[i], TRUE);
+                priv->intrefs_wheel[i] = NULL;
+            }
+    }
+    if (priv->events)
+    {
+        g_hash_table_destroy (priv->events);
+        priv->events = NULL;
+    }
+    if (priv->fls)
+    {
+        g_hash_table_destroy (priv->fls);
+        priv->fls = NULL;
     }
 
     while (priv->terminals)
@@ -1065,6 +1224,19 @@ app_free (DonnaApp *app)
         g_array_free (priv->providers, TRUE);
         priv->providers = NULL;
     }
+    if (priv->cp_cache)
+    {
+        GError *err = NULL;
+
+        if (!donna_prop_cache_save (priv->cp_cache, &err))
+        {
+            g_warning ("Failed to save cache of custom properties: %s",
+                    (err) ? err->message : "(no error message)");
+            g_clear_error (&err);
+        }
+        donna_prop_cache_free (priv->cp_cache);
+        priv->cp_cache = NULL;
+    }
     if (priv->task_manager)
     {
         g_object_unref (priv->task_manager);
@@ -1099,6 +1271,14 @@ donna_app_finalize (GObject *object)
     g_strfreev (priv->environ);
     g_cond_clear (&priv->lock.cond);
     g_mutex_clear (&priv->lock.mutex);
+    if (priv->sid_pending_options > 0)
+        g_source_remove (priv->sid_pending_options);
+    if (priv->pending_options)
+    {
+        g_ptr_array_free (priv->pending_options, TRUE);
+        g_hash_table_unref (priv->pending_options_set);
+    }
+    g_mutex_clear (&priv->pending_options_mutex);
     g_thread_pool_free (priv->pool, TRUE, FALSE);
 
     G_OBJECT_CLASS (donna_app_parent_class)->finalize (object);
@@ -1112,14 +1292,19 @@ donna_app_task_run (DonnaTask *task)
     return FALSE;
 }
 
+static void cp_coproc_stop (struct property *property, gboolean reschedule);
+
 static void
 free_property (gpointer data)
 {
     struct property *p = data;
 
+    cp_coproc_stop (p, FALSE);
     g_free (p->cmdline);
     if (p->items)
        g_array_unref (p->items);
+    if (p->items_idx)
+        g_hash_table_unref (p->items_idx);
     if (p->source)
     {
         g_source_destroy (p->source);
@@ -1164,17 +1349,47 @@ free_visuals (struct visuals *visuals)
     g_slice_free (struct visuals, visuals);
 }
 
+/* dispatch table for an event (from a source) */
+struct event_handlers
+{
+    gint         ref_count;
+    /* nb of triggers; 0 when no handlers, which is also cached */
+    guint        nb;
+    /* names of the options (sorted), and their values (full locations) */
+    gchar      **names;
+    gchar      **fls;
+};
+
 static void
-free_intref (struct intref *ir)
+event_handlers_unref (struct event_handlers *eh)
 {
-    if (ir->type & DONNA_ARG_IS_ARRAY)
-        g_ptr_array_unref (ir->ptr);
-    else if (ir->type == DONNA_ARG_TYPE_TREE_VIEW || ir->type == DONNA_ARG_TYPE_NODE)
-        g_object_unref (ir->ptr);
-    else
-        g_warning ("free_intref(): Invalid type: %d", ir->type);
+    if (!g_atomic_int_dec_and_test (&eh->ref_count))
+        return;
+    g_strfreev (eh->names);
+    g_strfreev (eh->fls);
+    g_slice_free (struct event_handlers, eh);
+}
+
+/* result of user parsing (prefixes/aliases) of a full location */
+struct user_parsed
+{
+    /* replacement, or NULL */
+    gchar       *prefix;
+    /* how much of the full location was replaced */
+    gsize        skip;
+    /* alias suffix, or NULL */
+    gchar       *suffix;
+};
+
+/* max nb of full locations in cache; when reached, the cache is emptied */
+#define MAX_USER_PARSED     256
 
-    g_free (ir);
+static void
+free_user_parsed (struct user_parsed *up)
+{
+    g_free (up->prefix);
+    g_free (up->suffix);
+    g_slice_free (struct user_parsed, up);
 }
 
 struct idle_option
@@ -1305,6 +1520,79 @@ option_cb (DonnaConfig *config, const gchar *option, DonnaApp *app)
     return TRUE;
 }
 
+static gboolean
+pending_options_cb (DonnaApp *app)
+{
+    DonnaAppPrivate *priv = app->priv;
+    GPtrArray *options;
+    guint i;
+
+    g_mutex_lock (&priv->pending_options_mutex);
+    options = priv->pending_options;
+    if (options)
+        g_hash_table_unref (priv->pending_options_set);
+    priv->pending_options = NULL;
+    priv->pending_options_set = NULL;
+    priv->sid_pending_options = 0;
+    g_mutex_unlock (&priv->pending_options_mutex);
+
+    if (G_UNLIKELY (!options))
+        return G_SOURCE_REMOVE;
+
+    /* in the order they were changed. Using the config so option_cb() will
+     * add an idle source to try again if needed */
+    for (i = 0; i < options->len; ++i)
+        option_cb (app->priv->config, options->pdata[i], app);
+    g_ptr_array_free (options, TRUE);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+config_option_cb (DonnaConfig *config, const gchar *option, DonnaApp *app)
+{
+    DonnaAppPrivate *priv = app->priv;
+
+    /* in thread UI changes are processed right away, after the pending ones
+     * (to respect the order) */
+    if (g_main_context_is_owner (g_main_context_default ()))
+    {
+        gboolean has_pending;
+
+        g_mutex_lock (&priv->pending_options_mutex);
+        has_pending = priv->sid_pending_options > 0;
+        if (has_pending)
+            g_source_remove (priv->sid_pending_options);
+        g_mutex_unlock (&priv->pending_options_mutex);
+        if (has_pending)
+            pending_options_cb (app);
+
+        option_cb (config, option, app);
+        return;
+    }
+
+    /* scripts can set quite a few options in a row (from other threads), so
+     * instead of processing each change on its own we batch them, and process
+     * them all (each only once) from one source in thread UI */
+    g_mutex_lock (&priv->pending_options_mutex);
+    if (!priv->pending_options)
+    {
+        priv->pending_options = g_ptr_array_new_with_free_func (g_free);
+        priv->pending_options_set = g_hash_table_new (g_str_hash, g_str_equal);
+    }
+    if (!g_hash_table_contains (priv->pending_options_set, option))
+    {
+        gchar *s = g_strdup (option);
+
+        g_ptr_array_add (priv->pending_options, s);
+        g_hash_table_add (priv->pending_options_set, s);
+    }
+    if (priv->sid_pending_options == 0)
+        priv->sid_pending_options = g_idle_add_full (G_PRIORITY_DEFAULT,
+                (GSourceFunc) pending_options_cb, app, NULL);
+    g_mutex_unlock (&priv->pending_options_mutex);
+}
+
 static void
 donna_app_init (DonnaApp *app)
 {
@@ -1318,11 +1606,14 @@ donna_app_init (DonnaApp *app)
 
     g_cond_init (&priv->lock.cond);
     g_mutex_init (&priv->lock.mutex);
+    g_mutex_init (&priv->pending_options_mutex);
 
     priv->config = g_object_new (DONNA_TYPE_PROVIDER_CONFIG, "app", app, NULL);
     g_signal_connect (priv->config, "new-node", (GCallback) new_node_cb, app);
-    g_signal_connect (priv->config, "option-set", (GCallback) option_cb, app);
-    g_signal_connect (priv->config, "option-deleted", (GCallback) option_cb, app);
+    g_signal_connect (priv->config, "option-set",
+            (GCallback) config_option_cb, app);
+    g_signal_connect (priv->config, "option-deleted",
+            (GCallback) config_option_cb, app);
     priv->column_types[COL_TYPE_NAME].name = "name";
     priv->column_types[COL_TYPE_NAME].desc = "Name (and Icon)";
     priv->column_types[COL_TYPE_NAME].type = DONNA_TYPE_COLUMN_TYPE_NAME;
@@ -1418,8 +1709,14 @@ donna_app_init (DonnaApp *app)
     priv->visuals = g_hash_table_new_full (g_str_hash, g_str_equal,
             g_free, (GDestroyNotify) free_visuals);
 
-    priv->intrefs = g_hash_table_new_full (g_str_hash, g_str_equal,
-            g_free, (GDestroyNotify) free_intref);
+    priv->intrefs = g_array_new (FALSE, TRUE, sizeof (struct intref));
+    priv->intrefs_free = INTREF_NO_SLOT;
+
+    priv->events = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) event_handlers_unref);
+
+    priv->fls = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) free_user_parsed);
 }
 
 static gboolean
@@ -1443,7 +1740,7 @@ _app_lock (DonnaApp               *app,
         { 0, }
     };
     guint locks[] = { LOCK_COLUMN_TYPES, LOCK_COL_CT_DATAS, LOCK_PATTERNS,
-        LOCK_INTREFS, LOCK_STATUS, 0 };
+        LOCK_INTREFS, LOCK_STATUS, LOCK_EVENTS, LOCK_FLS, 0 };
     guint i;
 
     g_mutex_lock (&lock->mutex);
@@ -1524,7 +1821,7 @@ app_unlock (DonnaApp               *app,
         { 0, }
     };
     guint locks[] = { LOCK_COLUMN_TYPES, LOCK_COL_CT_DATAS, LOCK_PATTERNS,
-        LOCK_INTREFS, LOCK_STATUS, 0 };
+        LOCK_INTREFS, LOCK_STATUS, LOCK_EVENTS, LOCK_FLS, 0 };
     guint i;
     gboolean broadcast = FALSE;
 
@@ -2050,6 +2347,7 @@ struct cp_refresh {
             GPtrArray *nodes;
             GArray *items;
             DonnaTaskProcess *tp;
+            gint64 started;
         } multi;
     };
 };
@@ -2250,18 +2548,12 @@ cpr_get_node (struct cp_refresh *cpr)
     }
 }
 
-static void
-cpr_refresh (struct cp_refresh  *cpr,
-             gchar              *str,
-             guint               num_prop,
-             DonnaNode          *node,
-             GObject            *o_tp)
+static gboolean
+cp_set_value (struct prop_def *pd, DonnaNode *node, const gchar *str)
 {
-    struct prop_def *pd;
     GValue v = G_VALUE_INIT;
     gboolean ok = TRUE;
 
-    pd = &cpr->property->properties[num_prop];
     g_value_init (&v, pd->type);
     if (pd->type == G_TYPE_STRING)
         g_value_set_string (&v, str);
@@ -2286,6 +2578,93 @@ cpr_refresh (struct cp_refresh  *cpr,
                 g_free (fl));
     }
     g_value_unset (&v);
+    return ok;
+}
+
+/* the values cache is only used for nodes in fs, since the value is valid as
+ * long as the file's mtime, size & inode remain the same */
+static gboolean
+cp_get_cache_key (struct property *property, DonnaNode *node, DonnaPropCacheKey *key)
+{
+    gchar *filename;
+    gboolean ret;
+
+    if (!property->cache || !streq (donna_node_get_domain (node), "fs"))
+        return FALSE;
+
+    filename = donna_node_get_filename (node);
+    ret = donna_prop_cache_get_key (filename, key);
+    g_free (filename);
+    return ret;
+}
+
+/* returns TRUE if the value was set from cache. Must not be called under
+ * LOCK_PROVIDERS_* since setting the value emits node-updated */
+static gboolean
+cp_set_value_from_cache (struct property         *property,
+                         guint                    num_prop,
+                         DonnaNode               *node,
+                         const DonnaPropCacheKey *key)
+{
+    struct prop_def *pd = &property->properties[num_prop];
+    gchar *location;
+    gchar *value;
+    gboolean ret = FALSE;
+
+    location = donna_node_get_location (node);
+    value = donna_prop_cache_get (property->app->priv->cp_cache,
+            pd->name, location, key);
+    if (value)
+    {
+        ret = cp_set_value (pd, node, value);
+        DONNA_DEBUG (APP, NULL,
+                if (ret)
+                    g_debug3 ("Custom property '%s' on '%s' set from cache",
+                        pd->name, location));
+        /* e.g. property's type was changed, value is of no use anymore */
+        if (!ret)
+            donna_prop_cache_remove (property->app->priv->cp_cache,
+                    pd->name, location);
+        g_free (value);
+    }
+    g_free (location);
+    return ret;
+}
+
+static void
+cpr_refresh (struct cp_refresh  *cpr,
+             gchar              *str,
+             guint               num_prop,
+             DonnaNode          *node,
+             GObject            *o_tp)
+{
+    struct prop_def *pd;
+
+    pd = &cpr->property->properties[num_prop];
+    if (cp_set_value (pd, node, str) && cpr->property->cache)
+    {
+        if (cpr->is_single)
+        {
+            DonnaPropCacheKey key;
+
+            if (cp_get_cache_key (cpr->property, node, &key))
+            {
+                gchar *location = donna_node_get_location (node);
+                donna_prop_cache_set (cpr->property->app->priv->cp_cache,
+                        pd->name, location, &key, str);
+                g_free (location);
+            }
+        }
+        else
+        {
+            struct cp_item *cpi;
+
+            cpi = &g_array_index (cpr->multi.items, struct cp_item, cpr->current);
+            if (cpi->has_key)
+                donna_prop_cache_set (cpr->property->app->priv->cp_cache,
+                        pd->name, cpi->location, &cpi->key, str);
+        }
+    }
 
     /* flag refreshed */
     if (cpr->is_single)
@@ -2361,6 +2740,78 @@ cp_pipe_new_line (DonnaTaskProcess  *tp,
     cpr_refresh (cpr, line, num_prop, node, (GObject *) tp);
 }
 
+/* Parses NUL-separated data in cpr->str, processing every complete record and
+ * removing it from the buffer. Returns CPR_NEED_DATA once there's no complete
+ * record left, CPR_FAILED on invalid data, and CPR_DONE when an empty record
+ * (i.e. a NUL where a record should start) was found, in which case it is left
+ * in the buffer. */
+static enum cpr_state
+cpr_parse_nuls (struct cp_refresh *cpr, GObject *o_tp)
+{
+    while (cpr->str->len > 0)
+    {
+        DonnaNode *node = NULL;
+        gboolean is_post_file = cpr->data_state == DS_POST_FILE;
+        guint num_prop;
+        gchar *s;
+
+        if (!is_post_file)
+        {
+            if (cpr->str->str[0] == '\0')
+                return CPR_DONE;
+            /* filename */
+            else if (cpr->str->str[0] == '/')
+            {
+                switch (cpr_filename (cpr, cpr->str->str, cpr->str->len, &node, &s))
+                {
+                    case CPR_DONE:
+                        cpr->data_state = DS_POST_FILE;
+                        g_string_erase (cpr->str, 0, s - cpr->str->str);
+                        is_post_file = TRUE;
+                        break;
+                    case CPR_NEED_DATA:
+                        return CPR_NEED_DATA;
+                    case CPR_FAILED:
+                        return CPR_FAILED;
+                }
+
+                /* no more data to process */
+                if (cpr->str->len == 0)
+                    return CPR_NEED_DATA;
+            }
+        }
+
+        switch (cpr_property (cpr, cpr->str->str, cpr->str->len, is_post_file, &num_prop, &s))
+        {
+            case CPR_DONE:
+                break;
+            case CPR_NEED_DATA:
+                return CPR_NEED_DATA;
+            case CPR_FAILED:
+                return CPR_FAILED;
+        }
+
+        /* make sure we have received a NUL */
+        if (strlen (cpr->str->str) >= cpr->str->len)
+            return CPR_NEED_DATA;
+
+        /* if after file and no property name, nothing to do (but remove
+         * processed data from buffer) */
+        if (!is_post_file || *s != '\0')
+        {
+            if (!node)
+                node = cpr_get_node (cpr);
+            /* move past pipe into value */
+            ++s;
+            cpr_refresh (cpr, s, num_prop, node, o_tp);
+        }
+        g_string_erase (cpr->str, 0, (gssize) (strlen (cpr->str->str) + 1));
+        cpr->data_state = DS_READY;
+    }
+
+    return CPR_NEED_DATA;
+}
+
 static void
 cp_pipe_data_received (DonnaTaskProcess  *tp,
                        DonnaPipe          pipe,
@@ -2368,11 +2819,6 @@ cp_pipe_data_received (DonnaTaskProcess  *tp,
                        gchar             *data,
                        struct cp_refresh *cpr)
 {
-    DonnaNode *node;
-    gchar *s;
-    gboolean is_post_file = FALSE;
-    guint num_prop;
-
     if (len == 0)
         /* EOF */
         return;
@@ -2381,67 +2827,9 @@ cp_pipe_data_received (DonnaTaskProcess  *tp,
         return;
 
     g_string_append_len (cpr->str, data, (gssize) len);
-
-again:
-    if (cpr->data_state == DS_READY)
-    {
-        /* filename */
-        if (cpr->str->str[0] == '/')
-        {
-            switch (cpr_filename (cpr, cpr->str->str, cpr->str->len, &node, &s))
-            {
-                case CPR_DONE:
-                    cpr->data_state = DS_POST_FILE;
-                    g_string_erase (cpr->str, 0, s - cpr->str->str);
-                    is_post_file = TRUE;
-                    break;
-                case CPR_NEED_DATA:
-                    /* nothing to do */
-                    return;
-                case CPR_FAILED:
-                    /* we're done */
-                    cpr->data_state = DS_ERROR;
-                    return;
-            }
-        }
-    }
-    else
-        node = cpr_get_node (cpr);
-
-    /* no more data to process */
-    if (cpr->str->len == 0)
-        return;
-
-    switch (cpr_property (cpr, cpr->str->str, cpr->str->len, is_post_file, &num_prop, &s))
-    {
-        case CPR_DONE:
-            break;
-        case CPR_NEED_DATA:
-            /* nothing to do */
-            return;
-        case CPR_FAILED:
-            /* we're done */
-            cpr->data_state = DS_ERROR;
-            return;
-    }
-
-    /* make sure we have received a NUL */
-    if (strlen (cpr->str->str) >= cpr->str->len)
-        return;
-
-    /* if after file and no property name, nothing to do (but remove processed
-     * data from buffer) */
-    if (!is_post_file || *s != '\0')
-    {
-        /* move past pipe into value */
-        ++s;
-        cpr_refresh (cpr, s, num_prop, node, (GObject *) tp);
-    }
-    g_string_erase (cpr->str, 0, (gssize) (strlen (cpr->str->str) + 1));
-    cpr->data_state = DS_READY;
-
-    if (cpr->str->len > 0)
-        goto again;
+    if (cpr_parse_nuls (cpr, (GObject *) tp) != CPR_NEED_DATA)
+        /* we're done */
+        cpr->data_state = DS_ERROR;
 }
 
 static gboolean
@@ -2469,6 +2857,42 @@ conv_cp (const gchar        c,
     return FALSE;
 }
 
+static void
+free_cp_stdin (GString *str)
+{
+    g_string_free (str, TRUE);
+}
+
+/* for persistent properties, when run as a one-shot process: send the
+ * location(s) then close stdin, so the process ends once done */
+static DonnaTaskProcessStdin
+cp_stdin (DonnaTask *task, GPid pid, gint fd, GString *str)
+{
+    gssize written;
+
+    while (str->len > 0)
+    {
+        written = write (fd, str->str, str->len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            else if (errno == EAGAIN)
+                return DONNA_TASK_PROCESS_STDIN_WAIT_NONBLOCKING;
+            else
+            {
+                donna_task_set_error (task, DONNA_TASK_PROCESS_ERROR,
+                        DONNA_TASK_PROCESS_ERROR_OTHER,
+                        "Failed to write locations to child process' stdin");
+                return DONNA_TASK_PROCESS_STDIN_FAILED;
+            }
+        }
+        g_string_erase (str, 0, written);
+    }
+
+    return DONNA_TASK_PROCESS_STDIN_CLOSE;
+}
+
 static DonnaTaskProcess *
 cp_get_task_process (struct cp_refresh *cpr)
 {
@@ -2500,7 +2924,33 @@ cp_get_task_process (struct cp_refresh *cpr)
     donna_task_set_devices ((DonnaTask *) tp, arr);
     g_ptr_array_unref (arr);
     donna_task_process_set_default_closer (tp);
-    if (cpr->property->use_nuls)
+    if (cpr->property->persistent)
+    {
+        GString *str_in = g_string_new (NULL);
+
+        if (cpr->is_single)
+        {
+            gchar *location = donna_node_get_location (cpr->single.node);
+            g_string_append_len (str_in, location, (gssize) strlen (location) + 1);
+            g_free (location);
+        }
+        else
+        {
+            guint i;
+
+            for (i = 0; i < cpr->multi.items->len; ++i)
+            {
+                struct cp_item *cpi;
+
+                cpi = &g_array_index (cpr->multi.items, struct cp_item, i);
+                g_string_append_len (str_in, cpi->location,
+                        (gssize) strlen (cpi->location) + 1);
+            }
+        }
+        donna_task_process_set_stdin (tp, (task_stdin_fn) cp_stdin, str_in,
+                (GDestroyNotify) free_cp_stdin);
+    }
+    if (cpr->property->use_nuls || cpr->property->persistent)
     {
         cpr->str = g_string_new (NULL);
         g_signal_connect (tp, "pipe-data-received", (GCallback) cp_pipe_data_received, cpr);
@@ -2522,8 +2972,13 @@ cp_get_task_process (struct cp_refresh *cpr)
     return tp;
 }
 
-static gboolean
-cp_tp_done (gint fd, GIOCondition condition, struct cp_refresh *cpr)
+static void cp_schedule (struct property *property);
+
+/* set pre-worker to DONE so the task worker (cp_worker) runs, since it only
+ * sets the return state (& error message if applicable), to keep things
+ * centralized. */
+static void
+cp_release_batch (struct cp_refresh *cpr)
 {
     guint i;
 
@@ -2544,38 +2999,457 @@ cp_tp_done (gint fd, GIOCondition condition, struct cp_refresh *cpr)
      * call to set_preran() above; else we'd have to make cpr ref_counted and
      * owned by all the tasks and whatnot */
     free_cp_refresh (cpr);
-    return G_SOURCE_REMOVE;
 }
 
-static gboolean
-cp_timeout (struct property *property)
+static void
+cp_batch_done (struct cp_refresh *cpr)
 {
-    struct cp_refresh *cpr;
-    GSource *source;
-    gint fd;
-    guint i;
+    struct property *property = cpr->property;
 
-    /* we need the lock to use property->{items,source} */
+    /* one less running, so whatever was queued in the meantime can go */
     app_lock (property->app, LOCK_PROVIDERS_WRITE);
+    --property->nb_running;
+    property->stats.time += g_get_monotonic_time () - cpr->multi.started;
+    cp_schedule (property);
+    app_unlock (property->app, LOCK_PROVIDERS_WRITE);
 
-    if (g_source_is_destroyed (g_main_current_source ()))
-    {
-        app_unlock (property->app, LOCK_PROVIDERS_WRITE);
-        return G_SOURCE_REMOVE;
-    }
+    cp_release_batch (cpr);
+}
 
-    g_source_unref (property->source);
+static gboolean
+cp_tp_done (gint fd, GIOCondition condition, struct cp_refresh *cpr)
+{
+    cp_batch_done (cpr);
+    return G_SOURCE_REMOVE;
+}
+
+/* Persistent properties: the command line is started once, and kept running as
+ * a coprocess. For each batch, the locations are written on its stdin, each
+ * NUL-terminated, followed by an empty record (i.e. an extra NUL) to mark the
+ * end of the batch. The coprocess answers in the same format as with use_nuls,
+ * and must also end its answers for a batch with an empty record.
+ * Batches are pipelined, i.e. we don't wait for the answers to a batch before
+ * sending the next one, max_running being the max nb of batches sent without
+ * having been answered yet.
+ *
+ * Everything here happens in thread UI, since that's where cp_timeout() runs;
+ * So property->coproc doesn't need any locking. */
+struct cp_coproc
+{
+    struct property *property;
+    GPid pid;
+    gint fd_in;
+    gint fd_out;
+    guint sid_in;       /* to write, when out isn't empty */
+    guint sid_out;      /* to read */
+    GString *out;       /* data waiting to be written */
+    GString *str;       /* data read, waiting to be parsed */
+    GQueue batches;     /* cp_refresh sent, waiting for answers */
+};
+
+static void
+cp_coproc_reaped (GPid pid, gint status, gpointer data)
+{
+    g_spawn_close_pid (pid);
+}
+
+/* Stops the coprocess of @property, if any. Batches still waiting for answers
+ * are released, i.e. their tasks will fail unless they were refreshed. If
+ * @reschedule, we're not under LOCK_PROVIDERS_WRITE (and the property isn't
+ * being free-d) so nb_running is updated & pending items scheduled */
+static void
+cp_coproc_stop (struct property *property, gboolean reschedule)
+{
+    struct cp_coproc *cop = property->coproc;
+    struct cp_refresh *cpr;
+
+    if (!cop)
+        return;
+    property->coproc = NULL;
+
+    if (cop->sid_in > 0)
+        g_source_remove (cop->sid_in);
+    if (cop->sid_out > 0)
+        g_source_remove (cop->sid_out);
+    /* see close_fd() in task-process.c for lack of loop in case of EINTR */
+    close (cop->fd_in);
+    close (cop->fd_out);
+    /* EOF on stdin should be enough, but it might be stuck/ignoring it. And
+     * since it hasn't been reaped yet, pid cannot have been reused */
+    kill (cop->pid, SIGTERM);
+    g_child_watch_add (cop->pid, cp_coproc_reaped, NULL);
+
+    if (reschedule)
+    {
+        app_lock (property->app, LOCK_PROVIDERS_WRITE);
+        property->nb_running -= g_queue_get_length (&cop->batches);
+        cp_schedule (property);
+        app_unlock (property->app, LOCK_PROVIDERS_WRITE);
+    }
+
+    while ((cpr = g_queue_pop_head (&cop->batches)))
+        cp_release_batch (cpr);
+
+    g_string_free (cop->out, TRUE);
+    g_string_free (cop->str, TRUE);
+    g_free (cop);
+}
+
+/* write to the coprocess without getting killed by SIGPIPE should it have
+ * died in the meantime */
+static gssize
+cp_coproc_write (gint fd, const gchar *data, gsize len)
+{
+    sigset_t set;
+    sigset_t old;
+    gssize written;
+
+    sigemptyset (&set);
+    sigaddset (&set, SIGPIPE);
+    pthread_sigmask (SIG_BLOCK, &set, &old);
+
+    written = write (fd, data, len);
+    if (written < 0 && errno == EPIPE)
+    {
+        struct timespec ts = { 0, 0 };
+
+        /* consume the SIGPIPE now pending */
+        while (sigtimedwait (&set, NULL, &ts) < 0 && errno == EINTR)
+            ;
+        errno = EPIPE;
+    }
+
+    pthread_sigmask (SIG_SETMASK, &old, NULL);
+    return written;
+}
+
+static gboolean cp_coproc_can_write (gint fd, GIOCondition condition,
+                                     struct cp_coproc *cop);
+
+/* returns FALSE if the coprocess was stopped (and free-d) */
+static gboolean
+cp_coproc_flush (struct cp_coproc *cop)
+{
+    while (cop->out->len > 0)
+    {
+        gssize written;
+
+        written = cp_coproc_write (cop->fd_in, cop->out->str, cop->out->len);
+        if (written < 0)
+        {
+            gint _errno = errno;
+
+            if (_errno == EINTR)
+                continue;
+            else if (_errno == EAGAIN)
+                break;
+
+            g_warning ("Custom property '%s': Failed to write to coprocess: %s",
+                    cop->property->properties[0].name, g_strerror (_errno));
+            cp_coproc_stop (cop->property, TRUE);
+            return FALSE;
+        }
+        g_string_erase (cop->out, 0, written);
+    }
+
+    if (cop->out->len > 0 && cop->sid_in == 0)
+        cop->sid_in = g_unix_fd_add (cop->fd_in, G_IO_OUT | G_IO_ERR,
+                (GUnixFDSourceFunc) cp_coproc_can_write, cop);
+    return TRUE;
+}
+
+static gboolean
+cp_coproc_can_write (gint fd, GIOCondition condition, struct cp_coproc *cop)
+{
+    if (!cp_coproc_flush (cop))
+        return G_SOURCE_REMOVE;
+    else if (cop->out->len > 0)
+        return G_SOURCE_CONTINUE;
+
+    cop->sid_in = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void
+cp_coproc_parse (struct cp_coproc *cop)
+{
+    while (cop->str->len > 0)
+    {
+        struct cp_refresh *cpr;
+        enum cpr_state state;
+
+        cpr = g_queue_peek_head (&cop->batches);
+        if (G_UNLIKELY (!cpr))
+        {
+            /* not an answer to any batch we sent, so ignore it */
+            g_string_truncate (cop->str, 0);
+            return;
+        }
+
+        if (cpr->data_state == DS_ERROR)
+        {
+            gchar *e = cop->str->str + cop->str->len - 1;
+            gchar *s;
+
+            /* skip until the end of the batch, i.e. the end of a record
+             * followed by an empty record */
+            for (s = cop->str->str; s < e; ++s)
+                if (s[0] == '\0' && s[1] == '\0')
+                    break;
+            if (s >= e)
+            {
+                /* keep a trailing NUL, it might be the end of the last record
+                 * before the empty one */
+                g_string_erase (cop->str, 0, (gssize) cop->str->len
+                        - ((*e == '\0') ? 1 : 0));
+                return;
+            }
+            g_string_erase (cop->str, 0, s + 1 - cop->str->str);
+            state = CPR_DONE;
+        }
+        else
+        {
+            cpr->str = cop->str;
+            state = cpr_parse_nuls (cpr, NULL);
+            cpr->str = NULL;
+        }
+
+        if (state == CPR_NEED_DATA)
+            return;
+        else if (state == CPR_FAILED)
+        {
+            cpr->data_state = DS_ERROR;
+            continue;
+        }
+
+        /* end of batch */
+        g_string_erase (cop->str, 0, 1);
+        g_queue_pop_head (&cop->batches);
+        cp_batch_done (cpr);
+    }
+}
+
+static gboolean
+cp_coproc_can_read (gint fd, GIOCondition condition, struct cp_coproc *cop)
+{
+    gchar buf[16384];
+    gssize len;
+
+again:
+    len = read (fd, buf, sizeof (buf));
+    if (len > 0)
+    {
+        g_string_append_len (cop->str, buf, len);
+        cp_coproc_parse (cop);
+        return G_SOURCE_CONTINUE;
+    }
+    else if (len < 0)
+    {
+        gint _errno = errno;
+
+        if (_errno == EINTR)
+            goto again;
+        else if (_errno == EAGAIN)
+            return G_SOURCE_CONTINUE;
+
+        g_warning ("Custom property '%s': Failed to read from coprocess: %s",
+                cop->property->properties[0].name, g_strerror (_errno));
+    }
+    else
+        DONNA_DEBUG (APP, NULL,
+                g_debug ("Custom property '%s': coprocess ended",
+                    cop->property->properties[0].name));
+
+    cop->sid_out = 0;
+    cp_coproc_stop (cop->property, TRUE);
+    return G_SOURCE_REMOVE;
+}
+
+static struct cp_coproc *
+cp_coproc_new (struct property *property)
+{
+    struct cp_coproc *cop;
+    struct cp_refresh cpr = {
+        .property   = property,
+        .is_single  = FALSE,
+        .current    = (guint) -1
+    };
+    DonnaContext context = { "n", FALSE, (conv_flag_fn) conv_cp, &cpr };
+    GError *err = NULL;
+    GString *str = NULL;
+    gchar *workdir;
+    gchar **argv;
+    GPid pid;
+    gint fd_in;
+    gint fd_out;
+
+    /* there are no nodes to put on the command line, since they're sent via
+     * stdin later on */
+    cpr.multi.nodes = g_ptr_array_new ();
+    donna_context_parse (&context, 0, property->app, property->cmdline, &str, NULL);
+    g_ptr_array_unref (cpr.multi.nodes);
+
+    if (!g_shell_parse_argv ((str) ? str->str : property->cmdline, NULL, &argv, &err))
+    {
+        g_warning ("Custom property '%s': Failed to parse command line: %s",
+                property->properties[0].name, err->message);
+        g_clear_error (&err);
+        if (str)
+            g_string_free (str, TRUE);
+        return NULL;
+    }
+
+    workdir = donna_app_get_current_dirname (property->app);
+    if (!g_spawn_async_with_pipes (workdir, argv,
+                donna_app_get_environ (property->app),
+                G_SPAWN_SEARCH_PATH_FROM_ENVP | G_SPAWN_DO_NOT_REAP_CHILD,
+                NULL, NULL, &pid, &fd_in, &fd_out, NULL, &err))
+    {
+        g_warning ("Custom property '%s': Failed to start coprocess: %s",
+                property->properties[0].name, err->message);
+        g_clear_error (&err);
+        g_free (workdir);
+        g_strfreev (argv);
+        if (str)
+            g_string_free (str, TRUE);
+        return NULL;
+    }
+    g_free (workdir);
+    g_strfreev (argv);
+
+    DONNA_DEBUG (APP, NULL,
+            g_debug ("Custom property '%s'%s: started coprocess '%s'",
+                property->properties[0].name,
+                (property->nb_props > 1) ? " (and others from the group)" : "",
+                (str) ? str->str : property->cmdline));
+    if (str)
+        g_string_free (str, TRUE);
+
+    g_unix_set_fd_nonblocking (fd_in, TRUE, NULL);
+    g_unix_set_fd_nonblocking (fd_out, TRUE, NULL);
+
+    cop = g_new0 (struct cp_coproc, 1);
+    cop->property = property;
+    cop->pid      = pid;
+    cop->fd_in    = fd_in;
+    cop->fd_out   = fd_out;
+    cop->out      = g_string_new (NULL);
+    cop->str      = g_string_new (NULL);
+    g_queue_init (&cop->batches);
+    cop->sid_out  = g_unix_fd_add (fd_out, G_IO_IN | G_IO_HUP | G_IO_ERR,
+            (GUnixFDSourceFunc) cp_coproc_can_read, cop);
+
+    return cop;
+}
+
+/* sends the batch to the coprocess, starting it if needed. Returns FALSE if it
+ * couldn't be started; Else the batch is taken care of, even if the coprocess
+ * then fails (in which case it has already been released) */
+static gboolean
+cp_coproc_send (struct cp_refresh *cpr)
+{
+    struct property *property = cpr->property;
+    struct cp_coproc *cop;
+    guint i;
+
+    if (!property->coproc)
+    {
+        property->coproc = cp_coproc_new (property);
+        if (G_UNLIKELY (!property->coproc))
+            return FALSE;
+    }
+    cop = property->coproc;
+
+    for (i = 0; i < cpr->multi.items->len; ++i)
+    {
+        struct cp_item *cpi = &g_array_index (cpr->multi.items, struct cp_item, i);
+        g_string_append_len (cop->out, cpi->location,
+                (gssize) strlen (cpi->location) + 1);
+    }
+    /* end of batch */
+    g_string_append_c (cop->out, '\0');
+
+    g_queue_push_tail (&cop->batches, cpr);
+    cp_coproc_flush (cop);
+    return TRUE;
+}
+
+static gboolean
+cp_timeout (struct property *property)
+{
+    struct cp_refresh *cpr;
+    GSource *source;
+    gint fd;
+    guint i;
+
+    /* we need the lock to use property->{items,source} */
+    app_lock (property->app, LOCK_PROVIDERS_WRITE);
+
+    if (g_source_is_destroyed (g_main_current_source ()))
+    {
+        app_unlock (property->app, LOCK_PROVIDERS_WRITE);
+        return G_SOURCE_REMOVE;
+    }
+
+    g_source_unref (property->source);
     property->source = NULL;
 
+    /* cp_tp_done() will schedule things again */
+    if (property->nb_running >= property->max_running
+            || !property->items || property->items->len == 0)
+    {
+        app_unlock (property->app, LOCK_PROVIDERS_WRITE);
+        return G_SOURCE_REMOVE;
+    }
+
     cpr = g_new0 (struct cp_refresh, 1);
     cpr->property = property;
     cpr->is_single = FALSE;
     cpr->current = (guint) -1;
-    cpr->multi.items = property->items;
-    property->items = NULL;
+    if (property->items->len <= property->batch_max)
+    {
+        cpr->multi.items = property->items;
+        property->items = NULL;
+        g_hash_table_remove_all (property->items_idx);
+    }
+    else
+    {
+        /* take the first batch_max items, leave the rest queued */
+        cpr->multi.items = g_array_sized_new (FALSE, FALSE,
+                sizeof (struct cp_item), property->batch_max);
+        g_array_set_clear_func (cpr->multi.items, free_cp_item);
+        g_array_append_vals (cpr->multi.items, property->items->data,
+                property->batch_max);
+        /* items were moved, so they mustn't be free-d */
+        g_array_set_clear_func (property->items, NULL);
+        g_array_remove_range (property->items, 0, property->batch_max);
+        g_array_set_clear_func (property->items, free_cp_item);
+        /* remaining items were moved as well */
+        g_hash_table_remove_all (property->items_idx);
+        for (i = 0; i < property->items->len; ++i)
+            g_hash_table_insert (property->items_idx,
+                    g_array_index (property->items, struct cp_item, i).node,
+                    GUINT_TO_POINTER (i + 1));
+    }
+
+    ++property->nb_running;
+    ++property->stats.nb_batches;
+    property->stats.nb_nodes += cpr->multi.items->len;
+    if (cpr->multi.items->len > property->stats.max_nodes)
+        property->stats.max_nodes = cpr->multi.items->len;
+    cpr->multi.started = g_get_monotonic_time ();
+
+    /* in case there are items left & we can run another process */
+    cp_schedule (property);
 
     app_unlock (property->app, LOCK_PROVIDERS_WRITE);
 
+    DONNA_DEBUG (APP, NULL,
+            g_debug2 ("Custom property '%s': batch of %u nodes (%u running)",
+                property->properties[0].name,
+                cpr->multi.items->len,
+                property->nb_running));
+
     cpr->multi.nodes = g_ptr_array_sized_new (cpr->multi.items->len);
     for (i = 0; i < cpr->multi.items->len; ++i)
     {
@@ -2583,6 +3457,13 @@ cp_timeout (struct property *property)
         g_ptr_array_add (cpr->multi.nodes, cpi->node);
     }
 
+    if (property->persistent)
+    {
+        if (G_UNLIKELY (!cp_coproc_send (cpr)))
+            goto err;
+        return G_SOURCE_REMOVE;
+    }
+
     cpr->multi.tp = cp_get_task_process (cpr);
     if (G_UNLIKELY (!cpr->multi.tp))
         goto err;
@@ -2602,23 +3483,62 @@ cp_timeout (struct property *property)
     return G_SOURCE_REMOVE;
 
 err:
-    for (i = 0; i < cpr->multi.items->len; ++i)
-    {
-        struct cp_item *cpi = &g_array_index (cpr->multi.items, struct cp_item, i);
-        guint j;
+    app_lock (property->app, LOCK_PROVIDERS_WRITE);
+    --property->nb_running;
+    cp_schedule (property);
+    app_unlock (property->app, LOCK_PROVIDERS_WRITE);
 
-        for (j = 0; j < cpi->tasks->len; ++j)
+    cp_release_batch (cpr);
+    return G_SOURCE_REMOVE;
+}
+
+/* Decides when the queued refreshes (property->items) should be sent to a new
+ * process. The idea is to have low latency when things are quiet, and bigger
+ * batches when there's a lot going on:
+ * - if no process is running, items are sent from an idle source, i.e. as soon
+ *   as the current batch of work (e.g. rendering of visible rows) is done. So a
+ *   single refresh doesn't wait, but all the ones requested in the same go are
+ *   batched together;
+ * - if max_running processes are running, nothing is done: items accumulate
+ *   until cp_tp_done() is called, which will call us again;
+ * - else, items wait for up to batch_latency ms, unless batch_max is reached.
+ *
+ * Must be called under LOCK_PROVIDERS_WRITE */
+static void
+cp_schedule (struct property *property)
+{
+    if (!property->items || property->items->len == 0)
+        return;
+
+    if (property->nb_running >= property->max_running)
+        return;
+
+    if (property->nb_running == 0 || property->items->len >= property->batch_max)
+    {
+        if (property->source)
         {
-            struct cpi_task *cpit = cpi->tasks->pdata[j];
-            /* set pre-worker to DONE so the task worker (cp_worker) runs, since
-             * it only sets the return state (& error message if applicable), to
-             * keep things centralized. */
-            donna_task_set_preran (cpit->task, DONNA_TASK_DONE,
-                    cpit->run_task, cpit->run_task_data);
+            if (!property->source_is_timeout)
+                return;
+            g_source_destroy (property->source);
+            g_source_unref (property->source);
         }
+
+        property->source = g_idle_source_new ();
+        property->source_is_timeout = FALSE;
+        if (property->nb_running > 0)
+            g_source_set_priority (property->source, G_PRIORITY_HIGH);
     }
-    free_cp_refresh (cpr);
-    return G_SOURCE_REMOVE;
+    else if (!property->source)
+    {
+        property->source = g_timeout_source_new (property->batch_latency);
+        property->source_is_timeout = TRUE;
+    }
+    else
+        return;
+
+    g_source_set_callback (property->source,
+            (GSourceFunc) cp_timeout, property, NULL);
+    g_source_attach (property->source, NULL);
 }
 
 static void
@@ -2636,6 +3556,23 @@ cp_preworker (DonnaTask         *task,
     cpit->run_task = run_task;
     cpit->run_task_data = run_task_data;
 
+    /* get the cache key (i.e. lstat) before taking the lock, and if the value
+     * is in cache no need to spawn anything: the task will just be done (see
+     * cp_worker()) unless it was asked not to use the cache */
+    _cpi.node = g_object_get_data ((GObject *) task, "donna-cp-node");
+    _cpi.has_key = cp_get_cache_key (property, _cpi.node, &_cpi.key);
+    if (_cpi.has_key
+            && !g_object_get_data ((GObject *) task, DONNA_NODE_REFRESH_BYPASS_CACHE)
+            && cp_set_value_from_cache (property, cpit->num_prop, _cpi.node, &_cpi.key))
+    {
+        g_object_set_data ((GObject *) task, "donna-cp-refreshed",
+                GINT_TO_POINTER (TRUE));
+        donna_task_set_preran (task, DONNA_TASK_DONE, run_task, run_task_data);
+        /* see cp_release_batch() */
+        free_cpi_task (cpit);
+        return;
+    }
+
     /* we need the lock to use property->{items,source} */
     app_lock (app, LOCK_PROVIDERS_WRITE);
 
@@ -2644,19 +3581,19 @@ cp_preworker (DonnaTask         *task,
         property->items = g_array_new (FALSE, FALSE, sizeof (struct cp_item));
         g_array_set_clear_func (property->items, free_cp_item);
     }
+    if (!property->items_idx)
+        property->items_idx = g_hash_table_new (g_direct_hash, g_direct_equal);
 
-    _cpi.node = g_object_get_data ((GObject *) task, "donna-cp-node");
     /* there might already be refreshes for this node waiting */
-    for (i = 0; i < property->items->len; ++i)
-    {
-        cpi = &g_array_index (property->items, struct cp_item, i);
-        if (cpi->node == _cpi.node)
-            break;
-    }
-    if (i >= property->items->len)
+    i = GPOINTER_TO_UINT (g_hash_table_lookup (property->items_idx, _cpi.node));
+    if (i > 0)
+        cpi = &g_array_index (property->items, struct cp_item, i - 1);
+    else
     {
         _cpi.location = donna_node_get_location (_cpi.node);
         g_array_append_val (property->items, _cpi);
+        g_hash_table_insert (property->items_idx, _cpi.node,
+                GUINT_TO_POINTER (property->items->len));
         cpi = &g_array_index (property->items, struct cp_item, property->items->len - 1);
     }
 
@@ -2664,30 +3601,7 @@ cp_preworker (DonnaTask         *task,
         cpi->tasks = g_ptr_array_new_with_free_func (free_cpi_task);
     g_ptr_array_add (cpi->tasks, cpit);
 
-    /* if we've reached the max, we'll set up an idle source (with HIGH
-     * priority) to actually start things up */
-    if (property->items->len >= CP_MAX_NODE_WAITING)
-    {
-        /* destroy the timeout if there's one */
-        if (property->source)
-        {
-            g_source_destroy (property->source);
-            g_source_unref (property->source);
-        }
-
-        property->source = g_idle_source_new ();
-        g_source_set_priority (property->source, G_PRIORITY_HIGH);
-        g_source_set_callback (property->source,
-                (GSourceFunc) cp_timeout, property, NULL);
-        g_source_attach (property->source, NULL);
-    }
-    else if (!property->source)
-    {
-        property->source = g_timeout_source_new (800);
-        g_source_set_callback (property->source,
-                (GSourceFunc) cp_timeout, property, NULL);
-        g_source_attach (property->source, NULL);
-    }
+    cp_schedule (property);
 
     app_unlock (app, LOCK_PROVIDERS_WRITE);
 }
@@ -2726,12 +3640,15 @@ cp_refresher_task (DonnaNode        *node,
         g_free (cpit);
         return NULL;
     }
-    cpit->task = g_object_ref (task);
     donna_task_set_visibility (task, DONNA_TASK_VISIBILITY_INTERNAL_FAST);
-    donna_task_set_pre_worker (task, (task_pre_fn) cp_preworker);
     g_object_set_data_full ((GObject *) task, "donna-cp-node",
             g_object_ref (node), g_object_unref);
 
+    /* the cache is checked from cp_preworker(), since we might be called under
+     * LOCK_PROVIDERS_READ (see new_node_cb()) */
+    cpit->task = g_object_ref (task);
+    donna_task_set_pre_worker (task, (task_pre_fn) cp_preworker);
+
     if (_app)
         *_app = property->app;
 
@@ -2768,6 +3685,16 @@ custom_property_refresher (DonnaTask        *task,
     if (G_UNLIKELY (i >= property->nb_props))
         return FALSE;
 
+    if (!(task && g_object_get_data ((GObject *) task, DONNA_NODE_REFRESH_BYPASS_CACHE)))
+    {
+        DonnaPropCacheKey key;
+
+        if (cp_get_cache_key (property, node, &key)
+                && cp_set_value_from_cache (property, cpr.single.num_prop,
+                    node, &key))
+            return TRUE;
+    }
+
     t = (DonnaTask *) cp_get_task_process (&cpr);
     if (G_UNLIKELY (!t))
         return FALSE;
@@ -3660,29 +4587,186 @@ donna_app_get_environ (DonnaApp       *app)
     return app->priv->environ;
 }
 
-static gboolean
-intrefs_remove (gchar *key, struct intref *ir, gpointer data)
+/**
+ * donna_app_get_custom_properties_stats:
+ * @app: The #DonnaApp
+ *
+ * Returns a description of how refreshes of custom properties were batched:
+ * for each property (or group), the number of processes started, the number of
+ * nodes sent to them (average & max per process) and the time spent running
+ * said processes.
+ *
+ * See #custom-properties for more.
+ *
+ * Returns: (transfer full): A newly allocated string, free it with g_free()
+ * when done
+ */
+gchar *
+donna_app_get_custom_properties_stats (DonnaApp       *app)
+{
+    DonnaAppPrivate *priv;
+    GString *str;
+    guint i;
+
+    g_return_val_if_fail (DONNA_IS_APP (app), NULL);
+    priv = app->priv;
+
+    str = g_string_new (NULL);
+
+    /* we need the lock to use property->stats */
+    app_lock (app, LOCK_PROVIDERS_WRITE);
+    for (i = 0; i < priv->providers->len; ++i)
+    {
+        struct provider *p;
+        guint j;
+
+        p = &g_array_index (priv->providers, struct provider, i);
+        if (!p->custom_properties)
+            continue;
+
+        for (j = 0; j < p->custom_properties->len; ++j)
+        {
+            struct custom_properties *cp;
+            guint k;
+
+            cp = &g_array_index (p->custom_properties, struct custom_properties, j);
+            for (k = 0; k < cp->properties->len; ++k)
+            {
+                struct property *prop = cp->properties->pdata[k];
+                struct cp_stats *st = &prop->stats;
+
+                g_string_append_printf (str, "%s:%s%s: %u batches, "
+                        "%" G_GUINT64_FORMAT " nodes (avg %" G_GUINT64_FORMAT
+                        ", max %u), %" G_GINT64_FORMAT " ms (avg %" G_GINT64_FORMAT
+                        "), %u running, %u queued\n",
+                        p->domain,
+                        prop->properties[0].name,
+                        (prop->nb_props > 1) ? " (group)" : "",
+                        st->nb_batches,
+                        st->nb_nodes,
+                        (st->nb_batches > 0) ? st->nb_nodes / st->nb_batches : 0,
+                        st->max_nodes,
+                        st->time / 1000,
+                        (st->nb_batches > 0) ? st->time / 1000 / st->nb_batches : 0,
+                        prop->nb_running,
+                        (prop->items) ? prop->items->len : 0);
+            }
+        }
+    }
+    app_unlock (app, LOCK_PROVIDERS_WRITE);
+
+    return g_string_free (str, FALSE);
+}
+
+/* must be called with LOCK_INTREFS */
+static void
+intref_schedule (DonnaAppPrivate *priv, guint slot, guint gen, guint ticks)
 {
-    /* remove after 15min */
-    return ir->last + (G_USEC_PER_SEC * 60 * 15) - g_get_monotonic_time () <= 0;
+    struct intref_expiry ie = { slot, gen };
+    guint b;
+
+    b = (priv->intrefs_tick + ticks) % INTREFS_WHEEL_SIZE;
+    if (!priv->intrefs_wheel[b])
+        priv->intrefs_wheel[b] = g_array_new (FALSE, FALSE,
+                sizeof (struct intref_expiry));
+    g_array_append_val (priv->intrefs_wheel[b], ie);
 }
 
 static gboolean
 intrefs_gc (DonnaApp *app)
 {
     DonnaAppPrivate *priv = app->priv;
+    GArray *bucket;
     gboolean keep_going;
+    guint i;
 
     app_lock (app, LOCK_INTREFS);
-    g_hash_table_foreach_remove (priv->intrefs, (GHRFunc) intrefs_remove, NULL);
-    keep_going = g_hash_table_size (priv->intrefs) > 0;
+    priv->intrefs_tick = (priv->intrefs_tick + 1) % INTREFS_WHEEL_SIZE;
+    bucket = priv->intrefs_wheel[priv->intrefs_tick];
+    priv->intrefs_wheel[priv->intrefs_tick] = NULL;
+
+    /* only look at intrefs scheduled for this tick, not the whole table */
+    if (bucket)
+    {
+        gint64 now = g_get_monotonic_time ();
+
+        for (i = 0; i < bucket->len; ++i)
+        {
+            struct intref_expiry *ie;
+            struct intref *ir;
+            gint64 left;
+
+            ie = &g_array_index (bucket, struct intref_expiry, i);
+            ir = &g_array_index (priv->intrefs, struct intref, ie->slot);
+            /* free-d (and maybe re-used) since */
+            if (!ir->ptr || ir->gen != ie->gen)
+                continue;
+
+            left = ir->last + INTREFS_EXPIRY - now;
+            if (left <= 0)
+                free_intref (priv, ie->slot);
+            else
+                /* was accessed since, check again once it could expire */
+                intref_schedule (priv, ie->slot, ie->gen,
+                        CLAMP (left / (G_USEC_PER_SEC * INTREFS_WHEEL_TICK) + 1,
+                            1, INTREFS_WHEEL_SIZE - 1));
+        }
+        g_array_free (bucket, TRUE);
+    }
+
+    DONNA_DEBUG (MEMORY, NULL,
+            g_debug ("Intrefs: %u live (pinning %u objects), %u slots",
+                priv->intrefs_live, priv->intrefs_pinned, priv->intrefs->len));
+
+    keep_going = priv->intrefs_live > 0;
     if (!keep_going)
+    {
+        /* anything left can only be stale entries */
+        for (i = 0; i < INTREFS_WHEEL_SIZE; ++i)
+            if (priv->intrefs_wheel[i])
+            {
+                g_array_free (priv->intrefs_wheel[i], TRUE);
+                priv->intrefs_wheel[i] = NULL;
+            }
         priv->intrefs_timeout = 0;
+    }
     app_unlock (app, LOCK_INTREFS);
 
     return keep_going;
 }
 
+/* parse handle "<slot.gen>" -- doesn't need any lock */
+static gboolean
+parse_intref (const gchar *intref, guint *slot, guint *gen)
+{
+    guint64 n;
+    gchar *e;
+
+    if (*intref != '<' || !g_ascii_isdigit (intref[1]))
+        return FALSE;
+    n = g_ascii_strtoull (intref + 1, &e, 10);
+    if (*e != '.' || !g_ascii_isdigit (e[1]) || n >= INTREF_NO_SLOT)
+        return FALSE;
+    *slot = (guint) n;
+    n = g_ascii_strtoull (e + 1, &e, 10);
+    if (e[0] != '>' || e[1] != '\0' || n > G_MAXUINT)
+        return FALSE;
+    *gen = (guint) n;
+    return TRUE;
+}
+
+/* must be called with LOCK_INTREFS */
+static inline struct intref *
+lookup_intref (DonnaAppPrivate *priv, guint slot, guint gen)
+{
+    struct intref *ir;
+
+    if (slot >= priv->intrefs->len)
+        return NULL;
+    ir = &g_array_index (priv->intrefs, struct intref, slot);
+    return (ir->ptr && ir->gen == gen) ? ir : NULL;
+}
+
 /**
  * donna_app_new_int_ref:
  * @app: The #DonnaApp
@@ -3701,7 +4785,7 @@ intrefs_gc (DonnaApp *app)
  * object in memory.
  *
  * Once created the intref can now be accessed via the returned string, which is
- * a number in between inequality signs. This string can be used to then
+ * made of two numbers (slot & generation) in between inequality signs. This string can be used to then
  * accessed the object in memory via (other) commands.
  *
  * It should be noted that all intrefs should be freed after use, and that as a
@@ -3718,6 +4802,8 @@ donna_app_new_int_ref (DonnaApp       *app,
 {
     DonnaAppPrivate *priv;
     struct intref *ir;
+    guint pinned;
+    guint slot;
     gchar *s;
 
     g_return_val_if_fail (DONNA_IS_APP (app), NULL);
@@ -3728,23 +4814,43 @@ donna_app_new_int_ref (DonnaApp       *app,
             || (type & DONNA_ARG_IS_ARRAY), NULL);
     priv = app->priv;
 
-    ir = g_new (struct intref, 1);
-    ir->type = type;
     if (type & DONNA_ARG_IS_ARRAY)
-        ir->ptr = g_ptr_array_ref (ptr);
-    else if (type & (DONNA_ARG_TYPE_TREE_VIEW | DONNA_ARG_TYPE_NODE
-                | DONNA_ARG_TYPE_TERMINAL))
-        ir->ptr = g_object_ref (ptr);
+    {
+        ptr = g_ptr_array_ref (ptr);
+        pinned = ((GPtrArray *) ptr)->len;
+    }
     else
-        ir->ptr = ptr;
-    ir->last = g_get_monotonic_time ();
+    {
+        ptr = g_object_ref (ptr);
+        pinned = 1;
+    }
 
-    s = g_strdup_printf ("<%u%u>", rand (), (guint) (gintptr) ir);
     app_lock (app, LOCK_INTREFS);
-    g_hash_table_insert (priv->intrefs, g_strdup (s), ir);
+    if (priv->intrefs_free != INTREF_NO_SLOT)
+    {
+        slot = priv->intrefs_free;
+        ir = &g_array_index (priv->intrefs, struct intref, slot);
+        priv->intrefs_free = ir->next_free;
+    }
+    else
+    {
+        slot = priv->intrefs->len;
+        g_array_set_size (priv->intrefs, slot + 1);
+        ir = &g_array_index (priv->intrefs, struct intref, slot);
+    }
+    ir->type    = type;
+    ir->ptr     = ptr;
+    ir->last    = g_get_monotonic_time ();
+    ir->pinned  = pinned;
+
+    ++priv->intrefs_live;
+    priv->intrefs_pinned += pinned;
+
+    s = g_strdup_printf ("<%u.%u>", slot, ir->gen);
+    intref_schedule (priv, slot, ir->gen, INTREFS_WHEEL_SIZE - 1);
     if (priv->intrefs_timeout == 0)
         priv->intrefs_timeout = g_timeout_add_seconds_full (G_PRIORITY_LOW,
-                60 * 15, /* 15min */
+                INTREFS_WHEEL_TICK,
                 (GSourceFunc) intrefs_gc, app, NULL);
     app_unlock (app, LOCK_INTREFS);
     return s;
@@ -3773,14 +4879,19 @@ donna_app_get_int_ref (DonnaApp       *app,
     DonnaAppPrivate *priv;
     struct intref *ir;
     gpointer ptr = NULL;
+    guint slot;
+    guint gen;
 
     g_return_val_if_fail (DONNA_IS_APP (app), NULL);
     g_return_val_if_fail (intref != NULL, NULL);
     g_return_val_if_fail (type != DONNA_ARG_TYPE_NOTHING, NULL);
     priv = app->priv;
 
+    if (!parse_intref (intref, &slot, &gen))
+        return NULL;
+
     app_lock (app, LOCK_INTREFS);
-    ir = g_hash_table_lookup (priv->intrefs, intref);
+    ir = lookup_intref (priv, slot, gen);
     if (ir && ir->type == type)
     {
         ir->last = g_get_monotonic_time ();
@@ -3814,15 +4925,23 @@ donna_app_free_int_ref (DonnaApp       *app,
                         const gchar    *intref)
 {
     DonnaAppPrivate *priv;
-    gboolean ret;
+    gboolean ret = FALSE;
+    guint slot;
+    guint gen;
 
     g_return_val_if_fail (DONNA_IS_APP (app), NULL);
     g_return_val_if_fail (intref != NULL, NULL);
     priv = app->priv;
 
+    if (!parse_intref (intref, &slot, &gen))
+        return FALSE;
+
     app_lock (app, LOCK_INTREFS);
-    /* frees key & value */
-    ret = g_hash_table_remove (priv->intrefs, intref);
+    if (lookup_intref (priv, slot, gen))
+    {
+        free_intref (priv, slot);
+        ret = TRUE;
+    }
     app_unlock (app, LOCK_INTREFS);
 
     return ret;
@@ -3914,16 +5033,44 @@ donna_app_parse_fl (DonnaApp       *app,
                     GPtrArray     **intrefs)
 {
     GError *err = NULL;
-    DonnaConfig *config = donna_app_peek_config (app);
+    DonnaAppPrivate *priv;
+    DonnaConfig *config;
+    struct user_parsed *up;
     GPtrArray *arr;
     GString *str = NULL;
     gchar *alias_suffix = NULL;
     gchar *fl = _fl;
     gchar *s;
     guint i;
+    guint version;
+    gboolean cacheable = TRUE;
 
     g_return_val_if_fail (DONNA_IS_APP (app), NULL);
     g_return_val_if_fail (fl != NULL, NULL);
+    priv = app->priv;
+    config = priv->config;
+
+    /* user parsing only depends on config (except for relative paths), so
+     * results are cached until config changes */
+    version = donna_config_get_version (config);
+    app_lock (app, LOCK_FLS);
+    if (priv->fls_version != version)
+    {
+        g_hash_table_remove_all (priv->fls);
+        priv->fls_version = version;
+    }
+    up = g_hash_table_lookup (priv->fls, fl);
+    if (up)
+    {
+        if (up->prefix)
+            str = g_string_new (up->prefix);
+        fl += up->skip;
+        alias_suffix = g_strdup (up->suffix);
+        app_unlock (app, LOCK_FLS);
+        cacheable = FALSE;
+        goto context_parsing;
+    }
+    app_unlock (app, LOCK_FLS);
 
     /* prefixes (cannot not start with a letter) */
     if (!((*fl >= 'a' && *fl <= 'z') || (*fl >= 'A' && *fl <= 'Z')))
@@ -4049,6 +5196,9 @@ prefix_done:
     {
         DonnaNode *node;
 
+        /* depends on current location */
+        cacheable = FALSE;
+
         node = donna_app_get_current_location (app, &err);
         if (!node)
         {
@@ -4101,6 +5251,25 @@ prefix_done:
 
 
 context_parsing:
+    if (cacheable)
+    {
+        up = g_slice_new (struct user_parsed);
+        up->prefix = (str) ? g_strdup (str->str) : NULL;
+        up->skip = (gsize) (fl - _fl);
+        up->suffix = g_strdup (alias_suffix);
+
+        app_lock (app, LOCK_FLS);
+        if (priv->fls_version == version)
+        {
+            if (g_hash_table_size (priv->fls) >= MAX_USER_PARSED)
+                g_hash_table_remove_all (priv->fls);
+            g_hash_table_insert (priv->fls, g_strdup (_fl), up);
+        }
+        else
+            free_user_parsed (up);
+        app_unlock (app, LOCK_FLS);
+    }
+
     /* context */
     if (context)
         donna_context_parse (context, 0, app, fl, &str, intrefs);
@@ -4129,6 +5298,8 @@ struct fir
     GPtrArray *intrefs;
     /* used when trigger node from socket */
     DonnaSocket *socket;
+    gchar *req_id;
+    gboolean stream;
 };
 
 static void
@@ -4144,6 +5315,7 @@ free_fir (struct fir *fir)
     }
     if (fir->socket)
         donna_socket_unref (fir->socket);
+    g_free (fir->req_id);
     if (!fir->is_stack)
         g_free (fir);
 }
@@ -4267,13 +5439,51 @@ donna_app_trigger_fl (DonnaApp       *app,
     g_return_val_if_fail (DONNA_IS_APP (app), NULL);
     g_return_val_if_fail (fl != NULL, NULL);
 
-    return trigger_fl (app, fl, intrefs, blocking, NULL, error);
-}
+    return trigger_fl (app, fl, intrefs, blocking, NULL, error);
+}
+
+static gint
+arr_str_cmp (gconstpointer a, gconstpointer b)
+{
+    return strcmp (* (const gchar **) a, * (const gchar **) b);
+}
+
+/* assumes lock LOCK_EVENTS */
+static struct event_handlers *
+load_event_handlers (DonnaApp *app, const gchar *key)
+{
+    DonnaAppPrivate *priv = app->priv;
+    struct event_handlers *eh;
+    GPtrArray *arr = NULL;
+    guint i;
+
+    eh = g_slice_new0 (struct event_handlers);
+    eh->ref_count = 1;
+
+    if (!donna_config_list_options (priv->config, &arr,
+                DONNA_CONFIG_OPTION_TYPE_OPTION, "%s", key))
+        return eh;
+
+    g_ptr_array_sort (arr, arr_str_cmp);
+    eh->names = g_new (gchar *, arr->len + 1);
+    eh->fls = g_new (gchar *, arr->len + 1);
+    for (i = 0; i < arr->len; ++i)
+    {
+        gchar *fl;
+
+        if (donna_config_get_string (priv->config, NULL, &fl,
+                    "%s/%s", key, arr->pdata[i]))
+        {
+            eh->names[eh->nb] = g_strdup (arr->pdata[i]);
+            eh->fls[eh->nb] = fl;
+            ++eh->nb;
+        }
+    }
+    eh->names[eh->nb] = NULL;
+    eh->fls[eh->nb] = NULL;
 
-static gint
-arr_str_cmp (gconstpointer a, gconstpointer b)
-{
-    return strcmp (* (const gchar **) a, * (const gchar **) b);
+    g_ptr_array_unref (arr);
+    return eh;
 }
 
 static gboolean
@@ -4284,48 +5494,81 @@ trigger_event (DonnaApp     *app,
                DonnaContext *context)
 {
     DonnaAppPrivate *priv = app->priv;
-    GPtrArray *arr = NULL;
+    struct event_handlers *eh;
+    gchar buf[255], *b = buf;
+    guint version;
     guint i;
 
-    if (!donna_config_list_options (priv->config, &arr,
-                DONNA_CONFIG_OPTION_TYPE_OPTION, "%s/events/%s", source, event))
+    if (snprintf (buf, 255, "%s/events/%s", source, event) >= 255)
+        b = g_strdup_printf ("%s/events/%s", source, event);
+
+    /* must be done before reading config; see donna_config_get_version() */
+    version = donna_config_get_version (priv->config);
+
+    /* dispatch tables are loaded from config once, and kept until config
+     * changes. This way events without handlers (most of them) only cost a
+     * lookup */
+    app_lock (app, LOCK_EVENTS);
+    if (G_UNLIKELY (!priv->events))
+    {
+        app_unlock (app, LOCK_EVENTS);
+        if (b != buf)
+            g_free (b);
         return FALSE;
+    }
+    if (priv->events_version != version)
+    {
+        g_hash_table_remove_all (priv->events);
+        priv->events_version = version;
+    }
+    eh = g_hash_table_lookup (priv->events, b);
+    if (!eh)
+    {
+        eh = load_event_handlers (app, b);
+        g_hash_table_insert (priv->events, (b == buf) ? g_strdup (b) : b, eh);
+        b = buf;
+    }
+    else if (b != buf)
+        g_free (b);
 
-    g_ptr_array_sort (arr, arr_str_cmp);
-    for (i = 0; i < arr->len; ++i)
+    if (eh->nb == 0)
+    {
+        app_unlock (app, LOCK_EVENTS);
+        return FALSE;
+    }
+    /* triggers are done without the lock, since they could emit events */
+    g_atomic_int_inc (&eh->ref_count);
+    app_unlock (app, LOCK_EVENTS);
+
+    for (i = 0; i < eh->nb; ++i)
     {
         GError *err = NULL;
         GPtrArray *intrefs = NULL;
+        gboolean ret;
         gchar *fl;
 
-        if (donna_config_get_string (priv->config, NULL, &fl,
-                    "%s/events/%s/%s",
-                    source, event, arr->pdata[i]))
+        fl = donna_app_parse_fl (app, g_strdup (eh->fls[i]), TRUE, context,
+                &intrefs);
+        if (!trigger_fl (app, fl, intrefs, is_confirm, &ret, &err))
+        {
+            donna_app_show_error (app, err,
+                    "Event '%s': Failed to trigger '%s'%s%s%s",
+                    event, eh->names[i],
+                    (*source != '\0') ? " from '" : "",
+                    (*source != '\0') ? source : "",
+                    (*source != '\0') ? "'" : "");
+            g_clear_error (&err);
+        }
+        else if (is_confirm && ret)
         {
-            gboolean ret;
-
-            fl = donna_app_parse_fl (app, fl, TRUE, context, &intrefs);
-            if (!trigger_fl (app, fl, intrefs, is_confirm, &ret, &err))
-            {
-                donna_app_show_error (app, err,
-                        "Event '%s': Failed to trigger '%s'%s%s%s",
-                        event, arr->pdata[i],
-                        (*source != '\0') ? " from '" : "",
-                        (*source != '\0') ? source : "",
-                        (*source != '\0') ? "'" : "");
-                g_clear_error (&err);
-            }
-            else if (is_confirm && ret)
-            {
-                g_free (fl);
-                g_ptr_array_unref (arr);
-                return TRUE;
-            }
             g_free (fl);
+            event_handlers_unref (eh);
+            return TRUE;
         }
+        g_free (fl);
     }
 
-    g_ptr_array_unref (arr);
+    event_handlers_unref (eh);
     return FALSE;
 }
 
@@ -4347,7 +5590,8 @@ trigger_event (DonnaApp     *app,
  *   was specified, else in "&lt;source&gt;/events/&lt;EVENT&gt;"
  *
  * All string options will be sorted by their names, then their values
- * contextually parsed and triggered.
+ * contextually parsed and triggered. (Options are only read once, and then
+ * cached until the configuration changes.)
  *
  * If @is_confirm is TRUE, commands triggered are expected to return an integer
  * value (or a string representation of one), 1 to abort or 0 to continue. Abort
@@ -4435,6 +5679,8 @@ struct menu_click
     gboolean             is_locale_based;
     DonnaSortOptions     options;
     gboolean             sort_special_first;
+    /* max number of items per menu, others go in a "More..." submenu */
+    gint                 page_size;
 };
 
 static void
@@ -4649,8 +5895,6 @@ struct load_submenu
     DonnaTask           *task;
     /* one for item, one for task */
     guint                ref_count;
-    /* if not, must be free-d. Else it's on stack, also we block the task */
-    gboolean             blocking;
     /* when item is destroyed, in case task is still running/being cancelled */
     gboolean             invalid;
 };
@@ -4662,9 +5906,7 @@ free_load_submenu (struct load_submenu *ls)
     {
         if (ls->own_mc)
             free_menu_click (ls->mc);
-        if (!ls->blocking)
-            /* if not blocking it was on stack */
-            g_slice_free (struct load_submenu, ls);
+        g_slice_free (struct load_submenu, ls);
     }
 }
 
@@ -4679,6 +5921,32 @@ item_destroy_cb (struct load_submenu *ls)
 
 static GtkWidget * load_menu (struct menu_click *mc);
 
+static void
+load_next_page (GtkMenuItem *item)
+{
+    struct menu_click *mc;
+    GtkWidget *menu;
+
+    g_signal_handlers_disconnect_by_func (item, load_next_page, NULL);
+    mc = g_object_steal_data ((GObject *) item, "menu-click");
+    if (G_UNLIKELY (!mc))
+        return;
+
+    /* the menu takes ownership of mc */
+    menu = load_menu (mc);
+
+    /* we're being selected, so we need to unselect to change the submenu */
+    gtk_menu_item_deselect (item);
+    gtk_menu_item_set_submenu (item, menu);
+    if (G_LIKELY (menu))
+        gtk_menu_item_select (item);
+    else
+    {
+        free_menu_click (mc);
+        gtk_widget_set_sensitive ((GtkWidget *) item, FALSE);
+    }
+}
+
 static void
 submenu_get_children_cb (DonnaTask           *task,
                          gboolean             timeout_called,
@@ -4736,11 +6004,16 @@ submenu_get_children_cb (DonnaTask           *task,
     if (arr->len == 0)
     {
 no_submenu:
-        gtk_menu_item_set_submenu (ls->item, NULL);
         if (ls->mc->submenus == DONNA_ENABLED_TYPE_ENABLED)
+        {
+            /* remove the "Please wait..." placeholder */
+            gtk_menu_item_deselect (ls->item);
+            gtk_menu_item_set_submenu (ls->item, NULL);
             gtk_widget_set_sensitive ((GtkWidget *) ls->item, FALSE);
+        }
         else if (ls->mc->submenus == DONNA_ENABLED_TYPE_COMBINE)
         {
+            gtk_menu_item_set_submenu (ls->item, NULL);
             donna_image_menu_item_set_is_combined ((DonnaImageMenuItem *) ls->item,
                     FALSE);
             if (!donna_image_menu_item_get_is_combined_sensitive (
@@ -4769,11 +6042,10 @@ no_submenu:
         goto no_submenu;
 
 set_menu:
-    /* see if the item is selected (if we're not TYPE_COMBINE then it can't be,
-     * since thje menu hasn't event been shown yet). If so, we need to unselect
-     * it before we can add/change (if timeout_called) the submenu */
-    is_selected = ls->mc->submenus == DONNA_ENABLED_TYPE_COMBINE
-        && (GtkWidget *) ls->item == gtk_menu_shell_get_selected_item (
+    /* see if the item is selected (loading is triggered when it gets selected,
+     * so it most likely is). If so, we need to unselect it before we can
+     * add/change (placeholder) the submenu */
+    is_selected = (GtkWidget *) ls->item == gtk_menu_shell_get_selected_item (
                 (GtkMenuShell *) gtk_widget_get_parent ((GtkWidget *) ls->item));
 
     if (is_selected)
@@ -4787,7 +6059,8 @@ set_menu:
 static void
 submenu_get_children_timeout (DonnaTask *task, struct load_submenu *ls)
 {
-    if (!ls->invalid)
+    /* TYPE_ENABLED already has its placeholder set */
+    if (!ls->invalid && !gtk_menu_item_get_submenu (ls->item))
         donna_image_menu_item_set_loading_submenu (
                 (DonnaImageMenuItem *) ls->item, NULL);
 }
@@ -4798,8 +6071,7 @@ load_submenu (struct load_submenu *ls)
     DonnaNode *node;
     DonnaTask *task;
 
-    if (!ls->blocking)
-        g_signal_handlers_disconnect_by_func (ls->item, load_submenu, ls);
+    g_signal_handlers_disconnect_by_func (ls->item, load_submenu, ls);
 
     node = g_object_get_data ((GObject *) ls->item, "node");
     if (!node)
@@ -4810,27 +6082,16 @@ load_submenu (struct load_submenu *ls)
             : ls->mc->node_type,
             NULL);
 
-    if (ls->blocking)
-        g_object_ref (task);
-    else
-    {
-        donna_task_set_callback (task,
-                (task_callback_fn) submenu_get_children_cb,
-                ls, (GDestroyNotify) free_load_submenu);
-        donna_task_set_timeout (task, /*FIXME*/ 800,
-                (task_timeout_fn) submenu_get_children_timeout, ls, NULL);
-    }
+    donna_task_set_callback (task,
+            (task_callback_fn) submenu_get_children_cb,
+            ls, (GDestroyNotify) free_load_submenu);
+    donna_task_set_timeout (task, /*FIXME*/ 800,
+            (task_timeout_fn) submenu_get_children_timeout, ls, NULL);
 
     g_atomic_int_inc (&ls->ref_count);
     ls->task = task;
 
     donna_app_run_task (ls->mc->app, task);
-    if (ls->blocking)
-    {
-        donna_task_wait_for_it (task, NULL, NULL);
-        submenu_get_children_cb (task, FALSE, ls);
-        g_object_unref (task);
-    }
 }
 
 #define get_boolean(var, option, def_val)   do {                \
@@ -4905,6 +6166,9 @@ load_mc (DonnaApp *app, const gchar *name, GPtrArray *nodes)
     get_boolean (b, "can_children_menu", TRUE);
     mc->can_children_menu = b;
 
+    get_int (i, "page_size", 250);
+    mc->page_size = MAX (i, 0);
+
     get_boolean (b, "sort", FALSE);
     mc->is_sorted = b;
     if (mc->is_sorted)
@@ -4988,6 +6252,7 @@ load_menu (struct menu_click *mc)
     GtkIconTheme *theme;
     GtkWidget *menu;
     guint last_sep;
+    guint end;
     guint i;
     gboolean has_items = FALSE;
 
@@ -4996,18 +6261,24 @@ load_menu (struct menu_click *mc)
 
     menu = gtk_menu_new ();
 
+    /* only page_size items are loaded, the rest will be in a submenu */
+    end = mc->nodes->len;
+    if (mc->page_size > 0 && end > (guint) mc->page_size)
+        end = (guint) mc->page_size;
+
     /* in case the last few "nodes" are all NULLs, make sure we don't feature
      * any separators */
-    for (last_sep = mc->nodes->len - 1;
+    for (last_sep = end - 1;
             last_sep > 0 && !mc->nodes->pdata[last_sep];
             --last_sep)
         ;
 
     theme = gtk_icon_theme_get_default ();
-    for (i = 0; i < mc->nodes->len; ++i)
+    for (i = 0; i < end; ++i)
     {
         DonnaNode *node = mc->nodes->pdata[i];
         GtkWidget *item;
+        gboolean has_placeholder = FALSE;
 
         if (!node)
         {
@@ -5197,38 +6468,8 @@ load_menu (struct menu_click *mc)
                     }
                 }
 
-                if (submenus == DONNA_ENABLED_TYPE_ENABLED)
-                {
-                    struct load_submenu ls = { 0, };
-
-                    ls.blocking = TRUE;
-                    ls.mc       = mc;
-                    ls.sub_mc   = sub_mc;
-                    ls.item     = (GtkMenuItem *) item;
-
-                    if (submenus != mc->submenus)
-                    {
-                        if (!sub_mc)
-                        {
-                            /* load the sub_mc now, since we'll change option
-                             * submenus in mc */
-                            ls.sub_mc           = g_slice_new0 (struct menu_click);
-                            memcpy (ls.sub_mc, mc, sizeof (struct menu_click));
-                            ls.sub_mc->name     = g_strdup (mc->name);
-                            ls.sub_mc->nodes    = NULL;
-                        }
-
-                        ls.own_mc       = TRUE;
-                        ls.mc           = g_slice_new0 (struct menu_click);
-                        memcpy (ls.mc, mc, sizeof (struct menu_click));
-                        ls.mc->name     = NULL;
-                        ls.mc->nodes    = NULL;
-                        ls.mc->submenus = submenus;
-                    }
-
-                    load_submenu (&ls);
-                }
-                else if (submenus == DONNA_ENABLED_TYPE_COMBINE)
+                if (submenus == DONNA_ENABLED_TYPE_ENABLED
+                        || submenus == DONNA_ENABLED_TYPE_COMBINE)
                 {
                     struct load_submenu *ls;
 
@@ -5258,9 +6499,21 @@ load_menu (struct menu_click *mc)
                         ls->mc->submenus = submenus;
                     }
 
-                    donna_image_menu_item_set_is_combined (imi, TRUE);
-                    g_signal_connect_swapped (item, "load-submenu",
-                            (GCallback) load_submenu, ls);
+                    if (submenus == DONNA_ENABLED_TYPE_ENABLED)
+                    {
+                        /* children are only loaded once the item gets
+                         * selected, i.e. when the submenu is about to be shown.
+                         * Until then it gets a placeholder (once attached) */
+                        has_placeholder = TRUE;
+                        g_signal_connect_swapped (item, "select",
+                                (GCallback) load_submenu, ls);
+                    }
+                    else
+                    {
+                        donna_image_menu_item_set_is_combined (imi, TRUE);
+                        g_signal_connect_swapped (item, "load-submenu",
+                                (GCallback) load_submenu, ls);
+                    }
                     g_signal_connect_swapped (item, "destroy",
                             (GCallback) item_destroy_cb, ls);
                 }
@@ -5276,6 +6529,38 @@ load_menu (struct menu_click *mc)
 
         gtk_widget_show (item);
         gtk_menu_attach ((GtkMenu *) menu, item, 0, 1, i, i + 1);
+        if (has_placeholder)
+            donna_image_menu_item_set_loading_submenu (
+                    (DonnaImageMenuItem *) item, NULL);
+        has_items = TRUE;
+    }
+
+    if (end < mc->nodes->len)
+    {
+        struct menu_click *more_mc;
+        GtkWidget *item;
+
+        /* remaining nodes go into a "More..." submenu, only loaded when needed */
+        more_mc = g_slice_new0 (struct menu_click);
+        memcpy (more_mc, mc, sizeof (struct menu_click));
+        more_mc->name       = g_strdup (mc->name);
+        /* the whole array was already sorted */
+        more_mc->is_sorted  = FALSE;
+        more_mc->nodes      = g_ptr_array_new_full (mc->nodes->len - end,
+                (GDestroyNotify) donna_g_object_unref);
+        for (i = end; i < mc->nodes->len; ++i)
+            g_ptr_array_add (more_mc->nodes, (mc->nodes->pdata[i])
+                    ? g_object_ref (mc->nodes->pdata[i]) : NULL);
+
+        item = donna_image_menu_item_new_with_label ("More...");
+        g_object_set_data_full ((GObject *) item, "menu-click", more_mc,
+                (GDestroyNotify) free_menu_click);
+        g_signal_connect (item, "select", (GCallback) load_next_page, NULL);
+
+        gtk_widget_show (item);
+        gtk_menu_attach ((GtkMenu *) menu, item, 0, 1, end, end + 1);
+        donna_image_menu_item_set_loading_submenu ((DonnaImageMenuItem *) item,
+                NULL);
         has_items = TRUE;
     }
 
@@ -5361,6 +6646,9 @@ gtk_menu_popup_and_destroy (GtkMenu             *menu,
  *   property to overwrite option `submenus` Defaults to true
  * - `can_children_menu` (boolean): Whether to use node's `menu-menu` property
  *   to overwrite @menu
+ * - `page_size` (integer): Maximum number of items in a menu; Remaining ones
+ *   will be put in a "More..." submenu (itself limited the same way). Use 0
+ *   for no limit. Defaults to 250
  * - `sort` (boolean): Whether to sort nodes in menu. See #ct-name-options for
  *   sort-related options. Defaults to false
  *
@@ -6216,6 +7504,10 @@ status_provider_create_status (DonnaStatusProvider    *sp,
     struct status_donna sd = { 0, };
 
     sd.name = g_strdup (_name);
+    sd.h_format = donna_config_get_handle (priv->config,
+            "statusbar/%s/format", sd.name);
+    sd.h_format_tooltip = donna_config_get_handle (priv->config,
+            "statusbar/%s/format_tooltip", sd.name);
 
     app_lock (app, LOCK_STATUS);
     if (!priv->status_donna)
@@ -6247,6 +7539,8 @@ status_provider_free_status (DonnaStatusProvider    *sp,
         if (sd->id == id)
         {
             g_free (sd->name);
+            donna_config_handle_free (sd->h_format);
+            donna_config_handle_free (sd->h_format_tooltip);
             if (sd->sid_log > 0)
                 g_signal_handler_disconnect (sp, sd->sid_log);
             if (sd->sce_timeout > 0)
@@ -6344,8 +7638,7 @@ status_provider_render (DonnaStatusProvider    *sp,
         GString *str = NULL;
         gchar *fmt;
 
-        if (!donna_config_get_string (priv->config, NULL, &fmt,
-                    "statusbar/%s/format", sd->name))
+        if (!donna_config_handle_get_string (sd->h_format, &fmt))
         {
             app_unlock (app, LOCK_STATUS);
             g_object_set (renderer, "visible", FALSE, NULL);
@@ -6399,8 +7692,7 @@ status_provider_set_tooltip (DonnaStatusProvider    *sp,
         return TRUE;
     }
 
-    if (!donna_config_get_string (priv->config, NULL, &fmt,
-                "statusbar/%s/format_tooltip", sd->name))
+    if (!donna_config_handle_get_string (sd->h_format_tooltip, &fmt))
     {
         app_unlock (app, LOCK_STATUS);
         return FALSE;
@@ -6419,6 +7711,21 @@ status_provider_set_tooltip (DonnaStatusProvider    *sp,
 
 /* DONNATELLA */
 
+struct arr_cache
+{
+    /* config version the arrangements were loaded at */
+    guint        version;
+    /* key (matching arrangements) -> DonnaArrangement */
+    GHashTable  *arrangements;
+};
+
+static void
+free_arr_cache (struct arr_cache *ac)
+{
+    g_hash_table_unref (ac->arrangements);
+    g_free (ac);
+}
+
 static DonnaArrangement *
 tree_select_arrangement (DonnaTreeView  *tree,
                          const gchar    *tv_name,
@@ -6427,6 +7734,7 @@ tree_select_arrangement (DonnaTreeView  *tree,
 {
     DonnaAppPrivate *priv = app->priv;
     DonnaArrangement *arr = NULL;
+    struct arr_cache *ac;
     GSList *list, *l;
     gchar _source[255];
     gchar *source[] = { _source, (gchar *) "arrangements" };
@@ -6435,13 +7743,26 @@ tree_select_arrangement (DonnaTreeView  *tree,
     gboolean is_first = TRUE;
     gchar buf[255], *b = buf;
     gchar *location;
+    GPtrArray *matches;
+    GString *key;
+    guint version;
 
     if (!node)
         return NULL;
 
+    /* must be done before reading config; see donna_config_get_version() */
+    version = donna_config_get_version (priv->config);
+
     if (snprintf (source[0], 255, "tree_views/%s/arrangements", tv_name) >= 255)
         source[0] = g_strdup_printf ("tree_views/%s/arrangements", tv_name);
 
+    /* first we only get all the arrangements matching (pairs source/name), in
+     * order. This is all that the resulting arrangement depends on, so it can
+     * be used as key in our cache, and loading from config only happens when
+     * it isn't there */
+    matches = g_ptr_array_new ();
+    key = g_string_new (NULL);
+
     for (i = 0; i < max; ++i)
     {
         gchar *sce;
@@ -6516,41 +7837,74 @@ tree_select_arrangement (DonnaTreeView  *tree,
 
             if (donna_pattern_is_match (argmt->pattern, b))
             {
-                if (!arr)
-                {
-                    arr = g_new0 (DonnaArrangement, 1);
-                    arr->priority = DONNA_ARRANGEMENT_PRIORITY_NORMAL;
-                }
+                g_ptr_array_add (matches, sce);
+                g_ptr_array_add (matches, argmt->name);
+                g_string_append_printf (key, "%u/%s,", i, argmt->name);
+            }
+        }
+
+        /* at this point type can only be ENABLED or COMBINE */
+        if (type == DONNA_ENABLED_TYPE_ENABLED)
+            break;
+    }
+
+    if (matches->len == 0)
+        goto done;
+
+    ac = g_object_get_data ((GObject *) tree, "arrangements-cache");
+    if (!ac)
+    {
+        ac = g_new (struct arr_cache, 1);
+        ac->version = version;
+        ac->arrangements = g_hash_table_new_full (g_str_hash, g_str_equal,
+                g_free, (GDestroyNotify) _donna_tree_view_free_arrangement);
+        g_object_set_data_full ((GObject *) tree, "arrangements-cache",
+                ac, (GDestroyNotify) free_arr_cache);
+    }
+    else if (ac->version != version)
+    {
+        g_hash_table_remove_all (ac->arrangements);
+        ac->version = version;
+    }
 
-                if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS))
-                    donna_config_arr_load_columns (priv->config, arr,
-                            "%s/%s", sce, argmt->name);
+    arr = g_hash_table_lookup (ac->arrangements, key->str);
+    if (arr)
+    {
+        arr = _donna_tree_view_dup_arrangement (arr);
+        goto done;
+    }
 
-                if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SORT))
-                    donna_config_arr_load_sort (priv->config, arr,
-                            "%s/%s", sce, argmt->name);
+    arr = g_new0 (DonnaArrangement, 1);
+    arr->priority = DONNA_ARRANGEMENT_PRIORITY_NORMAL;
 
-                if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SECOND_SORT))
-                    donna_config_arr_load_second_sort (priv->config, arr,
-                            "%s/%s", sce, argmt->name);
+    for (i = 0; i < matches->len; i += 2)
+    {
+        const gchar *sce  = matches->pdata[i];
+        const gchar *name = matches->pdata[i + 1];
 
-                if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS_OPTIONS))
-                    donna_config_arr_load_columns_options (priv->config, arr,
-                            "%s/%s", sce, argmt->name);
+        if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS))
+            donna_config_arr_load_columns (priv->config, arr,
+                    "%s/%s", sce, name);
 
-                if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLOR_FILTERS))
-                    donna_config_arr_load_color_filters (priv->config,
-                            app, arr,
-                            "%s/%s", sce, argmt->name);
+        if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SORT))
+            donna_config_arr_load_sort (priv->config, arr,
+                    "%s/%s", sce, name);
 
-                if ((arr->flags & DONNA_ARRANGEMENT_HAS_ALL) == DONNA_ARRANGEMENT_HAS_ALL)
-                    break;
-            }
-        }
-        /* at this point type can only be ENABLED or COMBINE */
-        if (type == DONNA_ENABLED_TYPE_ENABLED || (arr /* could still be NULL */
-                    /* even in COMBINE, if arr is "full" we're done */
-                    && (arr->flags & DONNA_ARRANGEMENT_HAS_ALL) == DONNA_ARRANGEMENT_HAS_ALL))
+        if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SECOND_SORT))
+            donna_config_arr_load_second_sort (priv->config, arr,
+                    "%s/%s", sce, name);
+
+        if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS_OPTIONS))
+            donna_config_arr_load_columns_options (priv->config, arr,
+                    "%s/%s", sce, name);
+
+        if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLOR_FILTERS))
+            donna_config_arr_load_color_filters (priv->config,
+                    app, arr,
+                    "%s/%s", sce, name);
+
+        /* even in COMBINE, if arr is "full" we're done */
+        if ((arr->flags & DONNA_ARRANGEMENT_HAS_ALL) == DONNA_ARRANGEMENT_HAS_ALL)
             break;
     }
 
@@ -6559,6 +7913,14 @@ tree_select_arrangement (DonnaTreeView  *tree,
      * from other arrangements). We still don't set the flag, so that treeview
      * can keep combining with its own color filters */
 
+    g_hash_table_insert (ac->arrangements, g_string_free (key, FALSE),
+            _donna_tree_view_dup_arrangement (arr));
+    key = NULL;
+
+done:
+    if (key)
+        g_string_free (key, TRUE);
+    g_ptr_array_unref (matches);
     if (b != buf)
         g_free (b);
     if (source[0] != _source)
@@ -7505,6 +8867,7 @@ load_custom_properties (DonnaApp *app)
             struct property *prop;
             struct prop_def *pd;
             gboolean is_group;
+            gint val;
 
             prop = g_malloc0 (sizeof (struct property) + sizeof (struct prop_def));
             prop->nb_props = 1;
@@ -7528,6 +8891,41 @@ load_custom_properties (DonnaApp *app)
                     "custom_properties/%s/%s/preload",
                     (gchar *) arr->pdata[i],
                     (gchar *) arr_props->pdata[j]);
+            donna_config_get_boolean (priv->config, NULL, &prop->cache,
+                    "custom_properties/%s/%s/cache",
+                    (gchar *) arr->pdata[i],
+                    (gchar *) arr_props->pdata[j]);
+            donna_config_get_boolean (priv->config, NULL, &prop->persistent,
+                    "custom_properties/%s/%s/persistent",
+                    (gchar *) arr->pdata[i],
+                    (gchar *) arr_props->pdata[j]);
+            if (prop->cache && !priv->cp_cache)
+            {
+                gchar *filename;
+
+                filename = donna_app_get_conf_filename (app,
+                        "custom_properties.cache");
+                priv->cp_cache = donna_prop_cache_new (filename);
+                g_free (filename);
+            }
+            if (!donna_config_get_int (priv->config, NULL, &val,
+                        "custom_properties/%s/%s/batch_max",
+                        (gchar *) arr->pdata[i],
+                        (gchar *) arr_props->pdata[j]) || val <= 0)
+                val = CP_DEF_BATCH_MAX;
+            prop->batch_max = (guint) val;
+            if (!donna_config_get_int (priv->config, NULL, &val,
+                        "custom_properties/%s/%s/batch_latency",
+                        (gchar *) arr->pdata[i],
+                        (gchar *) arr_props->pdata[j]) || val < 0)
+                val = CP_DEF_BATCH_LATENCY;
+            prop->batch_latency = (guint) val;
+            if (!donna_config_get_int (priv->config, NULL, &val,
+                        "custom_properties/%s/%s/max_running",
+                        (gchar *) arr->pdata[i],
+                        (gchar *) arr_props->pdata[j]) || val <= 0)
+                val = CP_DEF_MAX_RUNNING;
+            prop->max_running = (guint) val;
 
             if (donna_config_get_boolean (priv->config, NULL, &is_group,
                         "custom_properties/%s/%s/is_group",
@@ -7980,17 +9378,69 @@ load_conf (DonnaConfig *config, const gchar *dir)
 }
 
 static void
-_socket_send (DonnaSocket *socket, const gchar *fmt, ...)
+_socket_send (DonnaSocket *socket, const gchar *req_id, const gchar *fmt, ...)
 {
-    gchar *s;
+    GString *str;
     va_list va_args;
 
+    str = g_string_new (NULL);
+    if (req_id)
+        g_string_append_printf (str, "#%s ", req_id);
+
     va_start (va_args, fmt);
-    s = g_strdup_vprintf (fmt, va_args);
+    g_string_append_vprintf (str, fmt, va_args);
     va_end (va_args);
 
-    donna_socket_send (socket, s, (gsize) -1);
-    g_free (s);
+    donna_socket_send (socket, str->str, str->len);
+    g_string_free (str, TRUE);
+}
+
+/* nb of elements sent per DATA message */
+#define SOCKET_STREAM_CHUNK     256
+
+static void
+socket_stream_array (DonnaSocket    *socket,
+                     const gchar    *req_id,
+                     guint           id,
+                     DonnaArgType    type,
+                     GPtrArray      *arr)
+{
+    GString *str;
+    gsize prefix_len;
+    guint i;
+
+    str = g_string_new (NULL);
+    if (req_id)
+        g_string_append_printf (str, "#%s ", req_id);
+    g_string_append_printf (str, "DATA %u", id);
+    prefix_len = str->len;
+
+    /* an empty array still gets its (empty) DATA message, so the client can
+     * tell it apart from a task not returning an array */
+    if (arr->len == 0)
+        donna_socket_send (socket, str->str, str->len);
+
+    for (i = 0; i < arr->len; ++i)
+    {
+        /* elements can contain anything (e.g. newlines in filenames), but
+         * not NUL bytes */
+        g_string_append_c (str, '\0');
+        if (type & DONNA_ARG_TYPE_NODE)
+        {
+            gchar *fl = donna_node_get_full_location (arr->pdata[i]);
+            g_string_append (str, fl);
+            g_free (fl);
+        }
+        else
+            g_string_append (str, arr->pdata[i]);
+
+        if ((i + 1) % SOCKET_STREAM_CHUNK == 0 || i + 1 == arr->len)
+        {
+            donna_socket_send (socket, str->str, str->len);
+            g_string_truncate (str, prefix_len);
+        }
+    }
+    g_string_free (str, TRUE);
 }
 
 static void
@@ -8039,8 +9489,14 @@ cmd_trigger_cb (DonnaTask *task, gboolean timeout_called, struct fir *fir)
                 /* array of nodes/strings */
                 if (t && (t & DONNA_ARG_IS_ARRAY)
                         && (t & (DONNA_ARG_TYPE_NODE | DONNA_ARG_TYPE_STRING)))
-                    s = free_me = donna_app_new_int_ref (fir->app,
-                            t, g_value_get_boxed (v));
+                {
+                    if (fir->stream)
+                        socket_stream_array (fir->socket, fir->req_id, id, t,
+                                g_value_get_boxed (v));
+                    else
+                        s = free_me = donna_app_new_int_ref (fir->app,
+                                t, g_value_get_boxed (v));
+                }
             }
         }
     }
@@ -8053,7 +9509,7 @@ cmd_trigger_cb (DonnaTask *task, gboolean timeout_called, struct fir *fir)
             s = error->message;
     }
 
-    _socket_send (fir->socket, "%s %d%s%s",
+    _socket_send (fir->socket, fir->req_id, "%s %d%s%s",
             (state == DONNA_TASK_DONE) ? "DONE"
             : (state == DONNA_TASK_CANCELLED) ? "CANCELLED" : "FAILED",
             id,
@@ -8084,34 +9540,49 @@ idle_run_task (DonnaTask *task)
     return G_SOURCE_REMOVE;
 }
 
+/* Requests supported via socket:
+ *
+ * - VERSION : replies "OK VERSION <version>"
+ * - TRIGGER <fl> : replies "OK TRIGGER <id>" and, once the task is done, one of
+ *   "DONE <id> [<return value>]", "FAILED <id> [<error message>]" or
+ *   "CANCELLED <id>"
+ * - CANCEL <id> : cancels the task; replies "OK CANCEL <id>"
+ * - MODE <flags> : flags is a comma-separated list of "tagged" and/or "stream"
+ *   (or "none") ; replies "OK MODE"
+ *
+ * Any error is replied with "ERR <request> <error message>"
+ *
+ * In "tagged" mode, each request must be prefixed with "#<req-id> " where
+ * req-id is any string (without spaces) chosen by the client, and all replies
+ * to it (incl. DONE/FAILED/CANCELLED/DATA) will be prefixed the same way. This
+ * allows to pipeline requests, and match replies sent out of order.
+ * In "stream" mode, when a task returns an array of nodes or strings, instead
+ * of an intref the elements (full locations for nodes) are sent as one or more
+ * "DATA <id><NUL><elem1><NUL><elem2>..." before the DONE. An empty array is
+ * sent as a single "DATA <id>" with no elements.
+ *
+ * A message can hold multiple requests, separated by NUL bytes; They are then
+ * processed in order (as if each had been sent in its own message).
+ */
 static void
-socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
+socket_process_request (DonnaApp *app, struct socket *sck, gchar *message)
 {
     GError *err = NULL;
+    DonnaSocket *socket = sck->socket;
+    gchar *req_id = NULL;
+    gchar *sep = NULL;
     gchar *e;
-    struct socket *sck;
-    guint i;
-
-    /* find socket in our internal list */
-    for (i = 0; i < app->priv->sockets->len; ++i)
-    {
-        sck = &g_array_index (app->priv->sockets, struct socket, i);
-        if (sck->socket == socket)
-            break;
-    }
-    if (G_UNLIKELY (i >= app->priv->sockets->len))
-    {
-        g_critical ("Unable to find socket %p inside list of connected sockets "
-                "to process message '%s'",
-                socket, message);
-        return;
-    }
 
-    if (!message)
+    if (sck->tagged)
     {
-        /* closing socket; this will unref it as well. */
-        g_array_remove_index_fast (app->priv->sockets, i);
-        return;
+        if (*message != '#' || !(sep = strchr (message, ' ')) || sep == message + 1)
+        {
+            _socket_send (socket, NULL, "ERR %s Request ID missing", message);
+            return;
+        }
+        *sep = '\0';
+        req_id = message + 1;
+        message = sep + 1;
     }
 
     e = strchr (message, ' ');
@@ -8120,17 +9591,47 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
 
     if (streq (message, "VERSION"))
     {
-        gchar buf[42];
-
         if (e)
         {
-            _socket_send (socket, "ERR %s No arguments supported for '%s'",
+            _socket_send (socket, req_id, "ERR %s No arguments supported for '%s'",
                     message, message);
             goto done;
         }
 
-        g_snprintf (buf, 42, "OK VERSION %s", PACKAGE_VERSION);
-        donna_socket_send (socket, buf, (gsize) -1);
+        _socket_send (socket, req_id, "OK VERSION %s", PACKAGE_VERSION);
+    }
+    else if (streq (message, "MODE"))
+    {
+        gboolean tagged = FALSE;
+        gboolean stream = FALSE;
+        gchar **flags;
+        gchar **f;
+
+        if (!e)
+        {
+            _socket_send (socket, req_id, "ERR MODE Flags missing");
+            goto done;
+        }
+
+        flags = g_strsplit (e + 1, ",", -1);
+        for (f = flags; *f; ++f)
+        {
+            if (streq (*f, "tagged"))
+                tagged = TRUE;
+            else if (streq (*f, "stream"))
+                stream = TRUE;
+            else if (!streq (*f, "none"))
+            {
+                _socket_send (socket, req_id, "ERR MODE Invalid flag '%s'", *f);
+                g_strfreev (flags);
+                goto done;
+            }
+        }
+        g_strfreev (flags);
+
+        sck->tagged = tagged;
+        sck->stream = stream;
+        _socket_send (socket, req_id, "OK MODE");
     }
     else if (streq (message, "TRIGGER"))
     {
@@ -8142,8 +9643,8 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
 
         if (!e)
         {
-            donna_socket_send (socket, "ERR TRIGGER Full location to trigger missing",
-                    (gsize) -1);
+            _socket_send (socket, req_id,
+                    "ERR TRIGGER Full location to trigger missing");
             goto done;
         }
 
@@ -8153,7 +9654,8 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
         node = donna_app_get_node (app, fl, FALSE, &err);
         if (!node)
         {
-            _socket_send (socket, "ERR TRIGGER Failed to get node for '%s': %s",
+            _socket_send (socket, req_id,
+                    "ERR TRIGGER Failed to get node for '%s': %s",
                     fl, err->message);
             g_clear_error (&err);
             if (fl != e + 1)
@@ -8164,7 +9666,8 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
         task = donna_node_trigger_task (node, &err);
         if (G_UNLIKELY (!task))
         {
-            _socket_send (socket, "ERR TRIGGER Failed to trigger '%s': %s",
+            _socket_send (socket, req_id,
+                    "ERR TRIGGER Failed to trigger '%s': %s",
                     fl, err->message);
             g_clear_error (&err);
             if (fl != e + 1)
@@ -8200,9 +9703,11 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
         fir->app = app;
         fir->intrefs = intrefs;
         fir->socket = donna_socket_ref (socket);
+        fir->req_id = g_strdup (req_id);
+        fir->stream = sck->stream;
         donna_task_set_callback (task, (task_callback_fn) cmd_trigger_cb, fir, NULL);
 
-        _socket_send (socket, "OK TRIGGER %u", sck->last_id);
+        _socket_send (socket, req_id, "OK TRIGGER %u", sck->last_id);
         /* we run the task from an idle source to avoid possibly "blocking" the
          * current source. E.g. if the trigger was to call an UI command that
          * would start a new main loop, the main/UI thread might not be blocked,
@@ -8223,16 +9728,16 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
 
         if (!e)
         {
-            donna_socket_send (socket, "ERR CANCEL ID of triggered task missing",
-                    (gsize) -1);
+            _socket_send (socket, req_id,
+                    "ERR CANCEL ID of triggered task missing");
             goto done;
         }
 
         id = (guint) g_ascii_strtoull (e + 1, &s, 10);
         if (!s || *s != '\0')
         {
-            donna_socket_send (socket, "ERR CANCEL Invalid ID of triggered task",
-                    (gsize) -1);
+            _socket_send (socket, req_id,
+                    "ERR CANCEL Invalid ID of triggered task");
             goto done;
         }
 
@@ -8241,21 +9746,58 @@ socket_process (DonnaSocket *socket, gchar *message, DonnaApp *app)
             if (GPOINTER_TO_UINT (g_object_get_data (l->data, "donna-socket-task-id"))
                     == id)
             {
-                _socket_send (socket, "OK CANCEL %u", id);
+                _socket_send (socket, req_id, "OK CANCEL %u", id);
                 donna_task_cancel ((DonnaTask *) l->data);
                 break;
             }
         }
 
         if (!l)
-            _socket_send (socket, "ERR CANCEL No task with ID %u", id);
+            _socket_send (socket, req_id, "ERR CANCEL No task with ID %u", id);
     }
     else
-        _socket_send (socket, "ERR %s Unknown command", message);
+        _socket_send (socket, req_id, "ERR %s Unknown command", message);
 
 done:
     if (e)
         *e = ' ';
+    if (sep)
+        *sep = ' ';
+}
+
+static void
+socket_process (DonnaSocket *socket, gchar *message, gsize len, DonnaApp *app)
+{
+    struct socket *sck;
+    gchar *end;
+    guint i;
+
+    /* find socket in our internal list */
+    for (i = 0; i < app->priv->sockets->len; ++i)
+    {
+        sck = &g_array_index (app->priv->sockets, struct socket, i);
+        if (sck->socket == socket)
+            break;
+    }
+    if (G_UNLIKELY (i >= app->priv->sockets->len))
+    {
+        g_critical ("Unable to find socket %p inside list of connected sockets "
+                "to process message '%s'",
+                socket, message);
+        return;
+    }
+
+    if (!message)
+    {
+        /* closing socket; this will unref it as well. */
+        g_array_remove_index_fast (app->priv->sockets, i);
+        return;
+    }
+
+    /* there might be multiple requests, separated by NUL bytes */
+    for (end = message + len; message < end; message += strlen (message) + 1)
+        if (*message != '\0')
+            socket_process_request (app, sck, message);
 }
 
 static void
@@ -119,6 +119,8 @@ gchar *             donna_app_get_conf_filename     (DonnaApp       *app,
                                                      const gchar    *fmt,
                                                      ...);
 gchar **            donna_app_get_environ           (DonnaApp       *app);
+gchar *             donna_app_get_custom_properties_stats (
+                                                     DonnaApp       *app);
 gchar *             donna_app_new_int_ref           (DonnaApp       *app,
                                                      DonnaArgType    type,
                                                      gpointer        ptr);
@@ -168,6 +168,8 @@ struct tv_col_data
     gint8             which;
     gchar            *property;
     gchar            *format;
+    /* format compiled for render, NULL when (re)compilation is needed */
+    DonnaTimeFormat  *tf;
     DonnaAlign        align;
     DonnaTimeOptions  options;
     gint8             which_tooltip;
@@ -215,7 +217,10 @@ struct filter_data
 
 struct _DonnaColumnTypeTimePrivate
 {
-    DonnaApp *app;
+    DonnaApp        *app;
+    /* shared by all columns, "now" being reset once per frame */
+    DonnaTimeCache  *time_cache;
+    guint            sid_reset_now;
 };
 
 /* internal from columntype.c */
@@ -391,6 +396,7 @@ donna_column_type_time_init (DonnaColumnTypeTime *ct)
     ct->priv = G_TYPE_INSTANCE_GET_PRIVATE (ct,
             DONNA_TYPE_COLUMN_TYPE_TIME,
             DonnaColumnTypeTimePrivate);
+    ct->priv->time_cache = donna_time_cache_new ();
 }
 
 static void
@@ -403,6 +409,9 @@ ct_time_finalize (GObject *object)
             g_debug ("ColumnType 'time' finalizing"));
 
     g_object_unref (priv->app);
+    if (priv->sid_reset_now)
+        g_source_remove (priv->sid_reset_now);
+    donna_time_cache_free (priv->time_cache);
 
     /* chain up */
     G_OBJECT_CLASS (donna_column_type_time_parent_class)->finalize (object);
@@ -469,6 +478,13 @@ ct_time_get_options (DonnaColumnType    *ct,
     *nb_options = G_N_ELEMENTS (o);
 }
 
+static inline void
+reset_tf (struct tv_col_data *data)
+{
+    donna_time_format_free (data->tf);
+    data->tf = NULL;
+}
+
 static DonnaColumnTypeNeed
 ct_time_refresh_data (DonnaColumnType    *ct,
                       const gchar        *col_name,
@@ -519,6 +535,7 @@ ct_time_refresh_data (DonnaColumnType    *ct,
     {
         g_free (data->format);
         data->format = s;
+        reset_tf (data);
         need = DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
     else
@@ -561,6 +578,7 @@ ct_time_refresh_data (DonnaColumnType    *ct,
     {
         g_free ((gchar *) data->options.fluid_time_format);
         data->options.fluid_time_format = s;
+        reset_tf (data);
         need = DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
     else
@@ -573,6 +591,7 @@ ct_time_refresh_data (DonnaColumnType    *ct,
     {
         g_free ((gchar *) data->options.fluid_date_format);
         data->options.fluid_date_format = s;
+        reset_tf (data);
         need = DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
     else
@@ -584,6 +603,7 @@ ct_time_refresh_data (DonnaColumnType    *ct,
     if (is_set != data->options.fluid_short_weekday)
     {
         data->options.fluid_short_weekday = is_set;
+        reset_tf (data);
         need = DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
 
@@ -642,6 +662,7 @@ ct_time_free_data (DonnaColumnType    *ct,
 
     g_free (data->property);
     g_free (data->format);
+    donna_time_format_free (data->tf);
     g_free ((gchar *) data->options.age_fallback_format);
     g_free (data->property_tooltip);
     g_free (data->format_tooltip);
@@ -1538,6 +1559,14 @@ ct_time_set_value (DonnaColumnType    *ct,
     return set_value (data, value, node_ref, nodes, treeview, error);
 }
 
+static gboolean
+reset_now (DonnaColumnTypeTimePrivate *priv)
+{
+    donna_time_cache_reset_now (priv->time_cache);
+    priv->sid_reset_now = 0;
+    return G_SOURCE_REMOVE;
+}
+
 static GPtrArray *
 ct_time_render (DonnaColumnType    *ct,
                 gpointer            _data,
@@ -1545,11 +1574,13 @@ ct_time_render (DonnaColumnType    *ct,
                 DonnaNode          *node,
                 GtkCellRenderer    *renderer)
 {
+    DonnaColumnTypeTimePrivate *priv;
     struct tv_col_data *data = _data;
     DonnaNodeHasValue has;
     GValue value = G_VALUE_INIT;
     guint64 time;
     gdouble xalign = 0.0;
+    gchar buf[128];
     gchar *s;
 
     g_return_val_if_fail (DONNA_IS_COLUMN_TYPE_TIME (ct), NULL);
@@ -1591,7 +1622,22 @@ ct_time_render (DonnaColumnType    *ct,
         g_value_unset (&value);
     }
 
-    s = donna_print_time (time, data->format, &data->options);
+    priv = ((DonnaColumnTypeTime *) ct)->priv;
+    if (!data->tf)
+        data->tf = donna_time_format_new (data->format, &data->options);
+    /* all cells rendered in the same frame share the same "now", which gets
+     * reset from an idle source, i.e. once drawing is done */
+    if (!priv->sid_reset_now)
+        priv->sid_reset_now = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                (GSourceFunc) reset_now, priv, NULL);
+
+    if (donna_time_format_print (data->tf, priv->time_cache, time,
+                &data->options, buf, sizeof (buf)) < sizeof (buf))
+        s = buf;
+    else
+        s = donna_print_time_full (time, data->format, &data->options,
+                donna_time_cache_get_now (priv->time_cache));
+
     switch (data->align)
     {
         case DONNA_ALIGN_LEFT:
@@ -1612,7 +1658,8 @@ ct_time_render (DonnaColumnType    *ct,
             "xalign",       xalign,
             NULL);
     donna_renderer_set (renderer, "ellipsize-set", "xalign", NULL);
-    g_free (s);
+    if (s != buf)
+        g_free (s);
     return NULL;
 }
 
@@ -2274,6 +2321,7 @@ ct_time_set_option (DonnaColumnType    *ct,
         {
             g_free (data->format);
             data->format = g_strdup (* (gchar **) value);
+            reset_tf (data);
         }
         return DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
@@ -2414,6 +2462,7 @@ ct_time_set_option (DonnaColumnType    *ct,
         {
             g_free (c);
             data->options.fluid_time_format = g_strdup (* (gchar **) value);
+            reset_tf (data);
         }
         return DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
@@ -2435,6 +2484,7 @@ ct_time_set_option (DonnaColumnType    *ct,
         {
             g_free (c);
             data->options.fluid_date_format = g_strdup (* (gchar **) value);
+            reset_tf (data);
         }
         return DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
@@ -2453,7 +2503,10 @@ ct_time_set_option (DonnaColumnType    *ct,
             return DONNA_COLUMN_TYPE_NEED_NOTHING;
 
         if (value)
+        {
             data->options.fluid_short_weekday = * (gboolean *) value;
+            reset_tf (data);
+        }
         return DONNA_COLUMN_TYPE_NEED_REDRAW;
     }
 
@@ -1187,6 +1187,28 @@ cmd_config_try_get_string (DonnaTask *task, DonnaApp *app, gpointer *args)
     return DONNA_TASK_DONE;
 }
 
+/**
+ * custom_properties_get_stats:
+ *
+ * Returns statistics about how refreshes of custom properties were batched
+ *
+ * See donna_app_get_custom_properties_stats() for more.
+ *
+ * Returns: A description of the batching of custom properties refreshes, one
+ * line per property/group
+ */
+static DonnaTaskState
+cmd_custom_properties_get_stats (DonnaTask *task, DonnaApp *app, gpointer *args)
+{
+    GValue *v;
+
+    v = donna_task_grab_return_value (task);
+    g_value_init (v, G_TYPE_STRING);
+    g_value_take_string (v, donna_app_get_custom_properties_stats (app));
+    donna_task_release_return_value (task);
+    return DONNA_TASK_DONE;
+}
+
 enum exec_mode
 {
     EXEC_STANDARD = 0,
@@ -5065,6 +5087,66 @@ cmd_tv_load_tree_file (DonnaTask *task, DonnaApp *app, gpointer *args)
     return DONNA_TASK_DONE;
 }
 
+/**
+ * tv_load_tree_snapshot:
+ * @tree: A treeview
+ * @file: Name of the file
+ * @visuals: (allow-none): Which #tree-visuals to load from @file
+ *
+ * Loads the content of @tree from tree snapshot @file, saved using command
+ * tv_save_tree_snapshot()
+ *
+ * Unlike tv_load_tree_file() rows are loaded progressively, so the command
+ * is done before all rows have been added.
+ *
+ * @visuals can be one or more of "name", "icon", "box", "highlight",
+ * "click_mode", or simply "all" to quickly refer to all of them.
+ *
+ * See donna_tree_view_load_tree_snapshot() for more
+ */
+static DonnaTaskState
+cmd_tv_load_tree_snapshot (DonnaTask *task, DonnaApp *app, gpointer *args)
+{
+    GError *err = NULL;
+    DonnaTreeView *tree = args[0];
+    const gchar *file = args[1];
+    gchar *s_visuals = args[2]; /* opt */
+
+    const gchar *_s_visuals[] = { "name", "icon", "box", "highlight", "click_mode",
+        "all" };
+    DonnaTreeVisual _visuals[] = { DONNA_TREE_VISUAL_NAME, DONNA_TREE_VISUAL_ICON,
+        DONNA_TREE_VISUAL_BOX, DONNA_TREE_VISUAL_HIGHLIGHT,
+        DONNA_TREE_VISUAL_CLICK_MODE,
+        DONNA_TREE_VISUAL_NAME | DONNA_TREE_VISUAL_ICON | DONNA_TREE_VISUAL_BOX
+            | DONNA_TREE_VISUAL_HIGHLIGHT | DONNA_TREE_VISUAL_CLICK_MODE };
+    guint visuals;
+
+    if (s_visuals)
+    {
+        visuals = _get_flags (_s_visuals, _visuals, s_visuals);
+        if (visuals == (guint) -1)
+        {
+            donna_task_set_error (task, DONNA_COMMAND_ERROR,
+                    DONNA_COMMAND_ERROR_OTHER,
+                    "Command 'tv_load_tree_snapshot': Invalid visuals : '%s'; "
+                    "Must be (a '+'-separated combination of) 'name', 'icon', "
+                    "'box',' highlight', 'click_mode' and/or 'all'",
+                    s_visuals);
+            return DONNA_TASK_FAILED;
+        }
+    }
+    else
+        visuals = 0;
+
+    if (!donna_tree_view_load_tree_snapshot (tree, file, visuals, &err))
+    {
+        donna_task_take_error (task, err);
+        return DONNA_TASK_FAILED;
+    }
+
+    return DONNA_TASK_DONE;
+}
+
 /**
  * tv_maxi_collapse:
  * @tree: A treeview
@@ -5496,6 +5578,63 @@ cmd_tv_save_tree_file (DonnaTask *task, DonnaApp *app, gpointer *args)
     return DONNA_TASK_DONE;
 }
 
+/**
+ * tv_save_tree_snapshot:
+ * @tree: A treeview
+ * @file: Name of the file
+ * @visuals: (allow-none): Which #tree-visuals to save to @file
+ *
+ * Saves the tree @tree into a tree snapshot, so it can be loaded back later
+ * using command tv_load_tree_snapshot()
+ *
+ * @visuals can be one or more of "name", "icon", "box", "highlight",
+ * "click_mode", or simply "all" to quickly refer to all of them.
+ *
+ * See donna_tree_view_save_tree_snapshot() for more
+ */
+static DonnaTaskState
+cmd_tv_save_tree_snapshot (DonnaTask *task, DonnaApp *app, gpointer *args)
+{
+    GError *err = NULL;
+    DonnaTreeView *tree = args[0];
+    const gchar *file = args[1];
+    gchar *s_visuals = args[2]; /* opt */
+
+    const gchar *_s_visuals[] = { "name", "icon", "box", "highlight", "click_mode",
+        "all" };
+    DonnaTreeVisual _visuals[] = { DONNA_TREE_VISUAL_NAME, DONNA_TREE_VISUAL_ICON,
+        DONNA_TREE_VISUAL_BOX, DONNA_TREE_VISUAL_HIGHLIGHT,
+        DONNA_TREE_VISUAL_CLICK_MODE,
+        DONNA_TREE_VISUAL_NAME | DONNA_TREE_VISUAL_ICON | DONNA_TREE_VISUAL_BOX
+            | DONNA_TREE_VISUAL_HIGHLIGHT | DONNA_TREE_VISUAL_CLICK_MODE };
+    guint visuals;
+
+    if (s_visuals)
+    {
+        visuals = _get_flags (_s_visuals, _visuals, s_visuals);
+        if (visuals == (guint) -1)
+        {
+            donna_task_set_error (task, DONNA_COMMAND_ERROR,
+                    DONNA_COMMAND_ERROR_OTHER,
+                    "Command 'tv_save_tree_snapshot': Invalid visuals : '%s'; "
+                    "Must be (a '+'-separated combination of) 'name', 'icon', "
+                    "'box',' highlight', 'click_mode' and/or 'all'",
+                    s_visuals);
+            return DONNA_TASK_FAILED;
+        }
+    }
+    else
+        visuals = 0;
+
+    if (!donna_tree_view_save_tree_snapshot (tree, file, visuals, &err))
+    {
+        donna_task_take_error (task, err);
+        return DONNA_TASK_FAILED;
+    }
+
+    return DONNA_TASK_DONE;
+}
+
 /**
  * tv_selection:
  * @tree: A treeview
@@ -6281,6 +6420,10 @@ _donna_add_commands (GHashTable *commands)
     add_command (config_try_get_string, ++i, DONNA_TASK_VISIBILITY_INTERNAL_FAST,
             DONNA_ARG_TYPE_STRING);
 
+    i = -1;
+    add_command (custom_properties_get_stats, ++i, DONNA_TASK_VISIBILITY_INTERNAL_FAST,
+            DONNA_ARG_TYPE_STRING);
+
     i = -1;
     arg_type[++i] = DONNA_ARG_TYPE_STRING;
     arg_type[++i] = DONNA_ARG_TYPE_STRING | DONNA_ARG_IS_OPTIONAL;
@@ -6711,6 +6854,13 @@ _donna_add_commands (GHashTable *commands)
     add_command (tv_load_tree_file, ++i, DONNA_TASK_VISIBILITY_INTERNAL_GUI,
             DONNA_ARG_TYPE_NOTHING);
 
+    i = -1;
+    arg_type[++i] = DONNA_ARG_TYPE_TREE_VIEW;
+    arg_type[++i] = DONNA_ARG_TYPE_STRING;
+    arg_type[++i] = DONNA_ARG_TYPE_STRING | DONNA_ARG_IS_OPTIONAL;
+    add_command (tv_load_tree_snapshot, ++i, DONNA_TASK_VISIBILITY_INTERNAL_GUI,
+            DONNA_ARG_TYPE_NOTHING);
+
     i = -1;
     arg_type[++i] = DONNA_ARG_TYPE_TREE_VIEW;
     arg_type[++i] = DONNA_ARG_TYPE_ROW_ID;
@@ -6785,6 +6935,13 @@ _donna_add_commands (GHashTable *commands)
     add_command (tv_save_tree_file, ++i, DONNA_TASK_VISIBILITY_INTERNAL_GUI,
             DONNA_ARG_TYPE_NOTHING);
 
+    i = -1;
+    arg_type[++i] = DONNA_ARG_TYPE_TREE_VIEW;
+    arg_type[++i] = DONNA_ARG_TYPE_STRING;
+    arg_type[++i] = DONNA_ARG_TYPE_STRING | DONNA_ARG_IS_OPTIONAL;
+    add_command (tv_save_tree_snapshot, ++i, DONNA_TASK_VISIBILITY_INTERNAL_GUI,
+            DONNA_ARG_TYPE_NOTHING);
+
     i = -1;
     arg_type[++i] = DONNA_ARG_TYPE_TREE_VIEW;
     arg_type[++i] = DONNA_ARG_TYPE_STRING;
@@ -30,90 +30,94 @@
 #include "app.h"
 #include "macros.h"
 
-/**
- * donna_context_parse:
- * @context: The context to use for parsing
- * @options: The options for parsing
- * @app: The #DonnaApp (required to create intrefs)
- * @fmt: The string to parse
- * @str: (out): Location of a #GString (or %NULL) that will be used for parsing.
- * If @str points to %NULL the #GString will be created only when & if needed
- * @intrefs: (allow-none) (out): Return location for any intrefs created
- *
- * Performs contextual parsing of @fmt via @context
- *
- * Contextual parsing happens e.g. on actions, when certain variables (e.g. \%o,
- * etc) can be used in the full location/trigger, and need to be parsed before
- * processing.
- *
- * When processing such variables, it should be known that by default so-called
- * "intrefs" (for internal references) can be used; For example, if a variable
- * points to a node, an intref will be used. An intref is simply a string
- * referencing said node in memory.
- *
- * It is possible to "dereference" a variable, so that instead of using an
- * intref, the full location of the node will be used. This is done by using a
- * star after the percent sign, e.g. `\%*n`
- * This can be useful if it isn't meant to be used as a command argument, but
- * e.g. to be used as part of a string or something.
- * Additionally, you can also use a special dereferencing, using a colon
- * instead, e.g. `\%:n`
- * This will use the location for nodes in "fs", and skip/use empty string for
- * any node in another domain; Particularly useful for use in command line of
- * external process.
- *
- * If intrefs were created during said parsing (see donna_app_new_int_ref()) and
- * @intrefs is not %NULL, A #GPtrArray will be created and filled with string
- * representations of intrefs. This is intended to be then used by
- * donna_app_parse_fl() and then donna_app_trigger_fl() so intrefs are freed
- * afterwards.
- *
- * @options can be used to specified a default dereferencing mode. If more than
- * one is specified, #DONNA_CONTEXT_DEREFERENCE_FULL takes precedence over the
- * others, and #DONNA_CONTEXT_DEREFERENCE_FS takes precedence over
- * #DONNA_CONTEXT_DEREFERENCE_NONE. If none are specified,
- * #DONNA_CONTEXT_DEREFERENCE_NONE is used.
- *
- * If @context allows extra, between the percent sign and the variable there can
- * be a quote in between braquet, e.g: \%{foo}v
- * This would resolve as variable 'v' with "foo" as extra. Note that inside an
- * extra it is required to escape with a backslash any backslashe or closing
- * braquets, e.g. to use "foo}bar" as extra, use: \%{foo\}bar}v
- *
- * @str can point either to an existing #GString, or %NULL. In the former case,
- * it will be used as is, adding to it. If nothing needed to be done (e.g. no
- * variable used in @fmt) then @fmt will be added to the #GString.
- * In the later case, a #GString will only be created when & if needed, so if
- * nothing needed to be done it will still point to %NULL (indicating @fmt can
- * be used as is).
- *
- * In addition to the supported variable by @context, the percent sign can be
- * obtained by doubling it (i.e. using "\%\%"). Anything not supported will
- * simply be left as is, percent sign included.
- * Should resolving a variable fail, it will simply resolve to nothing/be
- * removed.
- */
-void
-donna_context_parse (DonnaContext       *context,
-                     DonnaContextOptions options,
-                     DonnaApp           *app,
-                     const gchar        *fmt,
-                     GString           **_str,
-                     GPtrArray         **intrefs)
+/* compiled template: the string split into segments, each being literal text
+ * possibly followed by a variable. Templates only depend on the string & the
+ * context (flags/allow_extra), so they're kept in a cache and the string only
+ * needs to be scanned once */
+struct segment
 {
-    GString *str = *_str;
+    /* literal text (from template's fmt) */
+    guint        start;
+    guint        len;
+    /* variable after it, or '\0' */
+    gchar        c;
+    /* dereference mode for the variable, or 0 for default */
+    guint        dereference;
+    gchar       *extra;
+};
+
+struct template
+{
+    /* key */
+    gchar       *flags;
+    gboolean     allow_extra;
+    gchar       *fmt;
+    /* segments */
+    GArray      *segments;
+    /* total length of literal text, to size the GString */
+    gsize        len;
+    /* nothing to do, i.e. fmt is used as is */
+    gboolean     is_plain;
+};
+
+/* max nb of templates in cache; when reached, the cache is emptied */
+#define MAX_TEMPLATES   512
+
+static GMutex       templates_mutex;
+static GHashTable  *templates = NULL;
+
+static guint
+template_hash (gconstpointer key)
+{
+    const struct template *tpl = key;
+
+    return g_str_hash (tpl->fmt) ^ g_str_hash (tpl->flags)
+        ^ (guint) tpl->allow_extra;
+}
+
+static gboolean
+template_equal (gconstpointer a, gconstpointer b)
+{
+    const struct template *t1 = a;
+    const struct template *t2 = b;
+
+    return t1->allow_extra == t2->allow_extra
+        && streq (t1->fmt, t2->fmt) && streq (t1->flags, t2->flags);
+}
+
+static void
+free_segment (struct segment *seg)
+{
+    g_free (seg->extra);
+}
+
+static void
+free_template (struct template *tpl)
+{
+    g_free (tpl->flags);
+    g_free (tpl->fmt);
+    g_array_free (tpl->segments, TRUE);
+    g_slice_free (struct template, tpl);
+}
+
+static struct template *
+compile_template (DonnaContext *context, const gchar *_fmt)
+{
+    struct template *tpl;
+    struct segment seg = { 0, };
+    const gchar *fmt;
     const gchar *s;
-    guint dereference_default;
-    gboolean moved = FALSE;
 
-    if (options & DONNA_CONTEXT_DEREFERENCE_FULL)
-        dereference_default = DONNA_CONTEXT_DEREFERENCE_FULL;
-    else if (options & DONNA_CONTEXT_DEREFERENCE_FS)
-        dereference_default = DONNA_CONTEXT_DEREFERENCE_FS;
-    else
-        dereference_default = DONNA_CONTEXT_DEREFERENCE_NONE;
+    tpl = g_slice_new0 (struct template);
+    tpl->flags = g_strdup (context->flags);
+    tpl->allow_extra = context->allow_extra;
+    tpl->fmt = g_strdup (_fmt);
+    tpl->segments = g_array_new (FALSE, FALSE, sizeof (struct segment));
+    g_array_set_clear_func (tpl->segments, (GDestroyNotify) free_segment);
+    tpl->is_plain = TRUE;
 
-    s = fmt;
+    /* we work on our copy, since segments point into it */
+    s = fmt = tpl->fmt;
     while ((s = strchr (s, '%')))
     {
         guint dereference;
@@ -134,7 +138,7 @@ donna_context_parse (DonnaContext       *context,
         }
         else
         {
-            dereference = dereference_default;
+            dereference = 0;
             pos = 0;
         }
 
@@ -184,14 +188,8 @@ donna_context_parse (DonnaContext       *context,
         match = e[1 + pos] != '\0' && strchr (context->flags, e[1 + pos]) != NULL;
         if (match)
         {
-            DonnaArgType type;
-            gpointer ptr;
-            GDestroyNotify destroy = NULL;
-
-            if (!str)
-                *_str = str = g_string_new (NULL);
-            moved = TRUE;
-            g_string_append_len (str, fmt, s - fmt);
+            tpl->is_plain = FALSE;
+            seg.len = (guint) (s - fmt) - seg.start;
 
             if (e != s)
                 /* adjust for extra */
@@ -200,213 +198,398 @@ donna_context_parse (DonnaContext       *context,
                 /* adjust for dereference operator, if any */
                 s += pos;
 
-            /* it can be FALSE when the variable doesn't actually resolve to
-             * anything, e.g. it's for a current location and there are none */
-            if (!context->conv (s[1], extra, &type, &ptr, &destroy, context->data))
-            {
-                s += 2;
-                fmt = s;
-                g_free (extra);
-                continue;
-            }
+            seg.c = s[1];
+            seg.dereference = dereference;
+            seg.extra = extra;
+            g_array_append_val (tpl->segments, seg);
+            tpl->len += seg.len;
+
+            s += 2;
+            seg.start = (guint) (s - fmt);
+            continue;
+        }
+        else if (s[1] == '%')
+        {
+            /* "%%" -> "%" : literal text up to (including) the first one */
+            tpl->is_plain = FALSE;
+            seg.len = (guint) (s - fmt) + 1 - seg.start;
+            seg.c = '\0';
+            seg.extra = NULL;
+            g_array_append_val (tpl->segments, seg);
+            tpl->len += seg.len;
+
+            s += 2;
+            seg.start = (guint) (s - fmt);
+        }
+        else if (s[1] == '\0')
+        {
+            g_free (extra);
+            break;
+        }
+        else
+            /* any unknown variable is left as-is, '%' included */
+            ++s;
 
-            /* we don't need to test for all possible types, only those can make
-             * sense. That is, it could be a ROW, but not a ROW_ID (or PATH)
-             * since those only make sense the other way around (or as type of
-             * ROW_ID) */
+        g_free (extra);
+    }
+
+    /* whatever is left */
+    seg.len = (guint) strlen (fmt + seg.start);
+    if (seg.len > 0)
+    {
+        seg.c = '\0';
+        seg.extra = NULL;
+        g_array_append_val (tpl->segments, seg);
+        tpl->len += seg.len;
+    }
+
+    return tpl;
+}
+
+/* returns the template for fmt, from cache or compiled (and added to cache).
+ * The template remains owned by the cache, and must only be used while holding
+ * templates_mutex */
+static struct template *
+get_template (DonnaContext *context, const gchar *fmt)
+{
+    struct template key;
+    struct template *tpl;
+
+    if (G_UNLIKELY (!templates))
+        templates = g_hash_table_new_full (template_hash, template_equal,
+                (GDestroyNotify) free_template, NULL);
+
+    key.flags = (gchar *) context->flags;
+    key.allow_extra = context->allow_extra;
+    key.fmt = (gchar *) fmt;
+    tpl = g_hash_table_lookup (templates, &key);
+    if (tpl)
+        return tpl;
+
+    if (g_hash_table_size (templates) >= MAX_TEMPLATES)
+        g_hash_table_remove_all (templates);
+
+    tpl = compile_template (context, fmt);
+    g_hash_table_add (templates, tpl);
+    return tpl;
+}
 
-            if (type & DONNA_ARG_TYPE_TREE_VIEW)
-                g_string_append (str, donna_tree_view_get_name ((DonnaTreeView *) ptr));
-            else if (type & DONNA_ARG_TYPE_ROW)
+static void
+append_var (DonnaContext       *context,
+            DonnaContextOptions options,
+            DonnaApp           *app,
+            GString            *str,
+            GPtrArray         **intrefs,
+            gchar               c,
+            gchar              *extra,
+            guint               dereference)
+{
+    DonnaArgType type;
+    gpointer ptr;
+    GDestroyNotify destroy = NULL;
+
+    /* it can be FALSE when the variable doesn't actually resolve to
+     * anything, e.g. it's for a current location and there are none */
+    if (!context->conv (c, extra, &type, &ptr, &destroy, context->data))
+        return;
+
+    /* we don't need to test for all possible types, only those can make
+     * sense. That is, it could be a ROW, but not a ROW_ID (or PATH)
+     * since those only make sense the other way around (or as type of
+     * ROW_ID) */
+    if (type & DONNA_ARG_TYPE_TREE_VIEW)
+        g_string_append (str, donna_tree_view_get_name ((DonnaTreeView *) ptr));
+    else if (type & DONNA_ARG_TYPE_ROW)
+    {
+        DonnaRow *row = (DonnaRow *) ptr;
+        if (dereference != DONNA_CONTEXT_DEREFERENCE_NONE)
+        {
+            gchar *l = NULL;
+
+            if (dereference == DONNA_CONTEXT_DEREFERENCE_FULL)
+                /* FULL = full location */
+                l = donna_node_get_full_location (row->node);
+            else if (streq (donna_node_get_domain (row->node), "fs"))
+                /* FS && domain "fs" = location */
+                l = donna_node_get_location (row->node);
+            else if (!(options & DONNA_CONTEXT_NO_QUOTES))
             {
-                DonnaRow *row = (DonnaRow *) ptr;
-                if (dereference != DONNA_CONTEXT_DEREFERENCE_NONE)
-                {
-                    gchar *l = NULL;
-
-                    if (dereference == DONNA_CONTEXT_DEREFERENCE_FULL)
-                        /* FULL = full location */
-                        l = donna_node_get_full_location (row->node);
-                    else if (streq (donna_node_get_domain (row->node), "fs"))
-                        /* FS && domain "fs" = location */
-                        l = donna_node_get_location (row->node);
-                    else if (!(options & DONNA_CONTEXT_NO_QUOTES))
-                    {
-                        /* FS && another domain == empty string */
-                        g_string_append_c (str, '"');
-                        g_string_append_c (str, '"');
-                    }
+                /* FS && another domain == empty string */
+                g_string_append_c (str, '"');
+                g_string_append_c (str, '"');
+            }
 
-                    if (l)
-                    {
-                        if (options & DONNA_CONTEXT_NO_QUOTES)
-                            g_string_append (str, l);
-                        else
-                            donna_g_string_append_quoted (str, l, FALSE);
-                        g_free (l);
-                    }
-                }
+            if (l)
+            {
+                if (options & DONNA_CONTEXT_NO_QUOTES)
+                    g_string_append (str, l);
                 else
-                    g_string_append_printf (str, "[%p;%p]", row->node, row->iter);
+                    donna_g_string_append_quoted (str, l, FALSE);
+                g_free (l);
             }
-            /* this will do nodes, array of nodes, array of strings */
-            else if (type & (DONNA_ARG_TYPE_NODE | DONNA_ARG_IS_ARRAY))
+        }
+        else
+            g_string_append_printf (str, "[%p;%p]", row->node, row->iter);
+    }
+    /* this will do nodes, array of nodes, array of strings */
+    else if (type & (DONNA_ARG_TYPE_NODE | DONNA_ARG_IS_ARRAY))
+    {
+        if (dereference != DONNA_CONTEXT_DEREFERENCE_NONE)
+        {
+            if (type & DONNA_ARG_IS_ARRAY)
             {
-                if (dereference != DONNA_CONTEXT_DEREFERENCE_NONE)
-                {
-                    if (type & DONNA_ARG_IS_ARRAY)
-                    {
-                        GPtrArray *arr = ptr;
-                        GString *string;
-                        GString *str_arr = NULL;
-                        gchar sep;
-                        guint i;
-
-                        if (dereference == DONNA_CONTEXT_DEREFERENCE_FS)
-                        {
-                            string = str;
-                            sep = ' ';
-                        }
-                        else
-                        {
-                            /* NO_QUOTES only means no quotes around the array
-                             * itself, but each element will still be quoted.
-                             * So, for DEREF_FULL and NO_QUOTES, we can add
-                             * directly into str */
-                            if (options & DONNA_CONTEXT_NO_QUOTES)
-                                string = str;
-                            else
-                                string = str_arr = g_string_new (NULL);
-                            sep = ',';
-                        }
+                GPtrArray *arr = ptr;
+                GString *string;
+                GString *str_arr = NULL;
+                gchar sep;
+                guint i;
 
-                        if (type & DONNA_ARG_TYPE_NODE)
-                            for (i = 0; i < arr->len; ++i)
-                            {
-                                DonnaNode *node = arr->pdata[i];
-                                gchar *l = NULL;
-
-                                if (dereference == DONNA_CONTEXT_DEREFERENCE_FULL)
-                                    l = donna_node_get_full_location (node);
-                                else if (streq (donna_node_get_domain (node), "fs"))
-                                    l = donna_node_get_location (node);
-                                /* no need to add a bunch of empty strings here */
-
-                                if (l)
-                                {
-                                    /* we always quote here.
-                                     * DONNA_CONTEXT_NO_QUOTES will only affect
-                                     * the quotes around the array as a whole */
-                                    donna_g_string_append_quoted (string, l, FALSE);
-                                    g_string_append_c (string, sep);
-                                    g_free (l);
-                                }
-                            }
-                        else
-                            for (i = 0; i < arr->len; ++i)
-                            {
-                                /* we always quote here.
-                                 * DONNA_CONTEXT_NO_QUOTES will only affect the
-                                 * quotes around the array as a whole */
-                                donna_g_string_append_quoted (string,
-                                        (gchar *) arr->pdata[i], FALSE);
-                                g_string_append_c (string, sep);
-                            }
-
-                        /* remove last sep */
-                        g_string_truncate (string, string->len - 1);
-
-                        /* DEREF_FULL && !NO_QUOTES */
-                        if (string != str)
-                        {
-                            /* str_arr is a list of quoted strings/FL, but we
-                             * also need to quote the list itself */
-                            donna_g_string_append_quoted (str, str_arr->str, FALSE);
-                            g_string_free (str_arr, TRUE);
-                        }
-                    }
+                if (dereference == DONNA_CONTEXT_DEREFERENCE_FS)
+                {
+                    string = str;
+                    sep = ' ';
+                }
+                else
+                {
+                    /* NO_QUOTES only means no quotes around the array
+                     * itself, but each element will still be quoted.
+                     * So, for DEREF_FULL and NO_QUOTES, we can add
+                     * directly into str */
+                    if (options & DONNA_CONTEXT_NO_QUOTES)
+                        string = str;
                     else
+                        string = str_arr = g_string_new (NULL);
+                    sep = ',';
+                }
+
+                if (type & DONNA_ARG_TYPE_NODE)
+                    for (i = 0; i < arr->len; ++i)
                     {
-                        DonnaNode *node = ptr;
+                        DonnaNode *node = arr->pdata[i];
                         gchar *l = NULL;
 
                         if (dereference == DONNA_CONTEXT_DEREFERENCE_FULL)
                             l = donna_node_get_full_location (node);
                         else if (streq (donna_node_get_domain (node), "fs"))
                             l = donna_node_get_location (node);
-                        else if (!(options & DONNA_CONTEXT_NO_QUOTES))
-                        {
-                            g_string_append_c (str, '"');
-                            g_string_append_c (str, '"');
-                        }
+                        /* no need to add a bunch of empty strings here */
 
                         if (l)
                         {
-                            if (options & DONNA_CONTEXT_NO_QUOTES)
-                                g_string_append (str, l);
-                            else
-                                donna_g_string_append_quoted (str, l, FALSE);
+                            /* we always quote here.
+                             * DONNA_CONTEXT_NO_QUOTES will only affect
+                             * the quotes around the array as a whole */
+                            donna_g_string_append_quoted (string, l, FALSE);
+                            g_string_append_c (string, sep);
                             g_free (l);
                         }
                     }
-                }
                 else
-                {
-                    gchar *ir = donna_app_new_int_ref (app, type, ptr);
-                    g_string_append (str, ir);
-                    if (intrefs)
+                    for (i = 0; i < arr->len; ++i)
                     {
-                        if (!*intrefs)
-                            *intrefs = g_ptr_array_new_with_free_func (g_free);
-                        g_ptr_array_add (*intrefs, ir);
+                        /* we always quote here.
+                         * DONNA_CONTEXT_NO_QUOTES will only affect the
+                         * quotes around the array as a whole */
+                        donna_g_string_append_quoted (string,
+                                (gchar *) arr->pdata[i], FALSE);
+                        g_string_append_c (string, sep);
                     }
-                    else
-                        g_free (ir);
+
+                /* remove last sep */
+                g_string_truncate (string, string->len - 1);
+
+                /* DEREF_FULL && !NO_QUOTES */
+                if (string != str)
+                {
+                    /* str_arr is a list of quoted strings/FL, but we
+                     * also need to quote the list itself */
+                    donna_g_string_append_quoted (str, str_arr->str, FALSE);
+                    g_string_free (str_arr, TRUE);
                 }
             }
-            else if (type & DONNA_ARG_TYPE_TERMINAL)
-                g_string_append (str, donna_terminal_get_name ((DonnaTerminal *) ptr));
-            else if (type & DONNA_ARG_TYPE_STRING)
+            else
             {
-                if (options & DONNA_CONTEXT_NO_QUOTES)
-                    g_string_append (str, (gchar *) ptr);
-                else
-                    donna_g_string_append_quoted (str, (gchar *) ptr, FALSE);
-            }
-            else if (type & DONNA_ARG_TYPE_INT)
-                g_string_append_printf (str, "%d", * (gint *) ptr);
-            else if (type & _DONNA_ARG_TYPE_CUSTOM)
-                ((conv_custom_fn) ptr) (s[1], extra, options, str, context->data);
+                DonnaNode *node = ptr;
+                gchar *l = NULL;
 
-            if (destroy)
-                destroy (ptr);
+                if (dereference == DONNA_CONTEXT_DEREFERENCE_FULL)
+                    l = donna_node_get_full_location (node);
+                else if (streq (donna_node_get_domain (node), "fs"))
+                    l = donna_node_get_location (node);
+                else if (!(options & DONNA_CONTEXT_NO_QUOTES))
+                {
+                    g_string_append_c (str, '"');
+                    g_string_append_c (str, '"');
+                }
 
-            s += 2;
-            fmt = s;
-        }
-        else if (s[1] == '%')
-        {
-            /* "%%" -> "%" */
-            if (!str)
-                *_str = str = g_string_new (NULL);
-            moved = TRUE;
-            g_string_append_len (str, fmt, s - fmt);
-            fmt = ++s;
-            ++s;
+                if (l)
+                {
+                    if (options & DONNA_CONTEXT_NO_QUOTES)
+                        g_string_append (str, l);
+                    else
+                        donna_g_string_append_quoted (str, l, FALSE);
+                    g_free (l);
+                }
+            }
         }
-        else if (s[1] == '\0')
+        else
         {
-            g_free (extra);
-            break;
+            gchar *ir = donna_app_new_int_ref (app, type, ptr);
+            g_string_append (str, ir);
+            if (intrefs)
+            {
+                if (!*intrefs)
+                    *intrefs = g_ptr_array_new_with_free_func (g_free);
+                g_ptr_array_add (*intrefs, ir);
+            }
+            else
+                g_free (ir);
         }
+    }
+    else if (type & DONNA_ARG_TYPE_TERMINAL)
+        g_string_append (str, donna_terminal_get_name ((DonnaTerminal *) ptr));
+    else if (type & DONNA_ARG_TYPE_STRING)
+    {
+        if (options & DONNA_CONTEXT_NO_QUOTES)
+            g_string_append (str, (gchar *) ptr);
         else
-            /* any unknown variable is left as-is, '%' included */
-            ++s;
+            donna_g_string_append_quoted (str, (gchar *) ptr, FALSE);
+    }
+    else if (type & DONNA_ARG_TYPE_INT)
+        g_string_append_printf (str, "%d", * (gint *) ptr);
+    else if (type & _DONNA_ARG_TYPE_CUSTOM)
+        ((conv_custom_fn) ptr) (c, extra, options, str, context->data);
 
-        g_free (extra);
+    if (destroy)
+        destroy (ptr);
+}
+
+/**
+ * donna_context_parse:
+ * @context: The context to use for parsing
+ * @options: The options for parsing
+ * @app: The #DonnaApp (required to create intrefs)
+ * @fmt: The string to parse
+ * @str: (out): Location of a #GString (or %NULL) that will be used for parsing.
+ * If @str points to %NULL the #GString will be created only when & if needed
+ * @intrefs: (allow-none) (out): Return location for any intrefs created
+ *
+ * Performs contextual parsing of @fmt via @context
+ *
+ * Contextual parsing happens e.g. on actions, when certain variables (e.g. \%o,
+ * etc) can be used in the full location/trigger, and need to be parsed before
+ * processing.
+ *
+ * When processing such variables, it should be known that by default so-called
+ * "intrefs" (for internal references) can be used; For example, if a variable
+ * points to a node, an intref will be used. An intref is simply a string
+ * referencing said node in memory.
+ *
+ * It is possible to "dereference" a variable, so that instead of using an
+ * intref, the full location of the node will be used. This is done by using a
+ * star after the percent sign, e.g. `\%*n`
+ * This can be useful if it isn't meant to be used as a command argument, but
+ * e.g. to be used as part of a string or something.
+ * Additionally, you can also use a special dereferencing, using a colon
+ * instead, e.g. `\%:n`
+ * This will use the location for nodes in "fs", and skip/use empty string for
+ * any node in another domain; Particularly useful for use in command line of
+ * external process.
+ *
+ * If intrefs were created during said parsing (see donna_app_new_int_ref()) and
+ * @intrefs is not %NULL, A #GPtrArray will be created and filled with string
+ * representations of intrefs. This is intended to be then used by
+ * donna_app_parse_fl() and then donna_app_trigger_fl() so intrefs are freed
+ * afterwards.
+ *
+ * @options can be used to specified a default dereferencing mode. If more than
+ * one is specified, #DONNA_CONTEXT_DEREFERENCE_FULL takes precedence over the
+ * others, and #DONNA_CONTEXT_DEREFERENCE_FS takes precedence over
+ * #DONNA_CONTEXT_DEREFERENCE_NONE. If none are specified,
+ * #DONNA_CONTEXT_DEREFERENCE_NONE is used.
+ *
+ * If @context allows extra, between the percent sign and the variable there can
+ * be a quote in between braquet, e.g: \%{foo}v
+ * This would resolve as variable 'v' with "foo" as extra. Note that inside an
+ * extra it is required to escape with a backslash any backslashe or closing
+ * braquets, e.g. to use "foo}bar" as extra, use: \%{foo\}bar}v
+ *
+ * @str can point either to an existing #GString, or %NULL. In the former case,
+ * it will be used as is, adding to it. If nothing needed to be done (e.g. no
+ * variable used in @fmt) then @fmt will be added to the #GString.
+ * In the later case, a #GString will only be created when & if needed, so if
+ * nothing needed to be done it will still point to %NULL (indicating @fmt can
+ * be used as is).
+ *
+ * In addition to the supported variable by @context, the percent sign can be
+ * obtained by doubling it (i.e. using "\%\%"). Anything not supported will
+ * simply be left as is, percent sign included.
+ * Should resolving a variable fail, it will simply resolve to nothing/be
+ * removed.
+ *
+ * Note that @fmt is only scanned once (for a given @context), then cached as a
+ * list of segments (text & variables), so parsing it again only needs to
+ * resolve the variables.
+ */
+void
+donna_context_parse (DonnaContext       *context,
+                     DonnaContextOptions options,
+                     DonnaApp           *app,
+                     const gchar        *fmt,
+                     GString           **_str,
+                     GPtrArray         **intrefs)
+{
+    GString *str = *_str;
+    struct template *tpl;
+    guint dereference_default;
+    guint i;
+
+    if (options & DONNA_CONTEXT_DEREFERENCE_FULL)
+        dereference_default = DONNA_CONTEXT_DEREFERENCE_FULL;
+    else if (options & DONNA_CONTEXT_DEREFERENCE_FS)
+        dereference_default = DONNA_CONTEXT_DEREFERENCE_FS;
+    else
+        dereference_default = DONNA_CONTEXT_DEREFERENCE_NONE;
+
+    g_mutex_lock (&templates_mutex);
+    tpl = get_template (context, fmt);
+
+    if (tpl->is_plain)
+    {
+        g_mutex_unlock (&templates_mutex);
+        /* if a GString was provided, we should put fmt in there */
+        if (str)
+            g_string_append (str, fmt);
+        return;
     }
 
-    /* if not moved but a GString was provided, we should put fmt in there */
-    if (moved || str)
-        g_string_append (str, fmt);
+    if (!str)
+        *_str = str = g_string_sized_new (tpl->len + 64);
+
+    for (i = 0; i < tpl->segments->len; ++i)
+    {
+        struct segment *seg = &g_array_index (tpl->segments, struct segment, i);
+        gchar *extra;
+        gchar c;
+        guint dereference;
+
+        g_string_append_len (str, tpl->fmt + seg->start, (gssize) seg->len);
+        if (seg->c == '\0')
+            continue;
+
+        /* resolving variables might call anything (e.g. parse something else),
+         * so we can't keep the lock. Get what we need first. */
+        c = seg->c;
+        dereference = (seg->dereference) ? seg->dereference : dereference_default;
+        extra = g_strdup (seg->extra);
+        g_mutex_unlock (&templates_mutex);
+
+        append_var (context, options, app, str, intrefs, c, extra, dereference);
+        g_free (extra);
+
+        g_mutex_lock (&templates_mutex);
+        /* cache might have been emptied meanwhile */
+        tpl = get_template (context, fmt);
+    }
+    g_mutex_unlock (&templates_mutex);
 }
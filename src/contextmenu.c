@@ -729,77 +729,310 @@ import_info_from_node (DonnaNode *node, guint import, DonnaContextInfo *info)
     }
 }
 
+/* what get_user_item_info() needs from config for a user item. Looking all
+ * those options up is what takes time when building a menu, while they only
+ * change with config, so this is cached (see get_user_item()) */
+struct user_trigger
+{
+    /* name of the triggerXXX_when option */
+    gchar       *option;
+    gchar       *when;
+    /* NULL if missing */
+    gchar       *trigger;
+    gchar       *name;
+    gchar       *icon;
+    gchar       *icon_selected;
+    gchar       *container;
+};
+
+struct user_item
+{
+    gint         ref;
+    /* if set, the item doesn't exist (error message) */
+    gchar       *unknown;
+    gchar       *is_visible;
+    gchar       *is_sensitive;
+    enum type    type;
+    gboolean     import_from_trigger;
+    /* struct user_trigger[] */
+    GArray      *triggers;
+    gchar       *trigger;
+    gchar       *container;
+    gchar       *name;
+    gchar       *icon;
+    gchar       *icon_selected;
+    gboolean     has_is_menu_bold;
+    gboolean     is_menu_bold;
+    gboolean     has_submenus;
+    gint         submenus;
+    gchar       *menu;
+};
+
+/* "source/item" -> struct user_item; valid for user_items_version of config */
+static GMutex       user_items_mutex;
+static GHashTable  *user_items = NULL;
+static guint        user_items_version = 0;
+
+static void
+free_user_trigger (struct user_trigger *ut)
+{
+    g_free (ut->option);
+    g_free (ut->when);
+    g_free (ut->trigger);
+    g_free (ut->name);
+    g_free (ut->icon);
+    g_free (ut->icon_selected);
+    g_free (ut->container);
+}
+
+static void
+unref_user_item (struct user_item *ui)
+{
+    if (!g_atomic_int_dec_and_test (&ui->ref))
+        return;
+
+    g_free (ui->unknown);
+    g_free (ui->is_visible);
+    g_free (ui->is_sensitive);
+    if (ui->triggers)
+        g_array_free (ui->triggers, TRUE);
+    g_free (ui->trigger);
+    g_free (ui->container);
+    g_free (ui->name);
+    g_free (ui->icon);
+    g_free (ui->icon_selected);
+    g_free (ui->menu);
+    g_slice_free (struct user_item, ui);
+}
+
+static struct user_item *
+load_user_item (DonnaConfig *config, const gchar *source, const gchar *item)
+{
+    GError *err = NULL;
+    struct user_item *ui;
+    GPtrArray *triggers = NULL;
+
+    ui = g_slice_new0 (struct user_item);
+    ui->ref = 1;
+
+    if (!donna_config_has_category (config, &err, "context_menus/%s/%s",
+                source, item))
+    {
+        ui->unknown = g_strdup ((err) ? err->message : "no error message");
+        g_clear_error (&err);
+        return ui;
+    }
+
+    donna_config_get_string (config, NULL, &ui->is_visible,
+            "context_menus/%s/%s/is_visible", source, item);
+    donna_config_get_string (config, NULL, &ui->is_sensitive,
+            "context_menus/%s/%s/is_sensitive", source, item);
+
+    if (donna_config_get_int (config, NULL, (gint *) &ui->type,
+                "context_menus/%s/%s/type", source, item))
+        ui->type = CLAMP (ui->type, TYPE_STANDARD, NB_TYPES - 1);
+    else
+        ui->type = TYPE_STANDARD;
+
+    if (ui->type != TYPE_EMPTY)
+        donna_config_get_boolean (config, NULL, &ui->import_from_trigger,
+                "context_menus/%s/%s/import_from_trigger", source, item);
+
+    if (donna_config_list_options (config, &triggers,
+                DONNA_CONFIG_OPTION_TYPE_OPTION, "context_menus/%s/%s",
+                source, item))
+    {
+        guint j;
+
+        ui->triggers = g_array_new (FALSE, TRUE, sizeof (struct user_trigger));
+        g_array_set_clear_func (ui->triggers,
+                (GDestroyNotify) free_user_trigger);
+
+        for (j = 0; j < triggers->len; ++j)
+        {
+            struct user_trigger ut = { NULL, };
+            gchar *t = triggers->pdata[j];
+            gint sfx;
+            gsize len;
+
+            /* must start with "trigger", ignoring "trigger" itself */
+            if (!streqn ("trigger", t, 7) || t[7] == '\0')
+                continue;
+            len = strlen (t);
+            /* 13 == strlen ("trigger") + strlen ("_when") + 1 */
+            if (len < 13 || !streq (t + len - 5, "_when"))
+                continue;
+            if (!donna_config_get_string (config, NULL, &ut.when,
+                        "context_menus/%s/%s/%s", source, item, t))
+                continue;
+
+            ut.option = g_strdup (t);
+            donna_config_get_string (config, NULL, &ut.trigger,
+                    "context_menus/%s/%s/%.*s",
+                    source, item, (gint) (len - 5), t);
+            /* name/icon/etc under the same suffix */
+            sfx = (gint) (len - 7 - 5);
+            donna_config_get_string (config, NULL, &ut.name,
+                    "context_menus/%s/%s/name%.*s", source, item, sfx, t + 7);
+            donna_config_get_string (config, NULL, &ut.icon,
+                    "context_menus/%s/%s/icon%.*s", source, item, sfx, t + 7);
+            donna_config_get_string (config, NULL, &ut.icon_selected,
+                    "context_menus/%s/%s/icon_selected%.*s",
+                    source, item, sfx, t + 7);
+            if (ui->type == TYPE_COMBINED)
+                donna_config_get_string (config, NULL, &ut.container,
+                        "context_menus/%s/%s/container%.*s",
+                        source, item, sfx, t + 7);
+
+            g_array_append_val (ui->triggers, ut);
+        }
+        g_ptr_array_unref (triggers);
+    }
+
+    donna_config_get_string (config, NULL, &ui->trigger,
+            "context_menus/%s/%s/trigger", source, item);
+    if (ui->type == TYPE_COMBINED)
+        donna_config_get_string (config, NULL, &ui->container,
+                "context_menus/%s/%s/container", source, item);
+    donna_config_get_string (config, NULL, &ui->name,
+            "context_menus/%s/%s/name", source, item);
+    donna_config_get_string (config, NULL, &ui->icon,
+            "context_menus/%s/%s/icon", source, item);
+    donna_config_get_string (config, NULL, &ui->icon_selected,
+            "context_menus/%s/%s/icon_selected", source, item);
+    ui->has_is_menu_bold = donna_config_get_boolean (config, NULL,
+            &ui->is_menu_bold, "context_menus/%s/%s/menu_is_label_bold",
+            source, item);
+    if (ui->type != TYPE_EMPTY)
+        ui->has_submenus = donna_config_get_int (config, NULL, &ui->submenus,
+                "context_menus/%s/%s/submenus", source, item);
+    donna_config_get_string (config, NULL, &ui->menu,
+            "context_menus/%s/%s/menu", source, item);
+
+    return ui;
+}
+
+/* returns the (cached) struct user_item for item, w/ a ref. The cache is
+ * valid for as long as the config version doesn't change */
+static struct user_item *
+get_user_item (DonnaConfig *config, const gchar *source, const gchar *item)
+{
+    struct user_item *ui;
+    guint version;
+    gchar *key;
+
+    /* must be done before reading config; see donna_config_get_version() */
+    version = donna_config_get_version (config);
+    key = g_strdup_printf ("%s/%s", source, item);
+
+    g_mutex_lock (&user_items_mutex);
+    if (G_UNLIKELY (!user_items))
+        user_items = g_hash_table_new_full (g_str_hash, g_str_equal,
+                g_free, (GDestroyNotify) unref_user_item);
+    if (user_items_version != version)
+    {
+        g_hash_table_remove_all (user_items);
+        user_items_version = version;
+    }
+    ui = g_hash_table_lookup (user_items, key);
+    if (ui)
+    {
+        g_atomic_int_inc (&ui->ref);
+        g_mutex_unlock (&user_items_mutex);
+        g_free (key);
+        return ui;
+    }
+    g_mutex_unlock (&user_items_mutex);
+
+    ui = load_user_item (config, source, item);
+
+    g_mutex_lock (&user_items_mutex);
+    /* only if config didn't change while we were loading it */
+    if (user_items_version == version
+            && donna_config_get_version (config) == version)
+    {
+        g_atomic_int_inc (&ui->ref);
+        g_hash_table_replace (user_items, key, ui);
+    }
+    else
+        g_free (key);
+    g_mutex_unlock (&user_items_mutex);
+
+    return ui;
+}
+
+/* evaluate() needs a string it can write to, and the expression is shared */
+static enum expr
+evaluate_option (DonnaContextReference reference, const gchar *expr, GError **error)
+{
+    enum expr ret;
+    gchar *e;
+
+    e = g_strdup (expr);
+    ret = evaluate (reference, e, error);
+    g_free (e);
+    return ret;
+}
+
 static gboolean
-get_user_item_info (const gchar             *item,
-                    const gchar             *extra,
-                    DonnaContextReference    reference,
-                    DonnaApp                *app,
-                    const gchar             *source,
-                    DonnaContext            *context,
-                    DonnaContextInfo        *info,
-                    GError                 **error)
+fill_user_item_info (struct user_item        *ui,
+                     const gchar             *item,
+                     const gchar             *extra,
+                     DonnaContextReference    reference,
+                     DonnaApp                *app,
+                     const gchar             *source,
+                     DonnaContext            *context,
+                     DonnaContextInfo        *info,
+                     GError                 **error)
 {
     GError *err = NULL;
-    DonnaConfig *config = donna_app_peek_config (app);
     DonnaNode *node_trigger = NULL;
-    GPtrArray *triggers = NULL;
     enum type type;
-    gboolean import_from_trigger = FALSE;
+    gboolean import_from_trigger;
     guint import = 0;
-    gboolean b;
     const gchar *s_c = NULL;
     const gchar *s_C = NULL;
     gchar *s;
 
-    if (!donna_config_has_category (config, &err, "context_menus/%s/%s",
-                source, item))
+    if (ui->unknown)
     {
         g_set_error (error, DONNA_CONTEXT_MENU_ERROR,
                 DONNA_CONTEXT_MENU_ERROR_UNKNOWN_ITEM,
                 "Unknown user item '%s' for '%s': %s",
-                item, source, (err) ? err->message : "no error message");
-        g_clear_error (&err);
+                item, source, ui->unknown);
         return FALSE;
     }
 
-    if (donna_config_get_string (config, NULL, &s,
-                "context_menus/%s/%s/is_visible",
-                source, item))
+    if (ui->is_visible)
     {
         enum expr expr;
 
-        expr = evaluate (reference, s, error);
+        expr = evaluate_option (reference, ui->is_visible, error);
         if (expr == EXPR_INVALID)
         {
             g_prefix_error (error,
                     "Failed to evaluate 'context_menus/%s/%s/is_visible': ",
                     source, item);
-            g_free (s);
             return FALSE;
         }
         info->is_visible = expr == EXPR_TRUE;
-        g_free (s);
     }
     else
         info->is_visible = TRUE;
 
-    if (donna_config_get_string (config, NULL, &s,
-                "context_menus/%s/%s/is_sensitive",
-                source, item))
+    if (ui->is_sensitive)
     {
         enum expr expr;
 
-        expr = evaluate (reference, s, error);
+        expr = evaluate_option (reference, ui->is_sensitive, error);
         if (expr == EXPR_INVALID)
         {
             g_prefix_error (error,
                     "Failed to evaluate 'context_menus/%s/%s/is_sensitive': ",
                     source, item);
-            g_free (s);
             return FALSE;
         }
         info->is_sensitive = expr == EXPR_TRUE;
-        g_free (s);
     }
     else
         info->is_sensitive = TRUE;
@@ -817,118 +1050,78 @@ get_user_item_info (const gchar             *item,
     }
 
     /* type of item */
-    if (donna_config_get_int (config, NULL, (gint *) &type,
-                "context_menus/%s/%s/type", source, item))
-        type = CLAMP (type, TYPE_STANDARD, NB_TYPES - 1);
-    else
-        type = TYPE_STANDARD;
-
+    type = ui->type;
     if (type == TYPE_CONTAINER || type == TYPE_COMBINED)
         info->is_container = TRUE;
 
     /* shall we import non-specified stuff from node trigger? */
-    if (type != TYPE_EMPTY)
-        donna_config_get_boolean (config, NULL, &import_from_trigger,
-                "context_menus/%s/%s/import_from_trigger",
-                source, item);
+    import_from_trigger = ui->import_from_trigger;
 
     /* find the (matching) trigger */
-    if (donna_config_list_options (config, &triggers,
-                DONNA_CONFIG_OPTION_TYPE_OPTION, "context_menus/%s/%s",
-                source, item))
+    if (ui->triggers)
     {
         guint j;
 
-        for (j = 0; j < triggers->len; ++j)
+        for (j = 0; j < ui->triggers->len; ++j)
         {
-            gchar *t = triggers->pdata[j];
-            gsize len;
+            struct user_trigger *ut;
+            enum expr expr;
 
-            /* must start with "trigger", ignoring "trigger" itself */
-            if (!streqn ("trigger", t, 7) || t[7] == '\0')
-                continue;
-            len = strlen (t);
-            /* 13 == strlen ("trigger") + strlen ("_when") + 1 */
-            if (len < 13 || !streq (t + len - 5, "_when"))
+            ut = &g_array_index (ui->triggers, struct user_trigger, j);
+            /* see if triggerXXX_when is a match */
+            expr = evaluate_option (reference, ut->when, &err);
+            if (expr == EXPR_INVALID)
+            {
+                g_warning ("Context-menu: Skipping trigger declaration, "
+                        "invalid expression in 'context_menus/%s/%s/%s': %s",
+                        source, item, ut->option,
+                        (err) ? err->message : "(no error message)");
+                g_clear_error (&err);
                 continue;
-            /* get the triggerXXX_when expr to see if it's a match */
-            if (donna_config_get_string (config, NULL, &s,
-                        "context_menus/%s/%s/%s",
-                        source, item, t))
+            }
+            else if (expr == EXPR_TRUE)
             {
-                enum expr expr;
-
-                expr = evaluate (reference, s, &err);
-                if (expr == EXPR_INVALID)
+                if (!ut->trigger)
                 {
-                    g_warning ("Context-menu: Skipping trigger declaration, "
-                            "invalid expression in 'context_menus/%s/%s/%s': %s",
-                            source, item, t,
-                            (err) ? err->message : "(no error message)");
-                    g_clear_error (&err);
-                    g_free (s);
+                    g_warning ("Context-menu: Trigger option missing: "
+                            "'context_menus/%s/%s/%s' -- Skipping trigger",
+                            source, item, ut->option);
                     continue;
                 }
-                else if (expr == EXPR_TRUE)
+                info->trigger = g_strdup (ut->trigger);
+
+                if (ut->name)
                 {
-                    /* get the actual trigger */
-                    if (!donna_config_get_string (config, NULL,
-                                (gchar **) &info->trigger,
-                                "context_menus/%s/%s/%.*s",
-                                source, item, (gint) (len - 5), t))
-                    {
-                        g_warning ("Context-menu: Trigger option missing: "
-                                "'context_menus/%s/%s/%s' -- Skipping trigger",
-                                source, item, t);
-                        g_free (s);
-                        continue;
-                    }
-                    g_free (s);
-
-                    /* try to get the name under the same suffix */
-                    if (donna_config_get_string (config, NULL,
-                                (gchar **) &info->name,
-                                "context_menus/%s/%s/name%.*s",
-                                source, item, (gint) (len - 7 - 5), t + 7))
-                        info->free_name = TRUE;
-
-                    /* try to get the icon under the same suffix */
-                    if (donna_config_get_string (config, NULL,
-                                (gchar **) &info->icon_name,
-                                "context_menus/%s/%s/icon%.*s",
-                                source, item, (gint) (len - 7 - 5), t + 7))
-                        info->free_icon = TRUE;
-
-                    /* try to get the icon selected under the same suffix */
-                    if (donna_config_get_string (config, NULL,
-                                (gchar **) &info->icon_name_selected,
-                                "context_menus/%s/%s/icon_selected%.*s",
-                                source, item, (gint) (len - 7 - 5), t + 7))
-                        info->free_icon_selected = TRUE;
-
-                    if (type == TYPE_COMBINED)
-                        /* try to get the container under the same suffix */
-                        if (donna_config_get_string (config, NULL,
-                                    (gchar **) &info->container,
-                                    "context_menus/%s/%s/container%.*s",
-                                    source, item, (gint) (len - 7 - 5), t + 7))
-                            info->free_container = TRUE;
-
-                    break;
+                    info->name = g_strdup (ut->name);
+                    info->free_name = TRUE;
                 }
-                else /* EXPR_FALSE */
-                    g_free (s);
+                if (ut->icon)
+                {
+                    info->icon_name = g_strdup (ut->icon);
+                    info->free_icon = TRUE;
+                }
+                if (ut->icon_selected)
+                {
+                    info->icon_name_selected = g_strdup (ut->icon_selected);
+                    info->free_icon_selected = TRUE;
+                }
+                if (ut->container)
+                {
+                    info->container = g_strdup (ut->container);
+                    info->free_container = TRUE;
+                }
+
+                break;
             }
         }
-        g_ptr_array_unref (triggers);
     }
 
     /* last chance: the default "trigger" */
-    if (!info->trigger && !donna_config_get_string (config, NULL,
-                (gchar **) &info->trigger,
-                "context_menus/%s/%s/trigger", source, item))
+    if (!info->trigger)
     {
-        if ((!(info->is_visible && info->is_sensitive) && !import_from_trigger)
+        if (ui->trigger)
+            info->trigger = g_strdup (ui->trigger);
+        else if ((!(info->is_visible && info->is_sensitive) && !import_from_trigger)
             || type == TYPE_EMPTY)
         {
             /* not visible & sensitive, and don't import info from node trigger;
@@ -969,15 +1162,15 @@ get_user_item_info (const gchar             *item,
 
     if (type == TYPE_COMBINED && !info->container)
     {
-        if (!donna_config_get_string (config, &err,
-                    (gchar **) &info->container,
-                    "context_menus/%s/%s/container", source, item))
+        if (!ui->container)
         {
-            g_prefix_error (error,
-                    "No container found for TYPE_COMBINED item 'context_menus/%s/%s: ",
+            g_set_error (error, DONNA_CONTEXT_MENU_ERROR,
+                    DONNA_CONTEXT_MENU_ERROR_OTHER,
+                    "No container found for TYPE_COMBINED item 'context_menus/%s/%s'",
                     source, item);
             return FALSE;
         }
+        info->container = g_strdup (ui->container);
         info->free_container = TRUE;
     }
     if (info->container)
@@ -993,9 +1186,11 @@ get_user_item_info (const gchar             *item,
     /* name */
     if (!info->name)
     {
-        if (donna_config_get_string (config, NULL, (gchar **) &info->name,
-                    "context_menus/%s/%s/name", source, item))
+        if (ui->name)
+        {
+            info->name = g_strdup (ui->name);
             info->free_name = TRUE;
+        }
         else if (import_from_trigger)
             import |= IMPORT_DEFAULT;
     }
@@ -1003,9 +1198,11 @@ get_user_item_info (const gchar             *item,
     /* icon */
     if (!info->icon_name)
     {
-        if (donna_config_get_string (config, NULL, (gchar **) &info->icon_name,
-                    "context_menus/%s/%s/icon", source, item))
+        if (ui->icon)
+        {
+            info->icon_name = g_strdup (ui->icon);
             info->free_icon = TRUE;
+        }
         else if (import_from_trigger)
             import |= IMPORT_DEFAULT;
     }
@@ -1013,17 +1210,17 @@ get_user_item_info (const gchar             *item,
     /* icon selected */
     if (!info->icon_name_selected)
     {
-        if (donna_config_get_string (config, NULL, (gchar **) &info->icon_name_selected,
-                    "context_menus/%s/%s/icon_selected", source, item))
+        if (ui->icon_selected)
+        {
+            info->icon_name_selected = g_strdup (ui->icon_selected);
             info->free_icon_selected = TRUE;
+        }
         else if (import_from_trigger)
             import |= IMPORT_DEFAULT;
     }
 
-    if (donna_config_get_boolean (config, NULL, &b,
-                "context_menus/%s/%s/menu_is_label_bold",
-                source, item))
-        info->is_menu_bold = b;
+    if (ui->has_is_menu_bold)
+        info->is_menu_bold = ui->is_menu_bold;
     else if (import_from_trigger)
         import |= IMPORT_IS_LABEL_BOLD;
 
@@ -1031,21 +1228,16 @@ get_user_item_info (const gchar             *item,
      * the parent of a submenu */
     if (type == TYPE_EMPTY)
         info->submenus = DONNA_ENABLED_TYPE_ENABLED;
-    else
-    {
-        gint submenus;
-
-        if (donna_config_get_int (config, NULL, &submenus,
-                    "context_menus/%s/%s/submenus",
-                    source, item))
-            info->submenus = (guint) CLAMP (submenus, 0, 3);
-        else if (import_from_trigger)
-            import |= IMPORT_SUBEMNUS;
-    }
+    else if (ui->has_submenus)
+        info->submenus = (guint) CLAMP (ui->submenus, 0, 3);
+    else if (import_from_trigger)
+        import |= IMPORT_SUBEMNUS;
 
-    if (donna_config_get_string (config, NULL, (gchar **) &info->menu,
-                "context_menus/%s/%s/menu", source, item))
+    if (ui->menu)
+    {
+        info->menu = g_strdup (ui->menu);
         info->free_menu = TRUE;
+    }
     else if (import_from_trigger)
         import |= IMPORT_DEFAULT;
 
@@ -1081,6 +1273,26 @@ get_user_item_info (const gchar             *item,
     return TRUE;
 }
 
+static gboolean
+get_user_item_info (const gchar             *item,
+                    const gchar             *extra,
+                    DonnaContextReference    reference,
+                    DonnaApp                *app,
+                    const gchar             *source,
+                    DonnaContext            *context,
+                    DonnaContextInfo        *info,
+                    GError                 **error)
+{
+    struct user_item *ui;
+    gboolean ret;
+
+    ui = get_user_item (donna_app_peek_config (app), source, item);
+    ret = fill_user_item_info (ui, item, extra, reference, app, source,
+            context, info, error);
+    unref_user_item (ui);
+    return ret;
+}
+
 static void
 load_menu_properties_to_node (DonnaContextInfo  *info,
                               DonnaNode         *node,
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/un.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -66,8 +67,26 @@ struct priv
     GMainLoop *loop;
     gboolean no_wait;
     gboolean failed_on_err;
+    gboolean from_stdin;
+    gboolean stats;
+    /* daemon mode: FIFO to read full locations from */
+    gchar *fifo;
+    /* whether we created it (and should remove it on exit) */
+    gboolean fifo_created;
+    /* fd to read full locations from (stdin or fifo), and its source */
+    gint fd_in;
+    guint sid_in;
+    /* write end of the fifo, so we never get EOF */
+    gint fd_fifo_out;
+    /* buffer of data read from fd_in */
+    GString *line;
     guint nb_pending;
-    guint task_id;
+    /* IDs of triggered tasks we're waiting for */
+    GHashTable *task_ids;
+    gboolean cancelling;
+    /* for stats */
+    guint nb_triggers;
+    gint64 start;
     enum rc rc;
 };
 
@@ -81,6 +100,22 @@ free_priv (gpointer data)
     g_free (priv->socket_path);
     if (priv->loop)
         g_main_loop_unref (priv->loop);
+    if (priv->sid_in > 0)
+        g_source_remove (priv->sid_in);
+    if (priv->fifo)
+    {
+        if (priv->fd_in >= 0)
+            close (priv->fd_in);
+        if (priv->fd_fifo_out >= 0)
+            close (priv->fd_fifo_out);
+        if (priv->fifo_created)
+            unlink (priv->fifo);
+        g_free (priv->fifo);
+    }
+    if (priv->line)
+        g_string_free (priv->line, TRUE);
+    if (priv->task_ids)
+        g_hash_table_unref (priv->task_ids);
 }
 
 /* from util.c */
@@ -287,6 +322,13 @@ parse_cmdline (struct priv  *priv,
             "Don't wait for trigger's error message/return value", NULL },
         { "failed-on-err", 'e', 0, G_OPTION_ARG_NONE, &priv->failed_on_err,
             "Show error messages of failed trigger on stderr", NULL },
+        { "stdin",      'i', 0, G_OPTION_ARG_NONE, &priv->from_stdin,
+            "Read full locations to trigger from stdin (one per line)", NULL },
+        { "daemon",     'D', 0, G_OPTION_ARG_FILENAME, &priv->fifo,
+            "Stay connected and trigger full locations written (one per line) "
+                "to FIFO", "FIFO" },
+        { "stats",      'S', 0, G_OPTION_ARG_NONE, &priv->stats,
+            "Show number of triggers & triggers per second on exit", NULL },
 #ifdef DONNA_DEBUG_ENABLED
         { "debug",      'd', G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, cmdline_cb,
             "Debug mode (Same as --log-level=debug)", NULL },
@@ -297,7 +339,7 @@ parse_cmdline (struct priv  *priv,
     };
     GOptionGroup *group;
 
-    context = g_option_context_new ("<FULL LOCATION>");
+    context = g_option_context_new ("[FULL LOCATION...]");
     group = g_option_group_new ("donna", "donna-trigger", "Main options",
             &data, NULL);
     g_option_group_add_entries (group, entries);
@@ -360,12 +402,24 @@ parse_cmdline (struct priv  *priv,
     else
         show_log = data.loglevel;
 
+    if (priv->from_stdin && priv->fifo)
+    {
+        g_set_error (error, DT_ERROR, RC_PARSE_CMDLINE_FAILED,
+                "Options --stdin and --daemon are mutually exclusive");
+        return FALSE;
+    }
+
     return TRUE;
 }
 
 static void
-socket_process (DonnaSocket *socket, gchar *message, struct priv *priv)
+socket_process (DonnaSocket    *socket,
+                gchar          *message,
+                gsize           len,
+                struct priv    *priv)
 {
+    guint id;
+
     if (!message)
     {
         g_debug ("socket closed");
@@ -384,8 +438,9 @@ socket_process (DonnaSocket *socket, gchar *message, struct priv *priv)
         if (!priv->no_wait && streqn (message, "TRIGGER ", strlen ("TRIGGER ")))
         {
             ++priv->nb_pending;
-            priv->task_id = (guint) g_ascii_strtoull (message + strlen ("TRIGGER "),
+            id = (guint) g_ascii_strtoull (message + strlen ("TRIGGER "),
                     NULL, 10);
+            g_hash_table_add (priv->task_ids, GUINT_TO_POINTER (id));
         }
     }
     else if (streqn (message, "ERR ", strlen ("ERR ")))
@@ -404,6 +459,8 @@ socket_process (DonnaSocket *socket, gchar *message, struct priv *priv)
     {
         --priv->nb_pending;
         message += strlen ("DONE ");
+        id = (guint) g_ascii_strtoull (message, NULL, 10);
+        g_hash_table_remove (priv->task_ids, GUINT_TO_POINTER (id));
         message = strchr (message, ' ');
         if (message)
         {
@@ -416,6 +473,8 @@ socket_process (DonnaSocket *socket, gchar *message, struct priv *priv)
         --priv->nb_pending;
         priv->rc = RC_TASK_FAILED;
         message += strlen ("FAILED ");
+        id = (guint) g_ascii_strtoull (message, NULL, 10);
+        g_hash_table_remove (priv->task_ids, GUINT_TO_POINTER (id));
         message = strchr (message, ' ');
         if (message)
         {
@@ -427,9 +486,15 @@ socket_process (DonnaSocket *socket, gchar *message, struct priv *priv)
     {
         --priv->nb_pending;
         priv->rc = RC_TASK_CANCELLED;
+        id = (guint) g_ascii_strtoull (message + strlen ("CANCELLED "),
+                NULL, 10);
+        g_hash_table_remove (priv->task_ids, GUINT_TO_POINTER (id));
     }
 
-    if (priv->nb_pending == 0)
+    /* still reading full locations to trigger (stdin/daemon) */
+    if (priv->sid_in > 0)
+        g_debug2 ("still %d pending, waiting for input", priv->nb_pending);
+    else if (priv->nb_pending == 0)
     {
         g_debug ("nothing left, closing socket");
         donna_socket_close (socket);
@@ -438,6 +503,130 @@ socket_process (DonnaSocket *socket, gchar *message, struct priv *priv)
         g_debug2 ("still %d pending", priv->nb_pending);
 }
 
+/* sends all full locations (one per line) in priv->line as one message; If
+ * flush the last line doesn't need to be complete (e.g. on EOF) */
+static void
+send_lines (struct priv *priv, gboolean flush)
+{
+    GString *msg;
+    gchar *s;
+    gchar *e;
+
+    msg = g_string_new (NULL);
+    s = priv->line->str;
+    for (;;)
+    {
+        e = strchr (s, '\n');
+        if (!e)
+        {
+            if (!flush)
+                break;
+            e = priv->line->str + priv->line->len;
+        }
+
+        if (e > s)
+        {
+            g_debug ("Send trigger:%.*s", (gint) (e - s), s);
+            /* multiple requests in one message are separated by NUL bytes */
+            if (msg->len > 0)
+                g_string_append_c (msg, '\0');
+            g_string_append (msg, "TRIGGER ");
+            g_string_append_len (msg, s, e - s);
+            ++priv->nb_pending;
+            ++priv->nb_triggers;
+        }
+
+        if (*e == '\0')
+        {
+            s = e;
+            break;
+        }
+        s = e + 1;
+    }
+    g_string_erase (priv->line, 0, s - priv->line->str);
+
+    if (msg->len > 0)
+        donna_socket_send (priv->socket, msg->str, msg->len);
+    g_string_free (msg, TRUE);
+}
+
+static gboolean
+input_cb (gint fd, GIOCondition condition, struct priv *priv)
+{
+    gchar buf[4096];
+    gssize got;
+
+again:
+    got = read (fd, buf, sizeof (buf));
+    if (got < 0)
+    {
+        gint _errno = errno;
+
+        if (_errno == EINTR)
+            goto again;
+        else if (_errno == EAGAIN)
+            return G_SOURCE_CONTINUE;
+
+        g_warning ("Failed to read input: %s", g_strerror (_errno));
+        got = 0;
+    }
+
+    if (got == 0)
+    {
+        g_debug ("end of input");
+        send_lines (priv, TRUE);
+        priv->sid_in = 0;
+        if (priv->nb_pending == 0 && priv->socket)
+            donna_socket_close (priv->socket);
+        return G_SOURCE_REMOVE;
+    }
+
+    g_string_append_len (priv->line, buf, got);
+    send_lines (priv, FALSE);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+init_fifo (struct priv *priv, GError **error)
+{
+    if (mkfifo (priv->fifo, 0600) == 0)
+        priv->fifo_created = TRUE;
+    else if (errno != EEXIST)
+    {
+        gint _errno = errno;
+
+        g_set_error (error, DT_ERROR, RC_SOCKET_FAILED,
+                "Failed to create FIFO '%s': %s",
+                priv->fifo, g_strerror (_errno));
+        return FALSE;
+    }
+
+    priv->fd_in = open (priv->fifo, O_RDONLY | O_NONBLOCK);
+    if (priv->fd_in == -1)
+    {
+        gint _errno = errno;
+
+        g_set_error (error, DT_ERROR, RC_SOCKET_FAILED,
+                "Failed to open FIFO '%s': %s",
+                priv->fifo, g_strerror (_errno));
+        return FALSE;
+    }
+    /* we keep it open for writing ourself, so we don't get EOF every time a
+     * writer closes it */
+    priv->fd_fifo_out = open (priv->fifo, O_WRONLY);
+    if (priv->fd_fifo_out == -1)
+    {
+        gint _errno = errno;
+
+        g_set_error (error, DT_ERROR, RC_SOCKET_FAILED,
+                "Failed to open FIFO '%s' for writing: %s",
+                priv->fifo, g_strerror (_errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static gboolean
 init_socket (struct priv *priv, GError **error)
 {
@@ -506,30 +695,53 @@ init_socket (struct priv *priv, GError **error)
 static gboolean
 signal_handler (struct priv *priv)
 {
-    g_debug ("got a SIGINT");
+    GHashTableIter iter;
+    GString *msg;
+    gpointer key;
+
+    g_debug ("got a signal");
+
+    if (!priv->socket)
+        return G_SOURCE_CONTINUE;
 
-    if (priv->no_wait || priv->task_id == 0)
+    /* stdin: stop reading, so we don't trigger anything else. Once all pending
+     * replies are in, socket_process() will close the socket */
+    if (priv->from_stdin && priv->sid_in > 0)
+    {
+        g_debug ("stop reading input");
+        g_source_remove (priv->sid_in);
+        priv->sid_in = 0;
+    }
+
+    if (priv->no_wait || priv->fifo || g_hash_table_size (priv->task_ids) == 0
+            || priv->cancelling)
     {
         /* no_wait: this should very rarely happen, since donna should always
          * reply right away, but in case let's close the socket.
-         * task_id=0: means we asked to cancel the task, but it still isn't
-         * POST_RUN and another SIGINT was received */
+         * daemon: that's how we stop.
+         * cancelling: means we asked to cancel the task(s), but they still
+         * aren't POST_RUN and another SIGINT was received */
         g_debug ("closing socket");
         donna_socket_close (priv->socket);
+        return G_SOURCE_CONTINUE;
     }
-    else
-    {
-        gchar *s;
 
-        /* we might have a task pending, so let's cancel it */
+    /* we have task(s) pending, so let's cancel them */
+    msg = g_string_new (NULL);
+    g_hash_table_iter_init (&iter, priv->task_ids);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        guint id = GPOINTER_TO_UINT (key);
 
-        g_debug ("cancelling pending task (%u)", priv->task_id);
-        s = g_strdup_printf ("CANCEL %u", priv->task_id);
+        g_debug ("cancelling pending task (%u)", id);
+        if (msg->len > 0)
+            g_string_append_c (msg, '\0');
+        g_string_append_printf (msg, "CANCEL %u", id);
         ++priv->nb_pending;
-        donna_socket_send (priv->socket, s, (gsize) -1);
-        g_free (s);
-        priv->task_id = 0;
     }
+    donna_socket_send (priv->socket, msg->str, msg->len);
+    g_string_free (msg, TRUE);
+    priv->cancelling = TRUE;
 
     return G_SOURCE_CONTINUE;
 }
@@ -552,39 +764,68 @@ main (int argc, char *argv[])
     struct priv priv = { NULL, };
     gint i;
 
+    priv.fd_in = priv.fd_fifo_out = -1;
+    priv.task_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+    priv.line = g_string_new (NULL);
+
     g_log_set_default_handler ((GLogFunc) log_handler, NULL);
     g_unix_signal_add (SIGINT, (GSourceFunc) signal_handler, &priv);
+    g_unix_signal_add (SIGTERM, (GSourceFunc) signal_handler, &priv);
 
     ensure (parse_cmdline (&priv, &argc, &argv, &err));
 
-    if (argc <= 1)
+    if (argc <= 1 && !priv.from_stdin && !priv.fifo)
     {
         fputs ("No full location to trigger specified", stderr);
         fputc ('\n', stderr);
+        free_priv (&priv);
         return RC_NO_FULL_LOCATION;
     }
-    else if (argc > 2)
+    else if (priv.fifo)
     {
-        g_debug ("%d full locations, forcing option no-wait", argc - 1);
+        g_debug ("daemon mode, forcing option no-wait");
         priv.no_wait = TRUE;
     }
     else if (priv.no_wait)
         g_debug ("option no-wait enabled");
 
+    if (priv.fifo)
+        ensure (init_fifo (&priv, &err));
+
     ensure (init_socket (&priv, &err));
+    priv.start = g_get_monotonic_time ();
 
+    /* send all full locations from command line at once */
     for (i = 1; i < argc; ++i)
     {
-        gchar *msg = g_strconcat ("TRIGGER ", argv[i], NULL);
-        g_debug ("Send trigger:%s", argv[i]);
-        donna_socket_send (priv.socket, msg, (gsize) -1);
-        ++priv.nb_pending;
-        g_free (msg);
+        g_string_append (priv.line, argv[i]);
+        g_string_append_c (priv.line, '\n');
+    }
+    send_lines (&priv, TRUE);
+
+    if (priv.fifo)
+        priv.sid_in = g_unix_fd_add (priv.fd_in, G_IO_IN,
+                (GUnixFDSourceFunc) input_cb, &priv);
+    else if (priv.from_stdin)
+    {
+        priv.fd_in = fileno (stdin);
+        priv.sid_in = g_unix_fd_add (priv.fd_in, G_IO_IN | G_IO_HUP,
+                (GUnixFDSourceFunc) input_cb, &priv);
     }
 
     priv.loop = g_main_loop_new (NULL, TRUE);
     g_main_loop_run (priv.loop);
 
+    if (priv.stats)
+    {
+        gdouble secs;
+
+        secs = (gdouble) (g_get_monotonic_time () - priv.start) / G_USEC_PER_SEC;
+        fprintf (stderr, "%u triggers in %.3fs (%.1f/s)\n",
+                priv.nb_triggers, secs,
+                (secs > 0) ? priv.nb_triggers / secs : 0.0);
+    }
+
     g_debug("ending");
     free_priv (&priv);
     return priv.rc;
@@ -83,6 +83,11 @@ struct _DonnaFilterPrivate
     DonnaApp        *app;
     gulong           option_set_sid;
     gulong           option_deleted_sid;
+    /* options changed from other threads, processed in batch from thread UI
+     * (each only once) */
+    GMutex           pending_options_mutex;
+    GHashTable      *pending_options;
+    guint            sid_pending_options;
     struct element  *element;
     GSList          *col_ct_datas;
     gchar           *alias;
@@ -153,6 +158,7 @@ donna_filter_init (DonnaFilter *filter)
 {
     filter->priv = G_TYPE_INSTANCE_GET_PRIVATE (filter,
             DONNA_TYPE_FILTER, DonnaFilterPrivate);
+    g_mutex_init (&filter->priv->pending_options_mutex);
 }
 
 static void
@@ -266,6 +272,11 @@ donna_filter_finalize (GObject *object)
         g_signal_handler_disconnect (config, priv->option_set_sid);
     if (priv->option_deleted_sid > 0)
         g_signal_handler_disconnect (config, priv->option_deleted_sid);
+    if (priv->sid_pending_options > 0)
+        g_source_remove (priv->sid_pending_options);
+    if (priv->pending_options)
+        g_hash_table_unref (priv->pending_options);
+    g_mutex_clear (&priv->pending_options_mutex);
     g_object_unref (priv->app);
     g_free (priv->filter);
     g_free (priv->alias);
@@ -393,41 +404,72 @@ element_need_recompile (struct element *element, const gchar *option)
     return FALSE;
 }
 
-struct option_data
-{
-    DonnaFilter *filter;
-    gchar *option;
-};
-
-static gboolean
-real_option_cb (struct option_data *od)
+static void
+real_option_cb (DonnaFilter *filter, const gchar *option)
 {
-    DonnaFilterPrivate *priv = od->filter->priv;
+    DonnaFilterPrivate *priv = filter->priv;
 
-    if (element_need_recompile (priv->element, od->option))
+    if (element_need_recompile (priv->element, option))
     {
         free_element (priv->element);
         priv->element = NULL;
     }
+}
+
+static gboolean
+pending_options_cb (DonnaFilter *filter)
+{
+    DonnaFilterPrivate *priv = filter->priv;
+    GHashTableIter iter;
+    GHashTable *options;
+    const gchar *option;
+
+    g_mutex_lock (&priv->pending_options_mutex);
+    options = priv->pending_options;
+    priv->pending_options = NULL;
+    priv->sid_pending_options = 0;
+    g_mutex_unlock (&priv->pending_options_mutex);
+
+    if (G_UNLIKELY (!options))
+        return G_SOURCE_REMOVE;
+
+    g_hash_table_iter_init (&iter, options);
+    while (priv->element && g_hash_table_iter_next (&iter, (gpointer) &option, NULL))
+        real_option_cb (filter, option);
+    g_hash_table_unref (options);
 
-    g_free (od);
     return G_SOURCE_REMOVE;
 }
 
 static void
 option_cb (DonnaConfig *config, const gchar *option, DonnaFilter *filter)
 {
-    struct option_data *od;
+    DonnaFilterPrivate *priv = filter->priv;
 
     if (!streqn (option, "defaults/lists/columns/",
                 strlen ("defaults/lists/columns/")))
         return;
 
-    od = g_new (struct option_data, 1);
-    od->filter = filter;
-    od->option = g_strdup (option);
+    /* in thread UI, process it right away */
+    if (g_main_context_is_owner (g_main_context_default ()))
+    {
+        real_option_cb (filter, option);
+        return;
+    }
 
-    g_main_context_invoke (NULL, (GSourceFunc) real_option_cb, od);
+    /* else batch them (each only once), to be processed from one source in
+     * thread UI. Order doesn't matter, all we do is flag the filter to be
+     * compiled again */
+    g_mutex_lock (&priv->pending_options_mutex);
+    if (!priv->pending_options)
+        priv->pending_options = g_hash_table_new_full (g_str_hash, g_str_equal,
+                g_free, NULL);
+    if (!g_hash_table_contains (priv->pending_options, option))
+        g_hash_table_add (priv->pending_options, g_strdup (option));
+    if (priv->sid_pending_options == 0)
+        priv->sid_pending_options = g_idle_add_full (G_PRIORITY_DEFAULT,
+                (GSourceFunc) pending_options_cb, filter, NULL);
+    g_mutex_unlock (&priv->pending_options_mutex);
 }
 
 static inline DonnaColumnType *
@@ -96,6 +96,15 @@ typedef enum
  * donna_node_refresh_task()
  */
 #define DONNA_NODE_REFRESH_ALL_VALUES       "-all"
+/**
+ * DONNA_NODE_REFRESH_BYPASS_CACHE:
+ *
+ * Name of the data to set (to any non-%NULL value, via g_object_set_data()) on
+ * a refresh task, e.g. from donna_node_refresh_arr_tasks_arr(), before it is
+ * run to have the refresher ignore any cached value and get the actual value.
+ * This is meant for refreshes explicitly asked by the user.
+ */
+#define DONNA_NODE_REFRESH_BYPASS_CACHE     "donna-refresh-bypass-cache"
 
 extern const gchar *node_basic_properties[];
 
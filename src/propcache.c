@@ -0,0 +1,583 @@
+/*
+ * donnatella - Copyright (C) 2014 Olivier Brunel
+ *
+ * propcache.c
+ * Copyright (C) 2014 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of donnatella.
+ *
+ * donnatella is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * donnatella is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * donnatella. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "propcache.h"
+#include "macros.h"
+
+/* Cache of values of custom properties, see #custom-properties
+ *
+ * Values are identified by a key "<property>/<location>" (property names can't
+ * contain slashes) and are only valid as long as the file's mtime (incl.
+ * nanoseconds), size & inode are the same.
+ *
+ * The file (in native endianness, it is only meant to be read back on the same
+ * machine) is made of a header, the entries sorted by hash so lookups can be
+ * done via binary search, and the string table: NUL-terminated keys & values
+ * of the entries. The file is mmap-ed, and things used directly from there;
+ * New/updated values are kept in memory until the cache is saved, as are keys
+ * of values removed or found expired (so they're dropped on save).
+ */
+
+#define PROP_CACHE_MAGIC        "DNPCACHE"
+#define PROP_CACHE_VERSION      2
+
+struct header
+{
+    gchar   magic[8];
+    guint32 version;
+    guint32 nb_entries;
+    guint32 strings_len;
+    guint32 reserved;
+};
+
+struct entry
+{
+    guint32 hash;
+    guint32 key;        /* offset in strings */
+    guint32 value;      /* offset in strings */
+    guint32 mtime_nsec;
+    guint64 mtime;
+    guint64 size;
+    guint64 inode;
+};
+
+struct mem_entry
+{
+    DonnaPropCacheKey    key;
+    gchar               *value;
+};
+
+struct _DonnaPropCache
+{
+    GMutex               mutex;
+    gchar               *filename;
+    GMappedFile         *mf;
+    const struct entry  *entries;
+    guint32              nb_entries;
+    const gchar         *strings;
+    guint32              strings_len;
+    /* new/updated values: key -> struct mem_entry */
+    GHashTable          *added;
+    /* removed/expired values: set of keys */
+    GHashTable          *removed;
+};
+
+/* FNV-1a, since it must remain the same across runs */
+static guint32
+get_hash (const gchar *s)
+{
+    guint32 hash = 2166136261U;
+
+    for ( ; *s != '\0'; ++s)
+    {
+        hash ^= (guchar) *s;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static inline gboolean
+same_key (const DonnaPropCacheKey *k1, const DonnaPropCacheKey *k2)
+{
+    return k1->mtime == k2->mtime && k1->mtime_nsec == k2->mtime_nsec
+        && k1->size == k2->size && k1->inode == k2->inode;
+}
+
+static inline void
+get_entry_key (const struct entry *e, DonnaPropCacheKey *key)
+{
+    key->mtime      = e->mtime;
+    key->mtime_nsec = e->mtime_nsec;
+    key->size       = e->size;
+    key->inode      = e->inode;
+}
+
+static void
+free_mem_entry (struct mem_entry *me)
+{
+    g_free (me->value);
+    g_slice_free (struct mem_entry, me);
+}
+
+static void
+load_file (DonnaPropCache *cache)
+{
+    GError *err = NULL;
+    const struct header *h;
+    const gchar *data;
+    gsize len;
+
+    cache->mf = g_mapped_file_new (cache->filename, FALSE, &err);
+    if (!cache->mf)
+    {
+        if (!g_error_matches (err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_warning ("Failed to load cache of custom properties from '%s': %s",
+                    cache->filename, err->message);
+        g_clear_error (&err);
+        return;
+    }
+
+    data = g_mapped_file_get_contents (cache->mf);
+    len  = g_mapped_file_get_length (cache->mf);
+    h = (const struct header *) data;
+
+    if (!data || len < sizeof (struct header)
+            || memcmp (h->magic, PROP_CACHE_MAGIC, sizeof (h->magic)) != 0
+            || h->version != PROP_CACHE_VERSION
+            || len != sizeof (struct header)
+                + (gsize) h->nb_entries * sizeof (struct entry)
+                + (gsize) h->strings_len
+            || (h->strings_len > 0 && data[len - 1] != '\0'))
+    {
+        g_warning ("Failed to load cache of custom properties from '%s': "
+                "Invalid file, ignoring", cache->filename);
+        g_mapped_file_unref (cache->mf);
+        cache->mf = NULL;
+        return;
+    }
+
+    cache->entries      = (const struct entry *) (data + sizeof (struct header));
+    cache->nb_entries   = h->nb_entries;
+    cache->strings      = data + sizeof (struct header)
+        + (gsize) h->nb_entries * sizeof (struct entry);
+    cache->strings_len  = h->strings_len;
+}
+
+static void
+unload_file (DonnaPropCache *cache)
+{
+    if (cache->mf)
+        g_mapped_file_unref (cache->mf);
+    cache->mf           = NULL;
+    cache->entries      = NULL;
+    cache->nb_entries   = 0;
+    cache->strings      = NULL;
+    cache->strings_len  = 0;
+}
+
+/**
+ * donna_prop_cache_new:
+ * @filename: Name of the file where the cache is stored
+ *
+ * Creates a new cache of values of custom properties, loading it from
+ * @filename if it exists.
+ *
+ * Returns: A new #DonnaPropCache; free it using donna_prop_cache_free()
+ */
+DonnaPropCache *
+donna_prop_cache_new (const gchar *filename)
+{
+    DonnaPropCache *cache;
+
+    g_return_val_if_fail (filename != NULL, NULL);
+
+    cache = g_slice_new0 (DonnaPropCache);
+    g_mutex_init (&cache->mutex);
+    cache->filename = g_strdup (filename);
+    cache->added = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) free_mem_entry);
+    cache->removed = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, NULL);
+    load_file (cache);
+
+    return cache;
+}
+
+/**
+ * donna_prop_cache_get_key:
+ * @filename: Name of the file to get the key for
+ * @key: (out): Location to store the key
+ *
+ * Fills @key for @filename, i.e. its current mtime (incl. nanoseconds), size &
+ * inode
+ *
+ * Returns: %TRUE if @key was filled, %FALSE if it couldn't be (e.g. no such
+ * file)
+ */
+gboolean
+donna_prop_cache_get_key (const gchar            *filename,
+                          DonnaPropCacheKey      *key)
+{
+    struct stat st;
+
+    g_return_val_if_fail (filename != NULL, FALSE);
+    g_return_val_if_fail (key != NULL, FALSE);
+
+    if (lstat (filename, &st) == -1)
+        return FALSE;
+
+    key->mtime      = (guint64) st.st_mtim.tv_sec;
+    key->mtime_nsec = (guint64) st.st_mtim.tv_nsec;
+    key->size       = (guint64) st.st_size;
+    key->inode      = (guint64) st.st_ino;
+    return TRUE;
+}
+
+static const struct entry *
+find_entry (DonnaPropCache *cache, const gchar *k, guint32 hash)
+{
+    guint32 first = 0;
+    guint32 last = cache->nb_entries;
+
+    /* find the first entry with this hash */
+    while (first < last)
+    {
+        guint32 i = first + (last - first) / 2;
+
+        if (cache->entries[i].hash < hash)
+            first = i + 1;
+        else
+            last = i;
+    }
+
+    for ( ; first < cache->nb_entries && cache->entries[first].hash == hash; ++first)
+    {
+        const struct entry *e = &cache->entries[first];
+
+        if (e->key < cache->strings_len && e->value < cache->strings_len
+                && streq (cache->strings + e->key, k))
+            return e;
+    }
+
+    return NULL;
+}
+
+/**
+ * donna_prop_cache_get:
+ * @cache: The #DonnaPropCache
+ * @property: Name of the property
+ * @location: Location of the node
+ * @key: Key of the file, from donna_prop_cache_get_key()
+ *
+ * Returns the cached value of @property for @location, if any and still valid
+ * for @key. A value that isn't valid anymore is removed from the cache.
+ *
+ * Returns: (transfer full): The cached value, or %NULL. Free it using g_free()
+ */
+gchar *
+donna_prop_cache_get (DonnaPropCache         *cache,
+                      const gchar            *property,
+                      const gchar            *location,
+                      const DonnaPropCacheKey *key)
+{
+    const struct entry *e;
+    struct mem_entry *me;
+    gchar *value = NULL;
+    gchar *k;
+
+    g_return_val_if_fail (cache != NULL, NULL);
+    g_return_val_if_fail (property != NULL, NULL);
+    g_return_val_if_fail (location != NULL, NULL);
+    g_return_val_if_fail (key != NULL, NULL);
+
+    k = g_strconcat (property, "/", location, NULL);
+    g_mutex_lock (&cache->mutex);
+
+    me = g_hash_table_lookup (cache->added, k);
+    if (me)
+    {
+        if (same_key (&me->key, key))
+            value = g_strdup (me->value);
+        else
+        {
+            /* expired */
+            g_hash_table_remove (cache->added, k);
+            g_hash_table_add (cache->removed, k);
+            k = NULL;
+        }
+    }
+    else if (cache->mf && !g_hash_table_contains (cache->removed, k))
+    {
+        e = find_entry (cache, k, get_hash (k));
+        if (e)
+        {
+            DonnaPropCacheKey e_key;
+
+            get_entry_key (e, &e_key);
+            if (same_key (&e_key, key))
+                value = g_strdup (cache->strings + e->value);
+            else
+            {
+                /* expired */
+                g_hash_table_add (cache->removed, k);
+                k = NULL;
+            }
+        }
+    }
+
+    g_mutex_unlock (&cache->mutex);
+    g_free (k);
+    return value;
+}
+
+/**
+ * donna_prop_cache_set:
+ * @cache: The #DonnaPropCache
+ * @property: Name of the property
+ * @location: Location of the node
+ * @key: Key of the file, from donna_prop_cache_get_key()
+ * @value: The value to cache
+ *
+ * Caches @value as the value of @property for @location, valid for as long as
+ * the file matches @key. It will only be written to the file on
+ * donna_prop_cache_save()
+ */
+void
+donna_prop_cache_set (DonnaPropCache         *cache,
+                      const gchar            *property,
+                      const gchar            *location,
+                      const DonnaPropCacheKey *key,
+                      const gchar            *value)
+{
+    struct mem_entry *me;
+
+    g_return_if_fail (cache != NULL);
+    g_return_if_fail (property != NULL);
+    g_return_if_fail (location != NULL);
+    g_return_if_fail (key != NULL);
+    g_return_if_fail (value != NULL);
+
+    me = g_slice_new (struct mem_entry);
+    me->key = *key;
+    me->value = g_strdup (value);
+
+    g_mutex_lock (&cache->mutex);
+    g_hash_table_replace (cache->added,
+            g_strconcat (property, "/", location, NULL), me);
+    g_mutex_unlock (&cache->mutex);
+}
+
+/**
+ * donna_prop_cache_remove:
+ * @cache: The #DonnaPropCache
+ * @property: Name of the property
+ * @location: Location of the node
+ *
+ * Removes the cached value of @property for @location, if any. It will only
+ * be removed from the file on donna_prop_cache_save()
+ */
+void
+donna_prop_cache_remove (DonnaPropCache         *cache,
+                         const gchar            *property,
+                         const gchar            *location)
+{
+    gchar *k;
+
+    g_return_if_fail (cache != NULL);
+    g_return_if_fail (property != NULL);
+    g_return_if_fail (location != NULL);
+
+    k = g_strconcat (property, "/", location, NULL);
+    g_mutex_lock (&cache->mutex);
+    g_hash_table_remove (cache->added, k);
+    if (cache->mf && find_entry (cache, k, get_hash (k)))
+        g_hash_table_add (cache->removed, k);
+    else
+        g_free (k);
+    g_mutex_unlock (&cache->mutex);
+}
+
+/* whether the file still exists & matches */
+static gboolean
+is_valid (const gchar *k, const DonnaPropCacheKey *key)
+{
+    DonnaPropCacheKey cur;
+    const gchar *location;
+    gchar *filename;
+    gboolean ret;
+
+    location = strchr (k, '/');
+    if (!location)
+        return FALSE;
+    ++location;
+
+    if (g_get_filename_charsets (NULL))
+        filename = (gchar *) location;
+    else
+    {
+        filename = g_filename_from_utf8 (location, -1, NULL, NULL, NULL);
+        if (!filename)
+            return FALSE;
+    }
+
+    ret = donna_prop_cache_get_key (filename, &cur) && same_key (&cur, key);
+
+    if (filename != location)
+        g_free (filename);
+    return ret;
+}
+
+static void
+add_entry (GArray       *entries,
+           GString      *strings,
+           const gchar  *k,
+           const gchar  *value,
+           const DonnaPropCacheKey *key)
+{
+    struct entry e;
+
+    e.hash      = get_hash (k);
+    e.key       = (guint32) strings->len;
+    g_string_append_len (strings, k, (gssize) strlen (k) + 1);
+    e.value     = (guint32) strings->len;
+    g_string_append_len (strings, value, (gssize) strlen (value) + 1);
+    e.mtime_nsec = (guint32) key->mtime_nsec;
+    e.mtime     = key->mtime;
+    e.size      = key->size;
+    e.inode     = key->inode;
+
+    g_array_append_val (entries, e);
+}
+
+static gint
+cmp_entries (gconstpointer a, gconstpointer b)
+{
+    guint32 h1 = ((const struct entry *) a)->hash;
+    guint32 h2 = ((const struct entry *) b)->hash;
+
+    return (h1 < h2) ? -1 : (h1 > h2) ? 1 : 0;
+}
+
+/**
+ * donna_prop_cache_save:
+ * @cache: The #DonnaPropCache
+ * @error: (allow-none): Return location of a #GError, or %NULL
+ *
+ * Saves @cache to its file. This is also a compaction pass: values from the
+ * file for files that don't exist anymore, or have changed, are dropped.
+ *
+ * Since this needs to check all files, nothing is done when no values were
+ * added/updated, removed or found expired since the file was loaded;
+ * Compaction will then happen on the next save that has something to write.
+ *
+ * Returns: %TRUE on success, else %FALSE
+ */
+gboolean
+donna_prop_cache_save (DonnaPropCache         *cache,
+                       GError                **error)
+{
+    GHashTableIter iter;
+    struct header h;
+    struct mem_entry *me;
+    GArray *entries;
+    GString *strings;
+    GString *str;
+    gchar *k;
+    guint32 i;
+    gboolean ret;
+
+    g_return_val_if_fail (cache != NULL, FALSE);
+
+    g_mutex_lock (&cache->mutex);
+    if (g_hash_table_size (cache->added) == 0
+            && g_hash_table_size (cache->removed) == 0)
+    {
+        g_mutex_unlock (&cache->mutex);
+        return TRUE;
+    }
+
+    entries = g_array_new (FALSE, FALSE, sizeof (struct entry));
+    strings = g_string_new (NULL);
+
+    for (i = 0; i < cache->nb_entries; ++i)
+    {
+        const struct entry *e = &cache->entries[i];
+        DonnaPropCacheKey key;
+        const gchar *_k;
+
+        if (e->key >= cache->strings_len || e->value >= cache->strings_len)
+            continue;
+        _k = cache->strings + e->key;
+        get_entry_key (e, &key);
+        /* updated, removed/expired, or file gone/changed */
+        if (g_hash_table_contains (cache->added, _k)
+                || g_hash_table_contains (cache->removed, _k)
+                || !is_valid (_k, &key))
+            continue;
+
+        add_entry (entries, strings, _k, cache->strings + e->value, &key);
+    }
+
+    /* new values were set from a key obtained this session, no need to check
+     * them again */
+    g_hash_table_iter_init (&iter, cache->added);
+    while (g_hash_table_iter_next (&iter, (gpointer) &k, (gpointer) &me))
+        add_entry (entries, strings, k, me->value, &me->key);
+
+    g_array_sort (entries, cmp_entries);
+
+    memcpy (h.magic, PROP_CACHE_MAGIC, sizeof (h.magic));
+    h.version       = PROP_CACHE_VERSION;
+    h.nb_entries    = entries->len;
+    h.strings_len   = (guint32) strings->len;
+    h.reserved      = 0;
+
+    str = g_string_sized_new (sizeof (struct header)
+            + entries->len * sizeof (struct entry) + strings->len);
+    g_string_append_len (str, (const gchar *) &h, sizeof (struct header));
+    g_string_append_len (str, entries->data,
+            (gssize) (entries->len * sizeof (struct entry)));
+    g_string_append_len (str, strings->str, (gssize) strings->len);
+
+    ret = g_file_set_contents (cache->filename, str->str, (gssize) str->len, error);
+    if (ret)
+    {
+        /* everything is now in the file */
+        unload_file (cache);
+        g_hash_table_remove_all (cache->added);
+        g_hash_table_remove_all (cache->removed);
+        load_file (cache);
+    }
+
+    g_mutex_unlock (&cache->mutex);
+
+    g_string_free (str, TRUE);
+    g_string_free (strings, TRUE);
+    g_array_free (entries, TRUE);
+    return ret;
+}
+
+/**
+ * donna_prop_cache_free:
+ * @cache: The #DonnaPropCache
+ *
+ * Frees @cache. Note that any value not yet saved will be lost, see
+ * donna_prop_cache_save()
+ */
+void
+donna_prop_cache_free (DonnaPropCache         *cache)
+{
+    if (!cache)
+        return;
+
+    unload_file (cache);
+    g_hash_table_unref (cache->added);
+    g_hash_table_unref (cache->removed);
+    g_free (cache->filename);
+    g_mutex_clear (&cache->mutex);
+    g_slice_free (DonnaPropCache, cache);
+}
@@ -0,0 +1,61 @@
+/*
+ * donnatella - Copyright (C) 2014 Olivier Brunel
+ *
+ * propcache.h
+ * Copyright (C) 2014 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of donnatella.
+ *
+ * donnatella is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * donnatella is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * donnatella. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __DONNA_PROP_CACHE_H__
+#define __DONNA_PROP_CACHE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _DonnaPropCache                  DonnaPropCache;
+
+typedef struct
+{
+    guint64 mtime;
+    guint64 mtime_nsec;
+    guint64 size;
+    guint64 inode;
+} DonnaPropCacheKey;
+
+DonnaPropCache *    donna_prop_cache_new        (const gchar            *filename);
+gboolean            donna_prop_cache_get_key    (const gchar            *filename,
+                                                 DonnaPropCacheKey      *key);
+gchar *             donna_prop_cache_get        (DonnaPropCache         *cache,
+                                                 const gchar            *property,
+                                                 const gchar            *location,
+                                                 const DonnaPropCacheKey *key);
+void                donna_prop_cache_set        (DonnaPropCache         *cache,
+                                                 const gchar            *property,
+                                                 const gchar            *location,
+                                                 const DonnaPropCacheKey *key,
+                                                 const gchar            *value);
+void                donna_prop_cache_remove     (DonnaPropCache         *cache,
+                                                 const gchar            *property,
+                                                 const gchar            *location);
+gboolean            donna_prop_cache_save       (DonnaPropCache         *cache,
+                                                 GError                **error);
+void                donna_prop_cache_free       (DonnaPropCache         *cache);
+
+G_END_DECLS
+
+#endif /* __DONNA_PROP_CACHE_H__ */
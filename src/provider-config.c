@@ -195,6 +195,25 @@ struct _DonnaProviderConfigPrivate
     /* a recursive mutex to handle (toggle ref) nodes. Should only be locked
      * after a lock on config (GRWLock above), reader is good enough */
     GRecMutex        nodes_mutex;
+    /* index of GNode-s by full name (w/out leading slash), filled on lookups.
+     * Readers must also lock index_mutex to access it */
+    GHashTable      *index;
+    GMutex           index_mutex;
+    /* bumped (under writer lock) whenever an option is added, removed or
+     * renamed, so handles know to resolve their GNode again */
+    guint            generation;
+    /* bumped (atomically) on every change in config, see
+     * donna_config_get_version() */
+    gint             version;
+};
+
+struct _DonnaConfigHandle
+{
+    DonnaConfig *config;
+    /* full name, w/out leading slash */
+    gchar       *name;
+    GNode       *node;
+    guint        generation;
 };
 
 
@@ -370,11 +389,14 @@ donna_provider_config_init (DonnaProviderConfig *provider)
     option->extra = priv->root;
     g_rw_lock_init (&priv->lock);
     g_rec_mutex_init (&priv->nodes_mutex);
+    priv->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_mutex_init (&priv->index_mutex);
 }
 
 static inline void
 config_option_set (DonnaConfig *config, const gchar *name)
 {
+    g_atomic_int_inc (&config->priv->version);
     g_signal_emit (config, donna_config_signals[OPTION_SET],
             g_quark_from_string (name), name);
 }
@@ -382,6 +404,7 @@ config_option_set (DonnaConfig *config, const gchar *name)
 static inline void
 config_option_deleted (DonnaConfig *config, const gchar *name)
 {
+    g_atomic_int_inc (&config->priv->version);
     g_signal_emit (config, donna_config_signals[OPTION_DELETED],
             g_quark_from_string (name), name);
 }
@@ -454,6 +477,8 @@ provider_config_finalize (GObject *object)
     g_node_destroy (priv->root);
     g_rw_lock_clear (&priv->lock);
     g_rec_mutex_clear (&priv->nodes_mutex);
+    g_hash_table_unref (priv->index);
+    g_mutex_clear (&priv->index_mutex);
 
     /* chain up */
     G_OBJECT_CLASS (donna_provider_config_parent_class)->finalize (object);
@@ -972,6 +997,7 @@ ensure_categories (DonnaProviderConfig  *config,
             g_value_init (&option->value, G_TYPE_INT);
             g_value_set_int (&option->value, 1);
             node = g_node_append_data (parent, option);
+            ++config->priv->generation;
 
             /* avoid deadlock -- see _set_option() for more */
             if (parent_node && !*parent_node && po->node
@@ -1037,6 +1063,7 @@ ensure_categories (DonnaProviderConfig  *config,
                 g_value_init (&option->value, G_TYPE_INT);
                 g_value_set_int (&option->value, 1);
                 node = g_node_append_data (parent, option);
+                ++config->priv->generation;
 
                 /* avoid deadlock -- see _set_option() for more */
                 if (parent_node && !*parent_node && po->node
@@ -1350,7 +1377,9 @@ donna_config_load_config (DonnaConfig *config, gchar *data)
             }
         }
     }
+    ++priv->generation;
     g_rw_lock_writer_unlock (&priv->lock);
+    g_atomic_int_inc (&priv->version);
 
     g_regex_unref (re_int);
     g_regex_unref (re_double);
@@ -1681,6 +1710,57 @@ get_option (GNode *root, const gchar *name)
         return NULL;
 }
 
+/* assumes reader lock on config. Same as get_option_node() but going through
+ * the index first, and adding the GNode found to it */
+static GNode *
+lookup_option_node (DonnaProviderConfigPrivate *priv, const gchar *name)
+{
+    GNode *node;
+
+    if (name[0] == '/' && name[1] == '\0')
+        return priv->root;
+
+    if (*name == '/')
+        ++name;
+
+    g_mutex_lock (&priv->index_mutex);
+    node = g_hash_table_lookup (priv->index, name);
+    g_mutex_unlock (&priv->index_mutex);
+    if (node)
+        return node;
+
+    node = get_option_node (priv->root, name);
+    if (node)
+    {
+        g_mutex_lock (&priv->index_mutex);
+        g_hash_table_insert (priv->index, g_strdup (name), node);
+        g_mutex_unlock (&priv->index_mutex);
+    }
+    return node;
+}
+
+/* assumes reader lock on config */
+static inline struct option *
+lookup_option (DonnaProviderConfigPrivate *priv, const gchar *name)
+{
+    GNode *node;
+
+    node = lookup_option_node (priv, name);
+    if (node)
+        return (struct option *) node->data;
+    else
+        return NULL;
+}
+
+/* assumes writer lock on config; to be called when options are removed or
+ * renamed, i.e. full names in the index might not be valid anymore */
+static inline void
+invalidate_index (DonnaProviderConfigPrivate *priv)
+{
+    g_hash_table_remove_all (priv->index);
+    ++priv->generation;
+}
+
 /* assumes reader lock on config */
 static gchar *
 get_option_full_name (GNode *root, GNode *gnode)
@@ -1729,7 +1809,7 @@ _get_option (DonnaConfig *config,
     name = g_strdup_vprintf (fmt, va_arg);
 
     g_rw_lock_reader_lock (&priv->lock);
-    option = get_option (priv->root, name);
+    option = lookup_option (priv, name);
     if (option)
     {
         /* G_TYPE_INVALID means we want a category */
@@ -1937,7 +2017,7 @@ donna_config_has_option (DonnaConfig             *config,
     va_end (va_arg);
 
     g_rw_lock_reader_lock (&priv->lock);
-    option = get_option (priv->root, name);
+    option = lookup_option (priv, name);
     g_free (name);
     if (option)
     {
@@ -2078,6 +2158,208 @@ donna_config_get_string (DonnaConfig          *config,
     _get_opt (G_TYPE_STRING, g_value_dup_string);
 }
 
+/**
+ * donna_config_get_version:
+ * @config: The #DonnaConfig
+ *
+ * Returns the current version of @config, which changes every time the
+ * configuration does (options set, removed, renamed, or configuration loaded).
+ *
+ * This allows to cache things resolved from the configuration: get the version
+ * before reading options, store it alongside, and the cache is valid for as
+ * long as donna_config_get_version() returns the same value.
+ *
+ * Returns: The current version of @config
+ */
+guint
+donna_config_get_version (DonnaConfig *config)
+{
+    g_return_val_if_fail (DONNA_IS_PROVIDER_CONFIG (config), 0);
+    return (guint) g_atomic_int_get (&config->priv->version);
+}
+
+/**
+ * donna_config_get_handle:
+ * @config: The #DonnaConfig
+ * @fmt: <function>printf</function>-like format for the full/option/name
+ * @...: <function>printf</function>-like arguments
+ *
+ * Returns a handle on option @fmt, to be used with e.g.
+ * donna_config_handle_get_string() to get its value without the need to format
+ * & resolve its full name each time.
+ *
+ * The option doesn't need to exist (yet), and can be added, removed or renamed
+ * at any time; the handle will always refer to the option currently at the
+ * full name it was created with.
+ *
+ * A handle isn't thread-safe, i.e. it should only be used from one thread at a
+ * time. Use donna_config_handle_free() when done.
+ *
+ * Returns: (transfer full): A new #DonnaConfigHandle
+ */
+DonnaConfigHandle *
+donna_config_get_handle (DonnaConfig    *config,
+                         const gchar    *fmt,
+                         ...)
+{
+    DonnaProviderConfigPrivate *priv;
+    DonnaConfigHandle *handle;
+    va_list va_arg;
+    gchar *name;
+
+    g_return_val_if_fail (DONNA_IS_PROVIDER_CONFIG (config), NULL);
+    g_return_val_if_fail (fmt != NULL, NULL);
+    priv = config->priv;
+
+    va_start (va_arg, fmt);
+    name = g_strdup_vprintf (fmt, va_arg);
+    va_end (va_arg);
+
+    handle = g_slice_new (DonnaConfigHandle);
+    handle->config = g_object_ref (config);
+    if (*name == '/')
+    {
+        handle->name = g_strdup (name + 1);
+        g_free (name);
+    }
+    else
+        handle->name = name;
+
+    g_rw_lock_reader_lock (&priv->lock);
+    handle->node = lookup_option_node (priv, handle->name);
+    handle->generation = priv->generation;
+    g_rw_lock_reader_unlock (&priv->lock);
+
+    return handle;
+}
+
+/**
+ * donna_config_handle_free:
+ * @handle: A #DonnaConfigHandle
+ *
+ * Frees @handle
+ */
+void
+donna_config_handle_free (DonnaConfigHandle *handle)
+{
+    if (G_UNLIKELY (!handle))
+        return;
+
+    g_object_unref (handle->config);
+    g_free (handle->name);
+    g_slice_free (DonnaConfigHandle, handle);
+}
+
+/* leaves a reader lock on config, also on failure */
+static struct option *
+handle_get_option (DonnaConfigHandle *handle, GType type)
+{
+    DonnaProviderConfigPrivate *priv = handle->config->priv;
+    struct option *option;
+
+    g_rw_lock_reader_lock (&priv->lock);
+
+    /* tree structure changed since last time, resolve the GNode again */
+    if (handle->generation != priv->generation)
+    {
+        handle->node = lookup_option_node (priv, handle->name);
+        handle->generation = priv->generation;
+    }
+
+    if (!handle->node)
+        return NULL;
+
+    option = handle->node->data;
+    if (option_is_category (option, priv->root)
+            || !G_VALUE_HOLDS (&option->value, type))
+        return NULL;
+
+    return option;
+}
+
+#define _get_handle_opt(gtype, get_fn)  do {                \
+    struct option *option;                                  \
+                                                            \
+    g_return_val_if_fail (handle != NULL, FALSE);           \
+    g_return_val_if_fail (value != NULL, FALSE);            \
+                                                            \
+    option = handle_get_option (handle, gtype);             \
+    if (option)                                             \
+        *value = get_fn (&option->value);                   \
+    g_rw_lock_reader_unlock (&handle->config->priv->lock);  \
+    return option != NULL;                                  \
+} while (0)
+
+/**
+ * donna_config_handle_get_boolean:
+ * @handle: A #DonnaConfigHandle
+ * @value: (out): Return location to put the value of the option
+ *
+ * Get the value of boolean option referred to by @handle and set it in @value
+ *
+ * Returns: %TRUE if @value was set, else %FALSE (option doesn't exist, or is a
+ * another type)
+ */
+gboolean
+donna_config_handle_get_boolean (DonnaConfigHandle  *handle,
+                                 gboolean           *value)
+{
+    _get_handle_opt (G_TYPE_BOOLEAN, g_value_get_boolean);
+}
+
+/**
+ * donna_config_handle_get_int:
+ * @handle: A #DonnaConfigHandle
+ * @value: (out): Return location to put the value of the option
+ *
+ * Get the value of integer option referred to by @handle and set it in @value
+ *
+ * Returns: %TRUE if @value was set, else %FALSE (option doesn't exist, or is a
+ * another type)
+ */
+gboolean
+donna_config_handle_get_int (DonnaConfigHandle  *handle,
+                             gint               *value)
+{
+    _get_handle_opt (G_TYPE_INT, g_value_get_int);
+}
+
+/**
+ * donna_config_handle_get_double:
+ * @handle: A #DonnaConfigHandle
+ * @value: (out): Return location to put the value of the option
+ *
+ * Get the value of double option referred to by @handle and set it in @value
+ *
+ * Returns: %TRUE if @value was set, else %FALSE (option doesn't exist, or is a
+ * another type)
+ */
+gboolean
+donna_config_handle_get_double (DonnaConfigHandle  *handle,
+                                gdouble            *value)
+{
+    _get_handle_opt (G_TYPE_DOUBLE, g_value_get_double);
+}
+
+/**
+ * donna_config_handle_get_string:
+ * @handle: A #DonnaConfigHandle
+ * @value: (out): Return location to put the value of the option
+ *
+ * Get the value of string option referred to by @handle and set it in @value
+ *
+ * Returns: %TRUE if @value was set, else %FALSE (option doesn't exist, or is a
+ * another type)
+ */
+gboolean
+donna_config_handle_get_string (DonnaConfigHandle  *handle,
+                                gchar             **value)
+{
+    _get_handle_opt (G_TYPE_STRING, g_value_dup_string);
+}
+
+#undef _get_handle_opt
+
 gboolean
 donna_config_list_options (DonnaConfig               *config,
                            GPtrArray                **options,
@@ -2204,7 +2486,7 @@ _get_option_column (DonnaConfig  *config,
 
     if (!arr_name)
         goto treeview;
-    node = get_option_node (priv->root, arr_name);
+    node = lookup_option_node (priv, arr_name);
     if (!node)
         goto treeview;
     get_child_cat ("columns_options", 15, treeview);
@@ -3086,6 +3368,7 @@ _set_option_va (DonnaConfig    *config,
             g_value_init (&option->value, type);
 
         node = g_node_append_data (parent, option);
+        ++priv->generation;
         ret = TRUE;
 
         if (extra)
@@ -3162,6 +3445,9 @@ _set_option_va (DonnaConfig    *config,
 
 done:
     g_rw_lock_writer_unlock (&priv->lock);
+    /* in case no option-set is emitted below */
+    if (child_node)
+        g_atomic_int_inc (&priv->version);
 
     /* signals after releasing the lock, to avoid any deadlocks */
     if (child_node)
@@ -4527,6 +4813,7 @@ donna_config_rename_option (DonnaConfig            *config,
     /* perform the rename */
     option = (struct option *) node->data;
     option->name = str_chunk (priv, new_name);
+    invalidate_index (priv);
 
     /* get the new location of the node */
     new_location = get_option_full_name (priv->root, node);
@@ -4756,6 +5043,8 @@ donna_config_rename_category (DonnaConfig            *config,
     option = (struct option *) node->data;
     old_name = option->name;
     option->name = str_chunk (priv, new_name);
+    /* all descendants got a new location as well */
+    invalidate_index (priv);
 
     /* numbered category special handling */
     if (*new_name >= '1' && *new_name <= '9')
@@ -4931,6 +5220,7 @@ _remove_option (DonnaProviderConfig *config,
             (GNodeTraverseFunc) free_node_data_removing,
             &data);
     g_node_destroy (node);
+    invalidate_index (priv);
 
     g_rw_lock_writer_unlock (&priv->lock);
 
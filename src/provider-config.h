@@ -58,6 +58,8 @@ typedef struct _DonnaConfigItemExtraList        DonnaConfigItemExtraList;
 typedef struct _DonnaConfigItemExtraListInt     DonnaConfigItemExtraListInt;
 typedef struct _DonnaConfigItemExtraListInt     DonnaConfigItemExtraListFlags;
 
+typedef struct _DonnaConfigHandle               DonnaConfigHandle;
+
 #define DONNA_CONFIG_ERROR      g_quark_from_static_string ("DonnaConfig-Error")
 typedef enum
 {
@@ -224,6 +226,19 @@ gboolean    donna_config_get_string             (DonnaConfig            *config,
                                                  gchar                 **value,
                                                  const gchar            *fmt,
                                                  ...);
+guint       donna_config_get_version            (DonnaConfig            *config);
+DonnaConfigHandle * donna_config_get_handle     (DonnaConfig            *config,
+                                                 const gchar            *fmt,
+                                                 ...);
+void        donna_config_handle_free            (DonnaConfigHandle      *handle);
+gboolean    donna_config_handle_get_boolean     (DonnaConfigHandle      *handle,
+                                                 gboolean               *value);
+gboolean    donna_config_handle_get_int         (DonnaConfigHandle      *handle,
+                                                 gint                   *value);
+gboolean    donna_config_handle_get_double      (DonnaConfigHandle      *handle,
+                                                 gdouble                *value);
+gboolean    donna_config_handle_get_string      (DonnaConfigHandle      *handle,
+                                                 gchar                 **value);
 gboolean    donna_config_list_options           (DonnaConfig            *config,
                                                  GPtrArray             **options,
                                                  DonnaConfigOptionType   type,
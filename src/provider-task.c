@@ -109,9 +109,13 @@ typedef enum
 struct task
 {
     DonnaTask   *task;
+    /* devices, interned (see get_devices()) */
+    GQuark      *devices;
+    guint        nb_devices;
     guint        in_pool    : 1; /* did we add it in a pool */
     guint        own_pause  : 1; /* did we pause it */
     guint        post_run   : 1; /* event was emitted when reached POST_RUN state */
+    guint        got_devices: 1; /* devices are set (else it's in-memory) */
 };
 
 /* statusbar */
@@ -136,6 +140,17 @@ struct _DonnaProviderTaskPrivate
     guint        readers;
     /* struct task [] */
     GArray      *tasks;
+    /* DonnaTask -> index (+1) in tasks */
+    GHashTable  *index;
+    /* tasks refresh_tm() needs to look at, i.e. waiting, running or paused
+     * ones (not stopped, nor done/failed/cancelled). Set of DonnaTask (w/ a
+     * ref), kept up to date on state changes (see update_schedulable()). It
+     * has its own mutex since state changes can be notified from anywhere,
+     * incl. while the manager lock is held */
+    GMutex       sched_mutex;
+    GHashTable  *schedulable;
+    /* is there a refresh_tm() queued from an idle source */
+    gint         refresh_queued;
     /* thread pool */
     GThreadPool *pool;
     /* statusbar */
@@ -289,6 +304,62 @@ static void
 free_task (struct task *t)
 {
     g_object_unref (t->task);
+    g_free (t->devices);
+}
+
+/* Returns the index of @task in priv->tasks, or (guint) -1 if it isn't known
+ * to the task manager. Must be called with the lock (TM_BUSY_READ at least) */
+static inline guint
+get_task_index (DonnaProviderTaskPrivate *priv, DonnaTask *task)
+{
+    /* index has index + 1, so not found (0) becomes (guint) -1 */
+    return GPOINTER_TO_UINT (g_hash_table_lookup (priv->index, task)) - 1;
+}
+
+static inline struct task *
+get_task (DonnaProviderTaskPrivate *priv, DonnaTask *task)
+{
+    guint i = get_task_index (priv, task);
+
+    if (i == (guint) -1)
+        return NULL;
+    return &g_array_index (priv->tasks, struct task, i);
+}
+
+/* adds/removes task from schedulable based on its current state. Can be called
+ * from any thread, w/ or w/o the manager lock */
+static void
+update_schedulable (DonnaProviderTaskPrivate *priv, DonnaTask *task)
+{
+    DonnaTaskState state;
+
+    g_mutex_lock (&priv->sched_mutex);
+    /* get the state under the mutex, so the last call always wins */
+    state = donna_task_get_state (task);
+    if (state == DONNA_TASK_STOPPED || (state & DONNA_TASK_POST_RUN))
+        g_hash_table_remove (priv->schedulable, task);
+    else if (!g_hash_table_contains (priv->schedulable, task))
+        g_hash_table_add (priv->schedulable, g_object_ref (task));
+    g_mutex_unlock (&priv->sched_mutex);
+}
+
+/* must be called with TM_BUSY_WRITE */
+static void
+remove_task (DonnaProviderTaskPrivate *priv, guint i)
+{
+    DonnaTask *task = g_array_index (priv->tasks, struct task, i).task;
+
+    g_mutex_lock (&priv->sched_mutex);
+    g_hash_table_remove (priv->schedulable, task);
+    g_mutex_unlock (&priv->sched_mutex);
+
+    g_hash_table_remove (priv->index, task);
+    g_array_remove_index_fast (priv->tasks, i);
+    /* the last task was moved in its place */
+    if (i < priv->tasks->len)
+        g_hash_table_insert (priv->index,
+                g_array_index (priv->tasks, struct task, i).task,
+                GUINT_TO_POINTER (i + 1));
 }
 
 static void
@@ -310,6 +381,10 @@ donna_provider_task_init (DonnaProviderTask *provider)
     /* 4: random. Probably there won't be more than 4 tasks at once */
     priv->tasks = g_array_sized_new (FALSE, FALSE, sizeof (struct task), 4);
     g_array_set_clear_func (priv->tasks, (GDestroyNotify) free_task);
+    priv->index = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_mutex_init (&priv->sched_mutex);
+    priv->schedulable = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+            g_object_unref, NULL);
     priv->pool = g_thread_pool_new ((GFunc) donna_task_run, NULL,
             -1, FALSE, NULL);
     priv->statuses = g_array_new (FALSE, FALSE, sizeof (struct status));
@@ -364,6 +439,9 @@ provider_task_finalize (GObject *object)
     g_mutex_clear (&priv->mutex);
     g_cond_clear (&priv->cond);
     g_array_free (priv->tasks, TRUE);
+    g_hash_table_unref (priv->index);
+    g_hash_table_unref (priv->schedulable);
+    g_mutex_clear (&priv->sched_mutex);
     g_thread_pool_free (priv->pool, TRUE, FALSE);
     g_array_free (priv->statuses, TRUE);
 
@@ -394,7 +472,7 @@ get_task_from_node (DonnaTaskManager    *tm,
     DonnaProviderTaskPrivate *priv = tm->priv;
     DonnaTask *task;
     gchar *location;
-    guint i;
+    struct task *t;
 
     if (donna_node_peek_provider (node) != (DonnaProvider *) tm
             /* not an item == a container == root/task manager */
@@ -419,18 +497,12 @@ get_task_from_node (DonnaTaskManager    *tm,
     g_free (location);
 
     lock_manager (tm, TM_BUSY_READ);
-    for (i = 0; i < priv->tasks->len; ++i)
-    {
-        struct task *t = &g_array_index (priv->tasks, struct task, i);
-        if (t->task == task)
-        {
-            g_object_ref (task);
-            break;
-        }
-    }
+    t = get_task (priv, task);
+    if (t)
+        g_object_ref (task);
     unlock_manager (tm, TM_BUSY_READ);
 
-    if (i >= priv->tasks->len)
+    if (!t)
     {
         g_set_error (error, DONNA_TASK_MANAGER_ERROR,
                 DONNA_TASK_MANAGER_ERROR_OTHER,
@@ -789,7 +861,7 @@ lock_manager (DonnaProviderTask *tm, TmState state)
     }
     else /* TM_BUSY_REFRESH */
     {
-        if (state & TM_REFRESH_PENDING)
+        if (priv->state & TM_REFRESH_PENDING)
         {
             g_mutex_unlock (&priv->mutex);
             return FALSE;
@@ -888,23 +960,19 @@ refresher (DonnaTask    *task,
                 {
                     DonnaProviderTask *tm;
                     DonnaProviderTaskPrivate *priv;
-                    guint i;
+                    struct task *_t;
 
                     tm = (DonnaProviderTask *) donna_node_peek_provider (node);
                     priv = tm->priv;
 
                     lock_manager (tm, TM_BUSY_READ);
-                    for (i = 0; i < priv->tasks->len; ++i)
+                    _t = get_task (priv, t);
+                    if (_t)
                     {
-                        struct task *_t = &g_array_index (priv->tasks, struct task, i);
-                        if (_t->task == t)
-                        {
-                            if (_t->own_pause)
-                                g_value_set_int (&v, ST_ON_HOLD);
-                            else
-                                g_value_set_int (&v, ST_PAUSED);
-                            break;
-                        }
+                        if (_t->own_pause)
+                            g_value_set_int (&v, ST_ON_HOLD);
+                        else
+                            g_value_set_int (&v, ST_PAUSED);
                     }
                     unlock_manager (tm, TM_BUSY_READ);
                     break;
@@ -1006,21 +1074,17 @@ new_node (DonnaProviderBase *_provider,
             break;
         case DONNA_TASK_PAUSED:
             {
-                guint i;
+                struct task *_t;
 
                 if (!has_lock)
                     lock_manager (tm, TM_BUSY_READ);
-                for (i = 0; i < priv->tasks->len; ++i)
+                _t = get_task (priv, t);
+                if (_t)
                 {
-                    struct task *_t = &g_array_index (priv->tasks, struct task, i);
-                    if (_t->task == t)
-                    {
-                        if (_t->own_pause)
-                            g_value_set_int (&v, ST_ON_HOLD);
-                        else
-                            g_value_set_int (&v, ST_PAUSED);
-                        break;
-                    }
+                    if (_t->own_pause)
+                        g_value_set_int (&v, ST_ON_HOLD);
+                    else
+                        g_value_set_int (&v, ST_PAUSED);
                 }
                 if (!has_lock)
                     unlock_manager (tm, TM_BUSY_READ);
@@ -1171,7 +1235,6 @@ provider_task_new_node (DonnaProviderBase  *_provider,
     else
     {
         DonnaTask *t;
-        guint i;
 
         if (sscanf (location, "/%p", &t) != 1)
         {
@@ -1189,24 +1252,21 @@ provider_task_new_node (DonnaProviderBase  *_provider,
             goto found;
 
         lock_manager ((DonnaProviderTask *) _provider, TM_BUSY_READ);
-        for (i = 0; i < priv->tasks->len; ++i)
-            if (t == g_array_index (priv->tasks, struct task, i).task)
-            {
-                GError *err = NULL;
-
-                node = new_node (_provider, location, t, TRUE, &err);
-                if (!node)
-                {
-                    donna_task_take_error (task, err);
-                    unlock_manager ((DonnaProviderTask *) _provider, TM_BUSY_READ);
-                    return DONNA_TASK_FAILED;
-                }
+        if (get_task (priv, t))
+        {
+            GError *err = NULL;
 
-                break;
+            node = new_node (_provider, location, t, TRUE, &err);
+            if (!node)
+            {
+                donna_task_take_error (task, err);
+                unlock_manager ((DonnaProviderTask *) _provider, TM_BUSY_READ);
+                return DONNA_TASK_FAILED;
             }
+        }
         unlock_manager ((DonnaProviderTask *) _provider, TM_BUSY_READ);
 
-        if (i >= priv->tasks->len)
+        if (!node)
         {
             donna_task_set_error (task, DONNA_PROVIDER_ERROR,
                     DONNA_PROVIDER_ERROR_LOCATION_NOT_FOUND,
@@ -1437,14 +1497,8 @@ provider_task_io (DonnaProviderBase             *_provider,
 
         /* make sure the task exists/is know to the TM (i.e. we have a ref on
          * it) */
-        for (j = 0; j < priv->tasks->len; ++j)
-        {
-            struct task *_t = &g_array_index (priv->tasks, struct task, j);
-            if (_t->task == t)
-                break;
-        }
-
-        if (j >= priv->tasks->len)
+        j = get_task_index (priv, t);
+        if (j == (guint) -1)
         {
             if (!str)
                 str = g_string_new (NULL);
@@ -1468,7 +1522,7 @@ provider_task_io (DonnaProviderBase             *_provider,
         }
 
         /* remove task */
-        g_array_remove_index_fast (priv->tasks, j);
+        remove_task (priv, j);
     }
     unlock_manager (tm, TM_BUSY_WRITE);
 
@@ -1747,8 +1801,10 @@ is_task_override (DonnaTask *t1, DonnaTask *t2)
     DonnaTaskState       t2_state;
     DonnaTaskPriority    t2_priority;
 
-    g_object_get (t1, "state", &t1_state, "priority", &t1_priority, NULL);
-    g_object_get (t2, "state", &t2_state, "priority", &t2_priority, NULL);
+    t1_state    = donna_task_get_state (t1);
+    t1_priority = donna_task_get_priority (t1);
+    t2_state    = donna_task_get_state (t2);
+    t2_priority = donna_task_get_priority (t2);
 
     if (t1_priority > t2_priority)
         return TRUE;
@@ -1761,27 +1817,42 @@ is_task_override (DonnaTask *t1, DonnaTask *t2)
         return FALSE;
 }
 
-static gboolean
-is_task_conflicting (DonnaTask *task, GPtrArray *devices)
+/* devices can only be set once on a task, so once we have them we keep them
+ * interned (as GQuark) so conflicts can be checked without any allocation or
+ * string comparison. Must be called under TM_BUSY_REFRESH */
+static void
+get_devices (struct task *t)
 {
-    GPtrArray *task_devices;
-    guint td;
+    GPtrArray *devices;
+    guint i;
 
-    g_object_get (task, "devices", &task_devices, NULL);
+    g_object_get (t->task, "devices", &devices, NULL);
+    if (!devices)
+        return;
 
-    for (td = 0; td < task_devices->len; ++td)
+    t->nb_devices = devices->len;
+    if (devices->len > 0)
+        t->devices = g_new (GQuark, devices->len);
+    for (i = 0; i < devices->len; ++i)
+        t->devices[i] = g_quark_from_string (devices->pdata[i]);
+    t->got_devices = TRUE;
+    g_ptr_array_unref (devices);
+}
+
+static gboolean
+is_task_conflicting (struct task *t1, struct task *t2)
+{
+    guint d1;
+
+    for (d1 = 0; d1 < t1->nb_devices; ++d1)
     {
-        guint d;
+        guint d2;
 
-        for (d = 0; d < devices->len; ++d)
-            if (streq (task_devices->pdata[td], devices->pdata[d]))
-            {
-                g_ptr_array_unref (task_devices);
+        for (d2 = 0; d2 < t2->nb_devices; ++d2)
+            if (t1->devices[d1] == t2->devices[d2])
                 return TRUE;
-            }
     }
 
-    g_ptr_array_unref (task_devices);
     return FALSE;
 }
 
@@ -1799,10 +1870,50 @@ real_run_task (DonnaTaskManager *tm, DonnaTask *task)
         real_run_task (tm, t->task);                                    \
 } while (0)
 
+/* struct task are in an array, so sorting their pointers gives the order they
+ * have in priv->tasks, which is the order refresh_tm() processes them in */
+static gint
+cmp_task_ptr (gconstpointer a, gconstpointer b)
+{
+    const struct task *t1 = * (const struct task **) a;
+    const struct task *t2 = * (const struct task **) b;
+
+    return (t1 < t2) ? -1 : (t1 > t2) ? 1 : 0;
+}
+
+/* must be called under TM_BUSY_REFRESH. Returns the struct task of all tasks
+ * in schedulable, in the order of priv->tasks */
+static GPtrArray *
+get_schedulable (DonnaProviderTaskPrivate *priv)
+{
+    GHashTableIter it;
+    DonnaTask *task;
+    GPtrArray *arr;
+
+    g_mutex_lock (&priv->sched_mutex);
+    arr = g_ptr_array_sized_new (g_hash_table_size (priv->schedulable));
+    g_hash_table_iter_init (&it, priv->schedulable);
+    while (g_hash_table_iter_next (&it, (gpointer) &task, NULL))
+    {
+        struct task *t = get_task (priv, task);
+
+        /* was removed from the manager */
+        if (G_UNLIKELY (!t))
+            g_hash_table_iter_remove (&it);
+        else
+            g_ptr_array_add (arr, t);
+    }
+    g_mutex_unlock (&priv->sched_mutex);
+
+    g_ptr_array_sort (arr, cmp_task_ptr);
+    return arr;
+}
+
 static DonnaTaskState
 refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
 {
     DonnaProviderTaskPrivate *priv = tm->priv;
+    GPtrArray *tasks;
     GSList *active  = NULL;
     GSList *should  = NULL;
     GSList *l;
@@ -1814,11 +1925,12 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
         /* already a refresh pending */
         return DONNA_TASK_DONE;
 
-    for (i = 0; i < priv->tasks->len; ++i)
+    /* stopped & finished tasks (which can add up) are never looked at */
+    tasks = get_schedulable (priv);
+    for (i = 0; i < tasks->len; ++i)
     {
-        struct task *t = &g_array_index (priv->tasks, struct task, i);
+        struct task *t = tasks->pdata[i];
         DonnaTaskState state;
-        GPtrArray *devices;
         gboolean do_continue;
 
         for (l = should; l; l = l->next)
@@ -1831,8 +1943,9 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
             continue;
 
         /* we get devices even if no_devices is TRUE, for in-memory tasks */
-        g_object_get (t->task, "devices", &devices, NULL);
-        if (!devices)
+        if (!t->got_devices)
+            get_devices (t);
+        if (!t->got_devices)
         {
             if (!no_devices)
             {
@@ -1845,7 +1958,7 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
                 }
             }
         }
-        else if (devices->len == 0)
+        else if (t->nb_devices == 0)
         {
             if (t->in_pool && state == DONNA_TASK_PAUSED)
             {
@@ -1854,14 +1967,8 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
             }
             else if (!(state & DONNA_TASK_IN_RUN))
                 run_task (t);
-            g_ptr_array_unref (devices);
             continue;
         }
-        else if (no_devices)
-        {
-            g_ptr_array_unref (devices);
-            devices = NULL;
-        }
 
         if ((state & DONNA_TASK_IN_RUN) && !g_slist_find (active, t))
             active = g_slist_prepend (active, t);
@@ -1869,8 +1976,6 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
         if (!should)
         {
             should = g_slist_prepend (should, t);
-            if (devices)
-                g_ptr_array_unref (devices);
             continue;
         }
 
@@ -1880,7 +1985,7 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
             struct task *_t = (struct task *) l->data;
 
             /* is there a conflict in devices? */
-            if (no_devices || is_task_conflicting (_t->task, devices))
+            if (no_devices || is_task_conflicting (_t, t))
             {
                 if (is_task_override (t->task, _t->task))
                 {
@@ -1934,8 +2039,6 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
             }
             l = l->next;
         }
-        if (devices)
-            g_ptr_array_unref (devices);
         if (do_continue)
             continue;
 
@@ -1947,6 +2050,7 @@ refresh_tm (DonnaTask *task, DonnaTaskManager *tm)
             should = g_slist_insert (should, t, 1);
     }
 
+    g_ptr_array_unref (tasks);
     if (!should) /* implies !active */
         goto done;
 
@@ -2009,6 +2113,10 @@ run_task_refresh_tm (DonnaProviderTask *tm)
     DonnaProviderTaskPrivate *priv = tm->priv;
     DonnaTask *task;
 
+    /* in case we're from idle_refresh_tm(). Done before the refresh so any
+     * change from now on will queue a new one */
+    g_atomic_int_set (&priv->refresh_queued, FALSE);
+
     task = donna_task_new ((task_fn) refresh_tm, tm, NULL);
     /* INTERNAL_FAST because it should be pretty fast (it is 100% in memory) so
      * there's no need to need/use a(nother) thread just for that.
@@ -2023,6 +2131,15 @@ run_task_refresh_tm (DonnaProviderTask *tm)
     return G_SOURCE_REMOVE;
 }
 
+/* when lots of tasks change state at once, there's no need for a refresh for
+ * each of them: only one is queued, and it'll see all changes */
+static void
+idle_refresh_tm (DonnaProviderTask *tm)
+{
+    if (g_atomic_int_compare_and_exchange (&tm->priv->refresh_queued, FALSE, TRUE))
+        g_idle_add ((GSourceFunc) run_task_refresh_tm, tm);
+}
+
 struct conv
 {
     DonnaTaskManager *tm;
@@ -2075,23 +2192,19 @@ emit_event (struct emit_event *ee)
 {
     DonnaProviderTaskPrivate *priv = ee->tm->priv;
     struct conv conv = { ee->tm, ee->node };
-    guint i;
+    struct task *t;
     gboolean emit = FALSE;
 
     /* WRITE because we might change the post_run flag */
     lock_manager (ee->tm, TM_BUSY_WRITE);
-    for (i = 0; i < priv->tasks->len; ++i)
+    t = get_task (priv, ee->task);
+    if (t)
     {
-        struct task *t = &g_array_index (priv->tasks, struct task, i);
-        if (t->task == ee->task)
+        /* in case we'd get more than one notify::state */
+        if (!t->post_run)
         {
-            /* in case we'd get more than one notify::state */
-            if (!t->post_run)
-            {
-                t->post_run = TRUE;
-                emit = TRUE;
-            }
-            break;
+            t->post_run = TRUE;
+            emit = TRUE;
         }
     }
     unlock_manager (ee->tm, TM_BUSY_WRITE);
@@ -2172,20 +2285,16 @@ notify_cb (DonnaTask *task, GParamSpec *pspec, DonnaTaskManager *tm)
                     break;
                 case DONNA_TASK_PAUSED:
                     {
-                        guint i;
+                        struct task *t;
 
                         lock_manager (tm, TM_BUSY_READ);
-                        for (i = 0; i < priv->tasks->len; ++i)
+                        t = get_task (priv, task);
+                        if (t)
                         {
-                            struct task *t = &g_array_index (priv->tasks, struct task, i);
-                            if (t->task == task)
-                            {
-                                if (t->own_pause)
-                                    g_value_set_int (&v, ST_ON_HOLD);
-                                else
-                                    g_value_set_int (&v, ST_PAUSED);
-                                break;
-                            }
+                            if (t->own_pause)
+                                g_value_set_int (&v, ST_ON_HOLD);
+                            else
+                                g_value_set_int (&v, ST_PAUSED);
                         }
                         unlock_manager (tm, TM_BUSY_READ);
                         break;
@@ -2258,9 +2367,10 @@ next:
          * - and here we end up, in notify_cb and we trigger another refresh_tm
          *   and deadlock waiting for the REFRESH lock we already have...
          */
-        g_idle_add ((GSourceFunc) run_task_refresh_tm, tm);
+        idle_refresh_tm (tm);
      if (is_state)
      {
+         update_schedulable (priv, task);
          refresh_statuses (tm);
          if (!node)
          {
@@ -2300,7 +2410,7 @@ donna_task_manager_add_task (DonnaTaskManager       *tm,
     DonnaProviderBaseClass *klass;
     DonnaProviderBase *pb = (DonnaProviderBase *) tm;
     DonnaTaskVisibility visibility;
-    struct task t;
+    struct task t = { NULL, };
     DonnaNode *node;
 
     g_return_val_if_fail (DONNA_IS_TASK_MANAGER (tm), FALSE);
@@ -2321,13 +2431,15 @@ donna_task_manager_add_task (DonnaTaskManager       *tm,
             g_free (d));
 
     t.task = g_object_ref_sink (task);
-    t.in_pool = t.own_pause = FALSE;
     lock_manager (tm, TM_BUSY_WRITE);
     g_array_append_val (priv->tasks, t);
+    g_hash_table_insert (priv->index, task, GUINT_TO_POINTER (priv->tasks->len));
     unlock_manager (tm, TM_BUSY_WRITE);
 
     refresh_statuses (tm);
     g_signal_connect (task, "notify", (GCallback) notify_cb, tm);
+    /* after connecting, so we can't miss a state change */
+    update_schedulable (priv, task);
 
     run_task_refresh_tm (tm);
 
@@ -2421,7 +2533,7 @@ donna_task_manager_set_state (DonnaTaskManager  *tm,
             if (cur_state == DONNA_TASK_PAUSED)
             {
                 gboolean refresh = FALSE;
-                guint i;
+                struct task *t;
 
                 /* if we didn't own the pause (i.e. it was a manual one) then we
                  * take ownership (make it "on hold") & trigger a refresh. This
@@ -2430,25 +2542,21 @@ donna_task_manager_set_state (DonnaTaskManager  *tm,
 
                 /* WRITE because we want to change own_pause */
                 lock_manager (tm, TM_BUSY_WRITE);
-                for (i = 0; i < priv->tasks->len; ++i)
+                t = get_task (priv, task);
+                if (t)
                 {
-                    struct task *t = &g_array_index (priv->tasks, struct task, i);
-                    if (t->task == task)
+                    if (!t->own_pause)
                     {
-                        if (!t->own_pause)
-                        {
-                            GValue v = G_VALUE_INIT;
+                        GValue v = G_VALUE_INIT;
 
-                            t->own_pause = TRUE;
+                        t->own_pause = TRUE;
 
-                            g_value_init (&v, G_TYPE_INT);
-                            g_value_set_int (&v, ST_ON_HOLD);
-                            donna_node_set_property_value (node, "state", &v);
-                            g_value_unset (&v);
+                        g_value_init (&v, G_TYPE_INT);
+                        g_value_set_int (&v, ST_ON_HOLD);
+                        donna_node_set_property_value (node, "state", &v);
+                        g_value_unset (&v);
 
-                            refresh = TRUE;
-                        }
-                        break;
+                        refresh = TRUE;
                     }
                 }
                 unlock_manager (tm, TM_BUSY_WRITE);
@@ -2474,32 +2582,28 @@ donna_task_manager_set_state (DonnaTaskManager  *tm,
             else if (cur_state == DONNA_TASK_PAUSED)
             {
                 gboolean refresh = FALSE;
-                guint i;
+                struct task *t;
 
                 /* if we owned the pause, we shall release it, so it becomes a
                  * manual pause again (and not "on hold") */
 
                 /* WRITE because we want to change own_pause */
                 lock_manager (tm, TM_BUSY_WRITE);
-                for (i = 0; i < priv->tasks->len; ++i)
+                t = get_task (priv, task);
+                if (t)
                 {
-                    struct task *t = &g_array_index (priv->tasks, struct task, i);
-                    if (t->task == task)
+                    if (t->own_pause)
                     {
-                        if (t->own_pause)
-                        {
-                            GValue v = G_VALUE_INIT;
+                        GValue v = G_VALUE_INIT;
 
-                            t->own_pause = FALSE;
+                        t->own_pause = FALSE;
 
-                            g_value_init (&v, G_TYPE_INT);
-                            g_value_set_int (&v, ST_PAUSED);
-                            donna_node_set_property_value (node, "state", &v);
-                            g_value_unset (&v);
+                        g_value_init (&v, G_TYPE_INT);
+                        g_value_set_int (&v, ST_PAUSED);
+                        donna_node_set_property_value (node, "state", &v);
+                        g_value_unset (&v);
 
-                            refresh = TRUE;
-                        }
-                        break;
+                        refresh = TRUE;
                     }
                 }
                 unlock_manager (tm, TM_BUSY_WRITE);
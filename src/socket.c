@@ -25,6 +25,7 @@
 #include <glib-unix.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -65,6 +66,9 @@
  * sent to socket_process_fn is only the actual message, excluding the length
  * prefix.
  *
+ * Since messages are length-prefixed, they can contain any byte, including NUL
+ * bytes. This is used e.g. to batch multiple requests in a single message.
+ *
  * Creating the actual socket is up to the caller, specifying the file
  * descriptor to donna_socket_new(). #DonnaSocket is reference counted, but it
  * is NOT multithread safe, and should only be used from the main thread/default
@@ -85,10 +89,16 @@ struct _DonnaSocket
     gint fd;
     /* buffer for reading */
     GString *str_in;
+    /* offset of unprocessed data in str_in */
+    gsize in_start;
     /* buffer for writing */
     GString *str_out;
+    /* offset of data yet to be written in str_out */
+    gsize out_start;
     /* source id to read */
     guint sid_in;
+    /* source id to process received data */
+    guint sid_received;
     /* source id to write */
     guint sid_out;
     /* source id on error/hup */
@@ -117,79 +127,93 @@ struct _DonnaSocket
 static gboolean
 socket_received (DonnaSocket *socket)
 {
-    gchar c;
-    gchar *s;
-    gchar *e;
-    guint64 len;
+    socket->sid_received = 0;
 
     if (G_UNLIKELY (socket->in_received))
         return G_SOURCE_REMOVE;
     socket->in_received = TRUE;
 
-    if (G_UNLIKELY (!socket->str_in || socket->str_in->len == 0))
+    /* process all complete messages there are, in place. We only use offsets
+     * (not pointers) in between process() calls, since str_in could be
+     * reallocated if socket->process() started a new main loop */
+    while (socket->fd >= 0 && socket->str_in
+            && socket->in_start < socket->str_in->len)
     {
-        socket->in_received = FALSE;
-        return G_SOURCE_REMOVE;
-    }
+        gchar *start = socket->str_in->str + socket->in_start;
+        gchar *s;
+        gchar *e;
+        guint64 len;
+        gsize offset;
+        gchar c;
+
+        if (*start < '1' || *start > '9')
+        {
+            g_warning ("Socket %d: invalid data received, closing connection",
+                    socket->fd);
+            donna_socket_close (socket);
+            break;
+        }
+        for (s = start + 1; *s >= '0' && *s <= '9'; ++s)
+            ;
+        /* length prefix not fully received yet */
+        if ((gsize) (s - socket->str_in->str) == socket->str_in->len)
+            break;
+        if (*s != ':')
+        {
+            g_warning ("Socket %d: invalid data received, closing connection",
+                    socket->fd);
+            donna_socket_close (socket);
+            break;
+        }
 
-    if (*socket->str_in->str < '1' || *socket->str_in->str > '9')
-    {
-        g_warning ("Socket %d: invalid data received, closing connection",
-                socket->fd);
-        donna_socket_close (socket);
-        socket->in_received = FALSE;
-        return G_SOURCE_REMOVE;
-    }
-    for (s = socket->str_in->str + 1; *s >= '0' && *s <= '9'; ++s)
-        ;
-    if (*s != ':')
-    {
-        g_warning ("Socket %d: invalid data received, closing connection",
-                socket->fd);
-        donna_socket_close (socket);
-        socket->in_received = FALSE;
-        return G_SOURCE_REMOVE;
-    }
+        len = g_ascii_strtoull (start, &e, 10);
+        if (G_UNLIKELY (len == 0 || e != s))
+        {
+            g_warning ("Socket %d: invalid size, closing connection",
+                    socket->fd);
+            donna_socket_close (socket);
+            break;
+        }
 
-    len = g_ascii_strtoull (socket->str_in->str, &e, 10);
-    if (G_UNLIKELY (len == 0 || e != s))
-    {
-        g_warning ("Socket %d: invalid size, closing connection",
-                socket->fd);
-        donna_socket_close (socket);
-        socket->in_received = FALSE;
-        return G_SOURCE_REMOVE;
+        /* beginning of message */
+        offset = (gsize) (s + 1 - socket->str_in->str);
+        /* is the full message there yet? */
+        if (socket->str_in->len - offset < len)
+            break;
+
+        /* end of message (char after the last char in message, ok since
+         * GString always add a NUL-terminating byte) */
+        e = socket->str_in->str + offset + len;
+        c = *e;
+        if (c != '\0')
+            /* already more data in buffer, let's NUL-terminate the message
+             * for processing */
+            *e = '\0';
+
+        socket->process (socket, socket->str_in->str + offset, (gsize) len,
+                socket->data);
+
+        /* don't overwrite if it was NUL, because more data could have been
+         * added to the buffer (if socket->process() started a new main loop,
+         * etc) */
+        if (c != '\0')
+            socket->str_in->str[offset + len] = c;
+
+        socket->in_start = offset + (gsize) len;
     }
 
-    /* beginning of message */
-    ++s;
-    /* is the full message there yet? */
-    if (socket->str_in->len < (gsize) (s - socket->str_in->str) + len)
+    /* only now do we remove processed data, once for all messages */
+    if (socket->str_in)
     {
-        socket->in_received = FALSE;
-        return G_SOURCE_REMOVE;
+        if (socket->in_start >= socket->str_in->len)
+            g_string_truncate (socket->str_in, 0);
+        else if (socket->in_start > 0)
+            g_string_erase (socket->str_in, 0, (gssize) socket->in_start);
+        socket->in_start = 0;
     }
-    /* end of message (char after the last char in message, ok since GString
-     * always add a NUL-terminating byte) */
-    e = s + len;
-
-    c = *e;
-    if (*e != '\0')
-        /* already more data in buffer, let's NUL-terminate the message for
-         * processing */
-        *e = '\0';
-
-    socket->process (socket, s, socket->data);
-
-    /* don't overwrite if it was NUL, because more data could have been added to
-     * the buffer (if socket->process() started a new main loop, etc) */
-    if (c != '\0')
-        *e = c;
-
-    g_string_erase (socket->str_in, 0, (gssize) (e - socket->str_in->str));
 
     socket->in_received = FALSE;
-    return (socket->str_in->len > 0) ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+    return G_SOURCE_REMOVE;
 }
 
 static gboolean
@@ -202,15 +226,16 @@ socket_incoming (gint fd, GIOCondition condition, DonnaSocket *socket)
         return G_SOURCE_REMOVE;
 
     if (!socket->str_in)
-        socket->str_in = g_string_sized_new (1024);
+        socket->str_in = g_string_sized_new (4096);
 
     /* allocated_len always has 1 more char for terminating NUL */
     len = socket->str_in->allocated_len - 1 - socket->str_in->len;
-    if (len == 0)
+    if (len < 1024)
     {
-        len = 1024;
-        g_string_set_size (socket->str_in, socket->str_in->len + len);
-        g_string_truncate (socket->str_in, socket->str_in->len - len);
+        /* GString will (at least) double its allocation */
+        g_string_set_size (socket->str_in, socket->str_in->len + 1024);
+        g_string_truncate (socket->str_in, socket->str_in->len - 1024);
+        len = socket->str_in->allocated_len - 1 - socket->str_in->len;
     }
 
 again:
@@ -231,9 +256,12 @@ again:
     /* GString are always NUL-terminated (w/ extra char allocated for it) */
     socket->str_in->str[socket->str_in->len] = '\0';
 
-    /* this will (try to) process str_in */
-    g_idle_add_full (G_PRIORITY_DEFAULT, (GSourceFunc) socket_received,
-            donna_socket_ref (socket), (GDestroyNotify) donna_socket_unref);
+    /* this will (try to) process str_in; No need to add another source if
+     * there's already one pending, it will process everything */
+    if (socket->sid_received == 0)
+        socket->sid_received = g_idle_add_full (G_PRIORITY_DEFAULT,
+                (GSourceFunc) socket_received,
+                donna_socket_ref (socket), (GDestroyNotify) donna_socket_unref);
 
     return G_SOURCE_CONTINUE;
 }
@@ -367,7 +395,7 @@ donna_socket_close (DonnaSocket    *socket)
     if (socket->fd >= 0)
     {
         close (socket->fd);
-        socket->process (socket, NULL, socket->data);
+        socket->process (socket, NULL, 0, socket->data);
         socket->fd = -1;
     }
     if (socket->sid_in > 0)
@@ -416,6 +444,32 @@ again:
     return written;
 }
 
+static gssize
+_writev (gint fd, struct iovec *iov, gint iovcnt)
+{
+    gssize written;
+
+again:
+    written = writev (fd, iov, iovcnt);
+    if (written < 0)
+    {
+        if (errno == EINTR)
+            goto again;
+        else if (errno == EAGAIN)
+            return 0;
+        else
+        {
+            gint _errno = errno;
+
+            g_warning ("Failed to write to socket %d: %s",
+                    fd, g_strerror (_errno));
+            return -1;
+        }
+    }
+
+    return written;
+}
+
 static gboolean
 socket_out (gint fd, GIOCondition condition, DonnaSocket *socket)
 {
@@ -425,7 +479,8 @@ socket_out (gint fd, GIOCondition condition, DonnaSocket *socket)
                 || socket->fd == -1))
         return G_SOURCE_REMOVE;
 
-    written = _write (socket->fd, socket->str_out->str, socket->str_out->len);
+    written = _write (socket->fd, socket->str_out->str + socket->out_start,
+            socket->str_out->len - socket->out_start);
     if (written == 0)
         return G_SOURCE_CONTINUE;
     else if (written < 0)
@@ -435,13 +490,13 @@ socket_out (gint fd, GIOCondition condition, DonnaSocket *socket)
         return G_SOURCE_REMOVE;
     }
 
-    if ((gsize) written < socket->str_out->len)
-    {
-        g_string_erase (socket->str_out, 0, written);
+    /* no need to move data around, we'll just start from there next time */
+    socket->out_start += (gsize) written;
+    if (socket->out_start < socket->str_out->len)
         return G_SOURCE_CONTINUE;
-    }
 
     g_string_truncate (socket->str_out, 0);
+    socket->out_start = 0;
 
     socket->sid_out = 0;
     return G_SOURCE_REMOVE;
@@ -467,6 +522,7 @@ donna_socket_send (DonnaSocket    *socket,
                    const gchar    *message,
                    gsize           len)
 {
+    struct iovec iov[2];
     gssize written;
     gchar buf[16], *b = buf;
     gsize l;
@@ -474,20 +530,30 @@ donna_socket_send (DonnaSocket    *socket,
     if (socket->fd == -1)
         return FALSE;
 
-    if (socket->str_out && socket->str_out->len > 0)
-    {
-        g_string_append (socket->str_out, message);
-        return TRUE;
-    }
-
     if (len == (gsize) -1)
         len = strlen (message);
 
-    /* first write the size of the message and colon separator */
+    /* the size of the message and colon separator */
     l = (gsize) g_snprintf (buf, 16, "%" G_GSIZE_FORMAT ":", len);
     if (G_UNLIKELY (l >= 16))
         b = g_strdup_printf ("%" G_GSIZE_FORMAT ":", len);
-    written = _write (socket->fd, b, l);
+
+    /* still waiting to send previous message(s), just add to the buffer */
+    if (socket->str_out && socket->str_out->len > 0)
+    {
+        g_string_append_len (socket->str_out, b, (gssize) l);
+        g_string_append_len (socket->str_out, message, (gssize) len);
+        if (G_UNLIKELY (b != buf))
+            g_free (b);
+        return TRUE;
+    }
+
+    /* write both prefix & message at once, without copying */
+    iov[0].iov_base = b;
+    iov[0].iov_len  = l;
+    iov[1].iov_base = (gpointer) message;
+    iov[1].iov_len  = len;
+    written = _writev (socket->fd, iov, 2);
     if (written < 0)
     {
         donna_socket_close (socket);
@@ -495,41 +561,29 @@ donna_socket_send (DonnaSocket    *socket,
             g_free (b);
         return FALSE;
     }
-    else if ((gsize) written < l)
+    else if ((gsize) written == l + len)
     {
-        l -= (gsize) written;
-        if (!socket->str_out)
-            socket->str_out = g_string_sized_new (l + len);
-        g_string_append (socket->str_out, b + l);
-        /* to have the whole message added to buffer */
-        written = 0;
+        if (G_UNLIKELY (b != buf))
+            g_free (b);
+        return TRUE;
     }
-    else /* written == l */
+
+    /* buffer whatever couldn't be written */
+    if (!socket->str_out)
+        socket->str_out = g_string_sized_new (l + len - (gsize) written);
+    if ((gsize) written < l)
     {
-        /* now write the actual message */
-        written = _write (socket->fd, message, len);
-        if (written < 0)
-        {
-            donna_socket_close (socket);
-            if (G_UNLIKELY (b != buf))
-                g_free (b);
-            return FALSE;
-        }
-        else if ((gsize) written == len)
-        {
-            if (G_UNLIKELY (b != buf))
-                g_free (b);
-            return TRUE;
-        }
+        g_string_append_len (socket->str_out, b + written,
+                (gssize) (l - (gsize) written));
+        written = 0;
     }
+    else
+        written -= (gssize) l;
+    g_string_append_len (socket->str_out, message + written,
+            (gssize) (len - (gsize) written));
     if (G_UNLIKELY (b != buf))
         g_free (b);
 
-    len -= (gsize) written;
-    if (!socket->str_out)
-        socket->str_out = g_string_sized_new (len);
-    g_string_append (socket->str_out, message + len);
-
     socket->sid_out = g_unix_fd_add_full (G_PRIORITY_DEFAULT,
             socket->fd, G_IO_OUT,
             (GUnixFDSourceFunc) socket_out,
@@ -38,16 +38,19 @@ typedef struct _DonnaSocket         DonnaSocket;
  * socket_process_fn:
  * @socket: The #DonnaSocket
  * @message: The message to be processed
+ * @len: The length of @message
  * @data: User data specified on donna_socket_new()
  *
  * Function called when a message is received on @socket (handles buffering
  * input until a full message is received).
  *
  * @message is the actual full message to process; or %NULL when @socket is
- * being closed
+ * being closed. It is always NUL-terminated, but could also contain NUL bytes,
+ * hence @len
  */
 typedef void (*socket_process_fn)  (DonnaSocket    *socket,
                                     gchar          *message,
+                                    gsize           len,
                                     gpointer        data);
 
 DonnaSocket *       donna_socket_new            (gint                fd,
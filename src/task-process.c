@@ -609,9 +609,18 @@ task_worker (DonnaTask *task, gpointer data)
                 failed = FAILED_ERROR;
                 break;
             }
+            else if (r == DONNA_TASK_PROCESS_STDIN_CLOSE)
+            {
+                /* nothing more to write, so the child gets EOF */
+                close_fd_in (&fd_in);
+                ++closed;
+            }
 
-            n_in = n;
-            ++n;
+            if (fd_in >= 0)
+            {
+                n_in = n;
+                ++n;
+            }
         }
 
         if (fd_out >= 0)
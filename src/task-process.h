@@ -56,7 +56,8 @@ typedef enum
 {
     DONNA_TASK_PROCESS_STDIN_DONE = 0,
     DONNA_TASK_PROCESS_STDIN_WAIT_NONBLOCKING,
-    DONNA_TASK_PROCESS_STDIN_FAILED
+    DONNA_TASK_PROCESS_STDIN_FAILED,
+    DONNA_TASK_PROCESS_STDIN_CLOSE
 } DonnaTaskProcessStdin;
 
 typedef void                    (*task_init_fn)     (DonnaTaskProcess   *taskp,
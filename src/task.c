@@ -1388,6 +1388,21 @@ donna_task_get_state (DonnaTask *task)
     return task->priv->state;
 }
 
+/**
+ * donna_task_get_priority:
+ * @task: Task to get the priority of
+ *
+ * Helper function to get the #DonnaTask:priority property of @task
+ *
+ * Returns: Current #DonnaTaskPriority of @task
+ */
+DonnaTaskPriority
+donna_task_get_priority (DonnaTask *task)
+{
+    g_return_val_if_fail (DONNA_IS_TASK (task), DONNA_TASK_PRIORITY_NORMAL);
+    return task->priv->priority;
+}
+
 /**
  * donna_task_get_desc:
  * @task: Task to get the description of
@@ -1151,6 +1151,8 @@ struct status
     /* size options */
     gint             digits;
     gboolean         long_unit;
+    /* uses %A, %V or %H (see agg_add_node()) */
+    gboolean         uses_sizes;
 };
 
 /* for conv_flag_fn() used in actions/context menus */
@@ -1171,6 +1173,13 @@ struct _DonnaTreeViewPrivate
     DonnaApp            *app;
     gulong               option_set_sid;
     gulong               option_deleted_sid;
+    /* options changed in config, waiting to be processed (in batch, from
+     * thread UI). pending_options owns the strings, pending_options_set is used
+     * to only process each option once */
+    GMutex               pending_options_mutex;
+    GPtrArray           *pending_options;
+    GHashTable          *pending_options_set;
+    guint                sid_pending_options;
 
     /* tree name */
     gchar               *name;
@@ -1202,13 +1211,18 @@ struct _DonnaTreeViewPrivate
 
     /* current arrangement */
     DonnaArrangement    *arrangement;
+    /* arrangement from our own config, used to complete the one from
+     * select-arrangement. Valid as long as config is at arr_defaults_version */
+    DonnaArrangement    *arr_defaults;
+    guint                arr_defaults_version;
 
     /* properties used by our columns */
     GArray              *col_props;
 
     /* handling of spinners on columns (when setting node properties) */
-    GPtrArray           *active_spinners;
-    guint                active_spinners_id;
+    GHashTable          *active_spinners;   /* node -> struct active_spinners */
+    guint                active_spinners_nb; /* spinners running */
+    guint                active_spinners_id; /* tick callback */
     guint                active_spinners_pulse;
 
     /* current location */
@@ -1270,6 +1284,43 @@ struct _DonnaTreeViewPrivate
     GMutex               refresh_node_props_mutex;
     GSList              *refresh_node_props;
 
+    /* node-updated waiting to be processed (in batch, from thread UI): node ->
+     * GPtrArray of (interned) property names */
+    GMutex               pending_updates_mutex;
+    GHashTable          *pending_updates;
+    guint                sid_pending_updates;
+    /* List: nodes whose size changed during a refresh_on_hold (w/ a ref), so
+     * aggregates can be updated after. Under pending_updates_mutex */
+    GHashTable          *held_sizes;
+
+    /* long operations, processed in time slices (see queue_work()) */
+    GQueue               works;
+    guint                sid_works;
+
+    /* List: range of visible rows, for preloading (see
+     * preload_props_worker()) */
+    GMutex               preload_mutex;
+    gint                 preload_first;
+    gint                 preload_last;
+    guint                preload_gen;
+
+    /* Tree: full location -> node (no ref, hashtable has it) for all nodes on
+     * tree. See get_node_for_location() */
+    GHashTable          *locations;
+
+    /* List: running aggregates for statuses (see agg_add_node()). agg_sizes
+     * is node -> guint64* of the size accounted for that node, only filled
+     * while agg_size_statuses (nb of statuses using sizes) > 0 */
+    GHashTable          *agg_sizes;
+    guint                agg_size_statuses;
+    guint                agg_nb_visible;
+    guint64              agg_size_visible;
+    guint64              agg_size_hidden;
+    /* selection: computed on demand, until selection changes */
+    gboolean             agg_sel_valid;
+    gint                 agg_nb_selected;
+    guint64              agg_size_selected;
+
     /* Tree: list we're synching with */
     DonnaTreeView       *sync_with;
     gulong               sid_sw_location_changed;
@@ -1430,6 +1481,8 @@ _donna_config_get_extra_value (DonnaConfigExtra *extra, const gchar *str, gpoint
 
 /* internal; used by app.c */
 gboolean _donna_tree_view_register_extras (DonnaConfig *config, GError **error);
+DonnaArrangement * _donna_tree_view_dup_arrangement (DonnaArrangement *arr);
+void _donna_tree_view_free_arrangement (DonnaArrangement *arr);
 
 static inline struct column *
                     get_column_by_column                (DonnaTreeView  *tree,
@@ -1493,7 +1546,6 @@ static gboolean is_row_accessible                       (DonnaTreeView   *tree,
                                                          GtkTreeIter     *iter);
 static struct active_spinners * get_as_for_node         (DonnaTreeView   *tree,
                                                          DonnaNode       *node,
-                                                         guint           *index,
                                                          gboolean         create);
 static void set_children                                (DonnaTreeView *tree,
                                                          GtkTreeIter   *iter,
@@ -1516,6 +1568,8 @@ static gboolean maxi_expand_row                         (DonnaTreeView  *tree,
 static gboolean maxi_collapse_row                       (DonnaTreeView  *tree,
                                                          GtkTreeIter    *iter);
 static inline void resort_tree                          (DonnaTreeView  *tree);
+static void cancel_works                                (DonnaTreeView  *tree);
+static void clear_done_refresh_node_props               (DonnaTreeViewPrivate *priv);
 static gboolean select_arrangement_accumulator      (GSignalInvocationHint  *hint,
                                                      GValue                 *return_accu,
                                                      const GValue           *return_handler,
@@ -1873,14 +1927,21 @@ donna_tree_view_init (DonnaTreeView *tv)
      * be replacing values often (since head of GSList can change) but don't
      * want the old value to be free-d, obviously */
     priv->hashtable = g_hash_table_new (g_direct_hash, g_direct_equal);
+    priv->agg_sizes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+            NULL, g_free);
+    priv->locations = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, NULL);
 
     priv->providers = g_ptr_array_new_with_free_func (
             (GDestroyNotify) free_provider_signals);
     g_mutex_init (&priv->refresh_node_props_mutex);
+    g_mutex_init (&priv->pending_options_mutex);
+    g_mutex_init (&priv->pending_updates_mutex);
+    g_mutex_init (&priv->preload_mutex);
     priv->col_props = g_array_new (FALSE, FALSE, sizeof (struct col_prop));
     g_array_set_clear_func (priv->col_props, (GDestroyNotify) free_col_prop);
-    priv->active_spinners = g_ptr_array_new_with_free_func (
-            (GDestroyNotify) free_active_spinners);
+    priv->active_spinners = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify) free_active_spinners);
     priv->statuses = g_array_new (FALSE, FALSE, sizeof (struct status));
     g_array_set_clear_func (priv->statuses, (GDestroyNotify) free_status);
 }
@@ -2013,10 +2074,11 @@ donna_tree_view_destroy (GtkWidget      *widget)
 {
     DonnaTreeViewPrivate *priv = ((DonnaTreeView *) widget)->priv;
 
+    /* rows/nodes are going away */
+    cancel_works ((DonnaTreeView *) widget);
+
     if (priv->hashtable)
     {
-        DonnaRowId rid = { DONNA_ARG_TYPE_PATH, (gpointer) ":last" };
-
         /* to avoid warning about lost selection in BROWSE mode or trying to
          * sync on change location */
         g_signal_handlers_disconnect_by_func (
@@ -2024,14 +2086,18 @@ donna_tree_view_destroy (GtkWidget      *widget)
                 selection_changed_cb, widget);
         /* clear the list (see selection_changed_cb() for why filling_list) */
         priv->filling_list = TRUE;
-        /* speed up -- see change_location() for why */
-        donna_tree_view_set_focus ((DonnaTreeView *) widget, &rid, NULL);
+        /* speed up -- see clear_list() for why */
+        gtk_tree_view_set_model ((GtkTreeView *) widget, NULL);
         gtk_tree_store_clear (priv->store);
         priv->filling_list = FALSE;
 
         g_hash_table_foreach (priv->hashtable, (GHFunc) free_hashtable, widget);
         g_hash_table_destroy (priv->hashtable);
         priv->hashtable = NULL;
+        g_hash_table_destroy (priv->agg_sizes);
+        priv->agg_sizes = NULL;
+        g_hash_table_destroy (priv->locations);
+        priv->locations = NULL;
     }
 
     if (priv->location)
@@ -2080,9 +2146,29 @@ donna_tree_view_finalize (GObject *object)
     donna_tree_view_destroy ((GtkWidget *) object);
     donna_g_object_unref (priv->sync_with);
     g_ptr_array_free (priv->providers, TRUE);
+    g_mutex_lock (&priv->refresh_node_props_mutex);
+    clear_done_refresh_node_props (priv);
+    g_mutex_unlock (&priv->refresh_node_props_mutex);
     g_mutex_clear (&priv->refresh_node_props_mutex);
+    free_arrangement (priv->arr_defaults);
+    if (priv->sid_pending_options > 0)
+        g_source_remove (priv->sid_pending_options);
+    if (priv->pending_options)
+    {
+        g_ptr_array_free (priv->pending_options, TRUE);
+        g_hash_table_unref (priv->pending_options_set);
+    }
+    g_mutex_clear (&priv->pending_options_mutex);
+    if (priv->sid_pending_updates > 0)
+        g_source_remove (priv->sid_pending_updates);
+    if (priv->pending_updates)
+        g_hash_table_unref (priv->pending_updates);
+    if (priv->held_sizes)
+        g_hash_table_unref (priv->held_sizes);
+    g_mutex_clear (&priv->pending_updates_mutex);
+    g_mutex_clear (&priv->preload_mutex);
     g_array_free (priv->col_props, TRUE);
-    g_ptr_array_free (priv->active_spinners, TRUE);
+    g_hash_table_unref (priv->active_spinners);
     g_slist_free_full (priv->columns, (GDestroyNotify) free_column);
     g_slist_free_full (priv->columns_filter, (GDestroyNotify) free_column_filter);
     if (priv->tree_visuals)
@@ -3793,20 +3879,91 @@ done:
     return G_SOURCE_REMOVE;
 }
 
+static gboolean
+pending_options_cb (DonnaTreeView *tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GPtrArray *options;
+    guint i;
+
+    g_mutex_lock (&priv->pending_options_mutex);
+    options = priv->pending_options;
+    g_hash_table_unref (priv->pending_options_set);
+    priv->pending_options = NULL;
+    priv->pending_options_set = NULL;
+    priv->sid_pending_options = 0;
+    g_mutex_unlock (&priv->pending_options_mutex);
+
+    /* in the order they were changed; real_option_cb() takes ownership of the
+     * strings */
+    for (i = 0; i < options->len; ++i)
+    {
+        struct option_data *od;
+
+        od = g_new (struct option_data, 1);
+        od->tree = tree;
+        od->option = options->pdata[i];
+        od->opt = OPT_NONE;
+        real_option_cb (od);
+    }
+    g_ptr_array_free (options, FALSE);
+
+    return G_SOURCE_REMOVE;
+}
+
 static void
 option_cb (DonnaConfig *config, const gchar *option, DonnaTreeView *tree)
 {
-    struct option_data *od;
+    DonnaTreeViewPrivate *priv = tree->priv;
 
     /* see donna_tree_view_save_to_config() */
-    if (tree->priv->saving_config)
+    if (priv->saving_config)
+        return;
+
+    /* in thread UI changes are processed right away, as they've always been,
+     * so e.g. a command setting an option sees its effect once it returns */
+    if (g_main_context_is_owner (g_main_context_default ()))
+    {
+        struct option_data *od;
+        gboolean has_pending;
+
+        /* but first process the pending ones, to respect the order */
+        g_mutex_lock (&priv->pending_options_mutex);
+        has_pending = priv->sid_pending_options > 0;
+        if (has_pending)
+            g_source_remove (priv->sid_pending_options);
+        g_mutex_unlock (&priv->pending_options_mutex);
+        if (has_pending)
+            pending_options_cb (tree);
+
+        od = g_new (struct option_data, 1);
+        od->tree = tree;
+        od->option = g_strdup (option);
+        od->opt = OPT_NONE;
+        real_option_cb (od);
         return;
+    }
+
+    /* scripts can set quite a few options in a row (from other threads), so
+     * instead of processing each change on its own we batch them, and process
+     * them all (each only once) from one source in thread UI */
+    g_mutex_lock (&priv->pending_options_mutex);
+    if (!priv->pending_options)
+    {
+        priv->pending_options = g_ptr_array_new_with_free_func (g_free);
+        priv->pending_options_set = g_hash_table_new (g_str_hash, g_str_equal);
+    }
+    if (!g_hash_table_contains (priv->pending_options_set, option))
+    {
+        gchar *s = g_strdup (option);
 
-    od = g_new (struct option_data, 1);
-    od->tree = tree;
-    od->option = g_strdup (option);
-    od->opt = OPT_NONE;
-    g_main_context_invoke (NULL, (GSourceFunc) real_option_cb, od);
+        g_ptr_array_add (priv->pending_options, s);
+        g_hash_table_add (priv->pending_options_set, s);
+    }
+    if (priv->sid_pending_options == 0)
+        priv->sid_pending_options = g_idle_add_full (G_PRIORITY_DEFAULT,
+                (GSourceFunc) pending_options_cb, tree, NULL);
+    g_mutex_unlock (&priv->pending_options_mutex);
 }
 
 static void
@@ -4199,6 +4356,164 @@ handle_removing_row (DonnaTreeView *tree, GtkTreeIter *iter, gboolean is_focus)
     }
 }
 
+/* mode list only -- aggregates (count/size of visible/hidden nodes) used by
+ * statuses are maintained as nodes get added/removed/shown/hidden, so rendering
+ * the statusbar doesn't require to go through all nodes.
+ * Sizes are only tracked while a status uses them, and never refreshed: if a
+ * node doesn't have its size yet, it will be accounted for once it does (see
+ * agg_update_size()) */
+static void
+agg_add_size (DonnaTreeViewPrivate *priv, DonnaNode *node, gboolean is_visible)
+{
+    guint64 size;
+    guint64 *s;
+
+    if (donna_node_get_node_type (node) != DONNA_NODE_ITEM
+            || donna_node_get_size (node, FALSE, &size) != DONNA_NODE_VALUE_SET)
+        return;
+
+    s = g_new (guint64, 1);
+    *s = size;
+    g_hash_table_insert (priv->agg_sizes, node, s);
+    if (is_visible)
+        priv->agg_size_visible += size;
+    else
+        priv->agg_size_hidden += size;
+}
+
+static void
+agg_add_node (DonnaTreeViewPrivate *priv, DonnaNode *node, gboolean is_visible)
+{
+    if (is_visible)
+        ++priv->agg_nb_visible;
+    if (priv->agg_size_statuses > 0)
+        agg_add_size (priv, node, is_visible);
+}
+
+static void
+agg_remove_node (DonnaTreeViewPrivate *priv, DonnaNode *node, gboolean was_visible)
+{
+    guint64 *size;
+
+    if (was_visible)
+        --priv->agg_nb_visible;
+
+    size = g_hash_table_lookup (priv->agg_sizes, node);
+    if (!size)
+        return;
+
+    if (was_visible)
+        priv->agg_size_visible -= *size;
+    else
+        priv->agg_size_hidden -= *size;
+    g_hash_table_remove (priv->agg_sizes, node);
+}
+
+static void
+agg_set_visible (DonnaTreeViewPrivate *priv, DonnaNode *node, gboolean is_visible)
+{
+    guint64 *size;
+
+    size = g_hash_table_lookup (priv->agg_sizes, node);
+    if (is_visible)
+    {
+        ++priv->agg_nb_visible;
+        if (size)
+        {
+            priv->agg_size_hidden -= *size;
+            priv->agg_size_visible += *size;
+        }
+    }
+    else
+    {
+        --priv->agg_nb_visible;
+        if (size)
+        {
+            priv->agg_size_visible -= *size;
+            priv->agg_size_hidden += *size;
+        }
+    }
+}
+
+/* node's size was updated, node might not be in hashtable */
+static void
+agg_update_size (DonnaTreeViewPrivate *priv, DonnaNode *node)
+{
+    GtkTreeIter *iter;
+
+    /* selection might include it */
+    priv->agg_sel_valid = FALSE;
+    if (priv->is_tree || priv->agg_size_statuses == 0
+            || !g_hash_table_lookup_extended (priv->hashtable, node,
+                NULL, (gpointer) &iter))
+        return;
+
+    agg_remove_node (priv, node, !!iter);
+    agg_add_node (priv, node, !!iter);
+}
+
+static void
+agg_clear (DonnaTreeViewPrivate *priv)
+{
+    g_hash_table_remove_all (priv->agg_sizes);
+    priv->agg_nb_visible = 0;
+    priv->agg_size_visible = 0;
+    priv->agg_size_hidden = 0;
+    priv->agg_sel_valid = FALSE;
+}
+
+/* mode list only -- a status using sizes was added (load) or removed (drop) */
+static void
+agg_set_uses_sizes (DonnaTreeViewPrivate *priv, gboolean uses_sizes)
+{
+    if (uses_sizes)
+    {
+        GHashTableIter it;
+        DonnaNode *node;
+        GtkTreeIter *iter;
+
+        if (priv->agg_size_statuses++ > 0 || priv->is_tree || !priv->hashtable)
+            return;
+
+        g_hash_table_iter_init (&it, priv->hashtable);
+        while (g_hash_table_iter_next (&it, (gpointer) &node, (gpointer) &iter))
+            agg_add_size (priv, node, !!iter);
+    }
+    else
+    {
+        /* (might be after destroy) */
+        if (--priv->agg_size_statuses > 0 || !priv->agg_sizes)
+            return;
+
+        g_hash_table_remove_all (priv->agg_sizes);
+        priv->agg_size_visible = 0;
+        priv->agg_size_hidden = 0;
+    }
+}
+
+/* mode list only -- apply the size updates that were held during a
+ * refresh_on_hold */
+static void
+agg_update_held_sizes (DonnaTreeViewPrivate *priv)
+{
+    GHashTable *held;
+    GHashTableIter it;
+    DonnaNode *node;
+
+    g_mutex_lock (&priv->pending_updates_mutex);
+    held = priv->held_sizes;
+    priv->held_sizes = NULL;
+    g_mutex_unlock (&priv->pending_updates_mutex);
+
+    if (!held)
+        return;
+
+    g_hash_table_iter_init (&it, held);
+    while (g_hash_table_iter_next (&it, (gpointer) &node, NULL))
+        agg_update_size (priv, node);
+    g_hash_table_unref (held);
+}
+
 static void
 remove_node_from_list (DonnaTreeView    *tree,
                        DonnaNode        *node,
@@ -4238,10 +4553,32 @@ remove_node_from_list (DonnaTreeView    *tree,
         }
     }
 
+    agg_remove_node (priv, node, FALSE);
     g_hash_table_remove (priv->hashtable, node);
     g_object_unref (node);
 }
 
+static gboolean
+is_indexed_as (gpointer key, gpointer value, gpointer node)
+{
+    return value == node;
+}
+
+/* remove node from the locations index. Since a node's location can change
+ * (e.g. on rename) we can't only rely on its current location to find it */
+static void
+unindex_node (DonnaTreeViewPrivate *priv, DonnaNode *node)
+{
+    gchar *fl;
+
+    fl = donna_node_get_full_location (node);
+    if (g_hash_table_lookup (priv->locations, fl) == node)
+        g_hash_table_remove (priv->locations, fl);
+    else
+        g_hash_table_foreach_remove (priv->locations, is_indexed_as, node);
+    g_free (fl);
+}
+
 /* similar to gtk_tree_store_remove() this will set iter to next row at that
  * level, or invalid it if it pointer to the last one.
  * Returns TRUE if iter is still valid, else FALSE */
@@ -4529,6 +4866,7 @@ remove_row_from_tree (DonnaTreeView *tree,
                 g_hash_table_insert (priv->hashtable, node, list);
             else
             {
+                unindex_node (priv, node);
                 g_hash_table_remove (priv->hashtable, node);
                 /* remove the ref from hashtable */
                 g_object_unref (node);
@@ -4545,13 +4883,17 @@ remove_row_from_tree (DonnaTreeView *tree,
                         g_debug2 ("TreeView '%s': remove node '%s' from hashtable",
                             priv->name, fl);
                         g_free (fl));
+                agg_remove_node (priv, node, TRUE);
                 g_hash_table_remove (priv->hashtable, node);
                 /* remove the ref from hashtable */
                 g_object_unref (node);
             }
             else
+            {
                 /* not visible anymore */
+                agg_set_visible (priv, node, FALSE);
                 g_hash_table_insert (priv->hashtable, node, NULL);
+            }
         }
     }
 
@@ -4638,17 +4980,40 @@ refresh_node_cb (DonnaTask              *task,
     {
         data->tree->priv->refresh_on_hold = FALSE;
         resort_tree (data->tree);
+        /* size updates were held while on hold */
+        if (!data->tree->priv->is_tree)
+            agg_update_held_sizes (data->tree->priv);
         /* in case any name or size changed, since it was refresh_on_hold */
         check_statuses (data->tree, STATUS_CHANGED_ON_CONTENT);
         g_free (data);
     }
 }
 
+/* max nb of refresh tasks started by preloading running at once, so it never
+ * starves other (interactive) refreshes */
+#define PRELOAD_MAX_RUNNING     4
+
 struct preload_props
 {
     DonnaTreeView *tree;
     GPtrArray *props;
+    /* nodes, in the order rows were on list when we started */
     GPtrArray *nodes;
+    /* ref by the worker, and each running task */
+    gint ref;
+    GMutex mutex;
+    GCond cond;
+    /* refresh tasks started & not done yet */
+    GPtrArray *running;
+    /* worker only: nodes processed, and where we are. See
+     * preload_next_index() */
+    gchar *done;
+    guint gen;
+    gint first;
+    gint last;
+    gint cur;
+    gint dist;
+    gboolean below;
 };
 
 static void
@@ -4656,27 +5021,125 @@ free_preload_props (gpointer data)
 {
     struct preload_props *pp = data;
 
+    if (!g_atomic_int_dec_and_test (&pp->ref))
+        return;
+
     g_ptr_array_unref (pp->props);
     g_ptr_array_unref (pp->nodes);
+    g_ptr_array_unref (pp->running);
+    g_mutex_clear (&pp->mutex);
+    g_cond_clear (&pp->cond);
+    g_free (pp->done);
     g_free (pp);
 }
 
+/* mode list only -- remember the range of visible rows, for preloading */
+static void
+update_preload_range (DonnaTreeView *tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreePath *start;
+    GtkTreePath *end;
+    gint first;
+    gint last;
+
+    if (!gtk_tree_view_get_visible_range ((GtkTreeView *) tree, &start, &end))
+        return;
+    first = gtk_tree_path_get_indices (start)[0];
+    last  = gtk_tree_path_get_indices (end)[0];
+    gtk_tree_path_free (start);
+    gtk_tree_path_free (end);
+
+    g_mutex_lock (&priv->preload_mutex);
+    if (first != priv->preload_first || last != priv->preload_last)
+    {
+        priv->preload_first = first;
+        priv->preload_last  = last;
+        ++priv->preload_gen;
+    }
+    g_mutex_unlock (&priv->preload_mutex);
+}
+
+/* returns the index of the next node to process: first the visible rows, then
+ * the ones right below & above, then further & further away from the visible
+ * range. Returns -1 once all nodes have been processed */
+static gint
+preload_next_index (struct preload_props *pp)
+{
+    gint n = (gint) pp->nodes->len;
+
+    for (;;)
+    {
+        gint i;
+
+        if (pp->cur <= pp->last)
+            i = pp->cur++;
+        else if (pp->below)
+        {
+            i = pp->first - pp->dist;
+            pp->below = FALSE;
+        }
+        else
+        {
+            if (pp->last + pp->dist >= n - 1 && pp->first - pp->dist <= 0)
+                return -1;
+            ++pp->dist;
+            i = pp->last + pp->dist;
+            pp->below = TRUE;
+        }
+
+        if (i >= 0 && i < n && !pp->done[i])
+            return i;
+    }
+}
+
+static void
+preload_task_cb (DonnaTask              *task,
+                 gboolean                timeout_called,
+                 struct preload_props   *pp)
+{
+    g_mutex_lock (&pp->mutex);
+    g_ptr_array_remove_fast (pp->running, task);
+    g_cond_signal (&pp->cond);
+    g_mutex_unlock (&pp->mutex);
+    free_preload_props (pp);
+}
+
 static DonnaTaskState
 preload_props_worker (DonnaTask *task, struct preload_props *pp)
 {
+    DonnaTreeViewPrivate *priv = pp->tree->priv;
     GPtrArray *tasks = NULL;
-    guint i;
+    gboolean cancelled = FALSE;
+    gint i;
+
+    pp->done = g_new0 (gchar, pp->nodes->len);
+    pp->gen = G_MAXUINT;
 
-    for (i = 0; i < pp->nodes->len; ++i)
+    while (!donna_task_is_cancelling (task))
     {
-        DonnaNode *node = pp->nodes->pdata[i];
+        DonnaNode *node;
         GPtrArray *props = NULL;
         guint j;
 
-        if (donna_task_is_cancelling (task))
-            /* XXX should we remember all started/running tasks, and cancel them
-             * as well? */
+        /* visible range changed (e.g. scrolling), start again from there */
+        g_mutex_lock (&priv->preload_mutex);
+        if (pp->gen != priv->preload_gen)
+        {
+            pp->gen   = priv->preload_gen;
+            pp->first = CLAMP (priv->preload_first, 0, (gint) pp->nodes->len - 1);
+            pp->last  = CLAMP (priv->preload_last, pp->first, (gint) pp->nodes->len - 1);
+            pp->cur   = pp->first;
+            pp->dist  = 0;
+            pp->below = FALSE;
+        }
+        g_mutex_unlock (&priv->preload_mutex);
+
+        i = preload_next_index (pp);
+        if (i < 0)
             break;
+        pp->done[i] = 1;
+        node = pp->nodes->pdata[i];
 
         for (j = 0; j < pp->props->len; ++j)
         {
@@ -4696,6 +5159,19 @@ preload_props_worker (DonnaTask *task, struct preload_props *pp)
         {
             GPtrArray *arr;
 
+            /* wait for a running task to be done, if we're at the max */
+            g_mutex_lock (&pp->mutex);
+            while (pp->running->len >= PRELOAD_MAX_RUNNING
+                    && !donna_task_is_cancelling (task))
+                g_cond_wait_until (&pp->cond, &pp->mutex,
+                        g_get_monotonic_time () + G_TIME_SPAN_SECOND / 10);
+            g_mutex_unlock (&pp->mutex);
+            if (donna_task_is_cancelling (task))
+            {
+                g_ptr_array_unref (props);
+                break;
+            }
+
             arr = donna_node_refresh_arr_tasks_arr (node, tasks, props, NULL);
             if (G_UNLIKELY (!arr))
                 continue;
@@ -4703,17 +5179,57 @@ preload_props_worker (DonnaTask *task, struct preload_props *pp)
                 tasks = arr;
 
             for (j = 0; j < tasks->len; ++j)
-                donna_app_run_task (pp->tree->priv->app, (DonnaTask *) tasks->pdata[j]);
+            {
+                DonnaTask *t = tasks->pdata[j];
+
+                g_atomic_int_inc (&pp->ref);
+                g_mutex_lock (&pp->mutex);
+                g_ptr_array_add (pp->running, g_object_ref (t));
+                g_mutex_unlock (&pp->mutex);
+                donna_task_set_callback (t, (task_callback_fn) preload_task_cb,
+                        pp, free_preload_props);
+                donna_app_run_task (priv->app, t);
+            }
             if (tasks->len > 0)
                 g_ptr_array_remove_range (tasks, 0, tasks->len);
         }
     }
 
-    g_object_set_data ((GObject *) pp->tree, DATA_PRELOAD_TASK, NULL);
+    /* wait for the tasks we started, cancelling them if we are */
+    g_mutex_lock (&pp->mutex);
+    while (pp->running->len > 0)
+    {
+        if (!cancelled && donna_task_is_cancelling (task))
+        {
+            GPtrArray *arr;
+            guint j;
+
+            /* not under lock, since the callback will need it */
+            arr = g_ptr_array_new_full (pp->running->len, g_object_unref);
+            for (j = 0; j < pp->running->len; ++j)
+                g_ptr_array_add (arr, g_object_ref (pp->running->pdata[j]));
+            g_mutex_unlock (&pp->mutex);
+
+            for (j = 0; j < arr->len; ++j)
+                donna_task_cancel ((DonnaTask *) arr->pdata[j]);
+            g_ptr_array_unref (arr);
+            cancelled = TRUE;
+
+            g_mutex_lock (&pp->mutex);
+            continue;
+        }
+        g_cond_wait_until (&pp->cond, &pp->mutex,
+                g_get_monotonic_time () + G_TIME_SPAN_SECOND / 10);
+    }
+    g_mutex_unlock (&pp->mutex);
+
+    /* unless it was cancelled & another one started since */
+    if (g_object_get_data ((GObject *) pp->tree, DATA_PRELOAD_TASK) == task)
+        g_object_set_data ((GObject *) pp->tree, DATA_PRELOAD_TASK, NULL);
     if (tasks)
         g_ptr_array_unref (tasks);
     free_preload_props (pp);
-    return DONNA_TASK_DONE;
+    return (donna_task_is_cancelling (task)) ? DONNA_TASK_CANCELLED : DONNA_TASK_DONE;
 }
 
 /* mode list only */
@@ -4763,12 +5279,13 @@ preload_props_columns (DonnaTreeView *tree)
         return;
     }
 
-    pp = g_new (struct preload_props, 1);
+    pp = g_new0 (struct preload_props, 1);
     pp->tree  = tree;
     pp->props = props;
-    /* this actually returns all nodes (not just non-visible ones), but it's
-     * easier to do that way, and since their properties will be loaded already,
-     * no refreshing will be triggered anyways */
+    /* this returns all nodes (including visible ones, whose properties are
+     * probably being loaded already, in which case no refreshing will be
+     * triggered), in the order of the rows, so the worker can start with the
+     * visible ones (see preload_next_index()) */
     pp->nodes = donna_tree_view_get_nodes (tree, &rid, FALSE, &err);
     if (G_UNLIKELY (!pp->nodes))
     {
@@ -4780,6 +5297,11 @@ preload_props_columns (DonnaTreeView *tree)
         g_free (pp);
         return;
     }
+    pp->ref = 1;
+    g_mutex_init (&pp->mutex);
+    g_cond_init (&pp->cond);
+    pp->running = g_ptr_array_new_with_free_func (g_object_unref);
+    update_preload_range (tree);
 
     task = donna_task_new ((task_fn) preload_props_worker, pp, free_preload_props);
     if (G_UNLIKELY (!task))
@@ -4801,6 +5323,64 @@ preload_props_columns (DonnaTreeView *tree)
     donna_app_run_task (priv->app, task);
 }
 
+/* mode list only -- with the model set, GTK reacts to each and every
+ * row-inserted/row-deleted from the store, updating its rbtree and figuring out
+ * where to move the focus to, which when there's thousands of rows slows things
+ * down quite a bit. So for bulk operations we unset the model, and set it back
+ * once done, having GTK process all rows at once.
+ * Obviously selection & focus are lost in the process. */
+static gint
+detach_model (DonnaTreeView *tree)
+{
+    GtkTreeView *treev = (GtkTreeView *) tree;
+    gint search_col;
+
+    /* GTK resets the search column when unsetting the model */
+    search_col = gtk_tree_view_get_search_column (treev);
+    gtk_tree_view_set_model (treev, NULL);
+    return search_col;
+}
+
+static void
+attach_model (DonnaTreeView *tree, gint search_col)
+{
+    GtkTreeView *treev = (GtkTreeView *) tree;
+
+    gtk_tree_view_set_model (treev, (GtkTreeModel *) tree->priv->store);
+    gtk_tree_view_set_search_column (treev, search_col);
+}
+
+/* mode list only -- clears the list, i.e. store & hashtable */
+static void
+clear_list (DonnaTreeView *tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GHashTableIter ht_it;
+    GtkTreeIter *iter;
+    DonnaNode *node;
+    gint search_col;
+
+    /* clearing the store is then only about freeing its rows (see
+     * selection_changed_cb() for why filling_list) */
+    priv->filling_list = TRUE;
+    search_col = detach_model (tree);
+    gtk_tree_store_clear (priv->store);
+    attach_model (tree, search_col);
+    priv->filling_list = FALSE;
+
+    /* also the hashtable. First we need to free the iters & unref the nodes,
+     * then actually clear it */
+    g_hash_table_iter_init (&ht_it, priv->hashtable);
+    while (g_hash_table_iter_next (&ht_it, (gpointer) &node, (gpointer) &iter))
+    {
+        if (iter)
+            gtk_tree_iter_free (iter);
+        g_object_unref (node);
+    }
+    g_hash_table_remove_all (priv->hashtable);
+    agg_clear (priv);
+}
+
 /* mode list only -- node *MUST* be in hashtable */
 static gboolean
 refilter_node (DonnaTreeView *tree, DonnaNode *node, GtkTreeIter *iter)
@@ -4858,6 +5438,7 @@ refilter_node (DonnaTreeView *tree, DonnaNode *node, GtkTreeIter *iter)
                     -1);
             /* update hashtable */
             g_hash_table_insert (priv->hashtable, node, gtk_tree_iter_copy (&it));
+            agg_set_visible (priv, node, TRUE);
 
             if (was_empty)
             {
@@ -4977,30 +5558,11 @@ set_children (DonnaTreeView *tree,
         }
         else
         {
-            GHashTableIter ht_it;
-            GtkTreeIter *it;
             DonnaNode *node;
 
             if (is_match)
             {
-                DonnaRowId rid = { DONNA_ARG_TYPE_PATH, (gpointer) ":last" };
-                /* clear the list (see selection_changed_cb() for why
-                 * filling_list) */
-                priv->filling_list = TRUE;
-                /* speed up -- see change_location() for why */
-                donna_tree_view_set_focus (tree, &rid, NULL);
-                gtk_tree_store_clear (priv->store);
-                priv->filling_list = FALSE;
-                /* also the hashtable. First we need to free the iters & unref
-                 * the nodes, then actually clear it */
-                g_hash_table_iter_init (&ht_it, priv->hashtable);
-                while (g_hash_table_iter_next (&ht_it, (gpointer) &node, (gpointer) &it))
-                {
-                    if (it)
-                        gtk_tree_iter_free (it);
-                    g_object_unref (node);
-                }
-                g_hash_table_remove_all (priv->hashtable);
+                clear_list (tree);
 
                 /* show the "location empty" message */
                 set_draw_state (tree, DRAW_EMPTY);
@@ -5157,15 +5719,26 @@ set_children (DonnaTreeView *tree,
         GPtrArray *tasks = NULL;
         GPtrArray *props = NULL;
         GHashTableIter ht_it;
-        GSList *list = NULL;
+        GHashTable *old = NULL;
         DonnaNode *node;
+        gboolean bulk;
+        gint search_col = 0;
         guint i;
+#ifdef DONNA_DEBUG_ENABLED
+        gint64 t = g_get_monotonic_time ();
+#endif
 
-        if (is_match)
+        /* list is empty (e.g. new location): bulk load, i.e. fill the store
+         * w/out the model set (see detach_model()) */
+        bulk = g_hash_table_size (priv->hashtable) == 0;
+
+        /* nodes currently on list, so we can remove the ones not in children */
+        if (is_match && !bulk)
         {
+            old = g_hash_table_new (g_direct_hash, g_direct_equal);
             g_hash_table_iter_init (&ht_it, priv->hashtable);
             while (g_hash_table_iter_next (&ht_it, (gpointer) &node, NULL))
-                list = g_slist_prepend (list, node);
+                g_hash_table_add (old, node);
         }
 
         if (refresh)
@@ -5197,6 +5770,8 @@ set_children (DonnaTreeView *tree,
         gtk_tree_sortable_set_sort_column_id (sortable,
                 GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID, order);
         priv->filling_list = TRUE;
+        if (bulk)
+            search_col = detach_model (tree);
 
         for (i = 0; i < children->len; ++i)
         {
@@ -5209,11 +5784,9 @@ set_children (DonnaTreeView *tree,
 
             /* make sure it's in the hashmap (adding it if not) & get the iter
              * (if row is visible) */
-            if (g_hash_table_lookup_extended (priv->hashtable, node,
+            if (!bulk && g_hash_table_lookup_extended (priv->hashtable, node,
                         NULL, (gpointer) &iter))
             {
-                GSList *l, *prev = NULL;
-
                 if (refresh && refilter_node (tree, node, iter))
                 {
                     GPtrArray *arr;
@@ -5243,41 +5816,36 @@ set_children (DonnaTreeView *tree,
                     }
                 }
 
-                l = list;
-                while (l)
-                {
-                    if ((DonnaNode *) l->data == node)
-                    {
-                        if (prev)
-                            prev->next = l->next;
-                        else
-                            list = l->next;
-
-                        g_slist_free_1 (l);
-                        break;
-                    }
-                    prev = l;
-                    l = prev->next;
-                }
+                if (old)
+                    g_hash_table_remove (old, node);
             }
             else
-                add_node_to_list (tree, node, TRUE);
+                /* if bulk, children could include duplicates (e.g. from a
+                 * node_children signal) so let add_node_to_list() check */
+                add_node_to_list (tree, node, !bulk);
         }
         /* remove nodes not in children */
-        while (list)
+        if (old)
         {
-            GSList *l;
-
-            l = list;
-            iter = g_hash_table_lookup (priv->hashtable, l->data);
-            remove_node_from_list (tree, l->data, iter);
-            list = l->next;
-            g_slist_free_1 (l);
+            g_hash_table_iter_init (&ht_it, old);
+            while (g_hash_table_iter_next (&ht_it, (gpointer) &node, NULL))
+            {
+                iter = g_hash_table_lookup (priv->hashtable, node);
+                remove_node_from_list (tree, node, iter);
+            }
+            g_hash_table_unref (old);
         }
 
-        /* restore sort */
+        /* restore sort, i.e. sort all rows at once */
         gtk_tree_sortable_set_sort_column_id (sortable, sort_col_id, order);
+        if (bulk)
+            attach_model (tree, search_col);
         priv->filling_list = FALSE;
+        DONNA_DEBUG (TREE_VIEW, priv->name,
+                g_debug ("TreeView '%s': set %u children in %" G_GINT64_FORMAT
+                    " us (bulk=%d)",
+                    priv->name, children->len,
+                    g_get_monotonic_time () - t, bulk));
         /* do it ourself because we prevented it w/ priv->filling_list */
         check_statuses (tree, STATUS_CHANGED_ON_CONTENT);
 
@@ -5714,6 +6282,9 @@ struct refresh_node_props_data
     DonnaTreeView *tree;
     DonnaNode     *node;
     GPtrArray     *props;
+    /* task is done, but there are node-updated waiting to be processed, which
+     * still need to be ignored (see release_refresh_node_props_data()) */
+    gboolean       done;
 };
 
 static void
@@ -5730,21 +6301,69 @@ free_refresh_node_props_data (struct refresh_node_props_data *data)
     g_free (data);
 }
 
-/* Usually, upon a provider's node-updated signal, we check if the node is in
- * the tree, and if the property is one that our columns use; If so, we trigger
- * a refresh of that row (i.e. trigger a row-updated on store)
- * However, there's an exception: a columntype can, on render, give a list of
- * properties to be refreshed. We then store those properties on
- * priv->refresh_node_props as we run a task to refresh them. During that time,
- * those properties (on that node) will *not* trigger a refresh, as they usually
- * would. Instead, it's only when this callback is triggered that, if *all*
- * properties were refreshed, the refresh will be triggered (on the tree) */
+/* the updates of properties refreshed by the task are likely still waiting in
+ * pending_updates, and are only filtered out (is_update_refreshing()) once the
+ * batch is processed. So if there's a batch pending, data must remain in the
+ * list until then (see clear_done_refresh_node_props()) */
 static void
-refresh_node_prop_cb (DonnaTask                      *task,
-                      gboolean                        timeout_called,
-                      struct refresh_node_props_data *data)
+release_refresh_node_props_data (struct refresh_node_props_data *data)
 {
-    if (donna_task_get_state (task) == DONNA_TASK_DONE)
+    DonnaTreeViewPrivate *priv = data->tree->priv;
+    gboolean pending;
+
+    g_mutex_lock (&priv->pending_updates_mutex);
+    pending = priv->sid_pending_updates > 0;
+    if (pending)
+    {
+        g_mutex_lock (&priv->refresh_node_props_mutex);
+        data->done = TRUE;
+        g_mutex_unlock (&priv->refresh_node_props_mutex);
+    }
+    g_mutex_unlock (&priv->pending_updates_mutex);
+
+    if (!pending)
+        free_refresh_node_props_data (data);
+}
+
+/* frees all data from refresh_node_props whose task is done. Must be called
+ * with refresh_node_props_mutex locked */
+static void
+clear_done_refresh_node_props (DonnaTreeViewPrivate *priv)
+{
+    GSList *l;
+    GSList *next;
+
+    for (l = priv->refresh_node_props; l; l = next)
+    {
+        struct refresh_node_props_data *data = l->data;
+
+        next = l->next;
+        if (!data->done)
+            continue;
+        priv->refresh_node_props = g_slist_delete_link (priv->refresh_node_props, l);
+        g_object_unref (data->node);
+        g_ptr_array_unref (data->props);
+        g_free (data);
+    }
+}
+
+/* Usually, upon a provider's node-updated signal, we check if the node is in
+ * the tree, and if the property is one that our columns use; If so, we trigger
+ * a refresh of that row (i.e. trigger a row-updated on store)
+ * However, there's an exception: a columntype can, on render, give a list of
+ * properties to be refreshed. We then store those properties on
+ * priv->refresh_node_props as we run a task to refresh them. During that time,
+ * those properties (on that node) will *not* trigger a refresh, as they usually
+ * would. Instead, it's only when this callback is triggered that, if *all*
+ * properties were refreshed, the refresh will be triggered (on the tree).
+ * Since the node-updated for those might still be in pending_updates, data is
+ * only removed once they've been filtered out (see pending_updates_cb()) */
+static void
+refresh_node_prop_cb (DonnaTask                      *task,
+                      gboolean                        timeout_called,
+                      struct refresh_node_props_data *data)
+{
+    if (donna_task_get_state (task) == DONNA_TASK_DONE)
     {
         /* no return value means all props were refreshed, i.e. full success */
         if (!donna_task_get_return_value (task))
@@ -5789,92 +6408,124 @@ refresh_node_prop_cb (DonnaTask                      *task,
         }
     }
 bail:
-    free_refresh_node_props_data (data);
+    release_refresh_node_props_data (data);
+}
+
+/* next row as shown, i.e. only going into children of expanded rows */
+static gboolean
+next_shown_row (GtkTreeView *treev, GtkTreeModel *model, GtkTreeIter *iter)
+{
+    GtkTreeIter it;
+
+    if (gtk_tree_model_iter_children (model, &it, iter))
+    {
+        GtkTreePath *path;
+        gboolean is_expanded;
+
+        path = gtk_tree_model_get_path (model, iter);
+        is_expanded = gtk_tree_view_row_expanded (treev, path);
+        gtk_tree_path_free (path);
+        if (is_expanded)
+        {
+            *iter = it;
+            return TRUE;
+        }
+    }
+
+    /* sibling, else the parent's */
+    for (;;)
+    {
+        it = *iter;
+        if (gtk_tree_model_iter_next (model, &it))
+        {
+            *iter = it;
+            return TRUE;
+        }
+        if (!gtk_tree_model_iter_parent (model, &it, iter))
+            return FALSE;
+        *iter = it;
+    }
 }
 
+/* animation of spinners: driven by the frame clock, so it only happens when
+ * the tree is actually drawn, and only cells of visible rows are redrawn (the
+ * pulse being used by the renderer when drawing) */
+#define SPINNER_INTERVAL        (42 * G_TIME_SPAN_MILLISECOND)
+
 static gboolean
-spinner_fn (DonnaTreeView *tree)
+spinner_tick (DonnaTreeView *tree, GdkFrameClock *clock, gpointer data)
 {
     DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreeView *treev = (GtkTreeView *) tree;
     GtkTreeModel *model;
-    guint i;
-    gboolean active = FALSE;
-
-    if (!priv->active_spinners_id)
-        return FALSE;
+    GtkTreePath *start;
+    GtkTreePath *end;
+    GtkTreeIter it_end;
+    GtkTreeIter it;
+    gboolean ok;
+    guint pulse;
 
-    if (!priv->active_spinners->len)
+    /* only active spinners for error messages (or none) */
+    if (priv->active_spinners_nb == 0)
     {
-        g_source_remove (priv->active_spinners_id);
         priv->active_spinners_id = 0;
         priv->active_spinners_pulse = 0;
-        return FALSE;
+        return G_SOURCE_REMOVE;
     }
 
-    model = GTK_TREE_MODEL (priv->store);
-    for (i = 0; i < priv->active_spinners->len; ++i)
-    {
-        struct active_spinners *as = priv->active_spinners->pdata[i];
-        GSList *list;
-        guint j;
-        gboolean refresh;
+    pulse = (guint) (gdk_frame_clock_get_frame_time (clock) / SPINNER_INTERVAL);
+    if (pulse == priv->active_spinners_pulse)
+        return G_SOURCE_CONTINUE;
+    priv->active_spinners_pulse = pulse;
 
-        refresh = FALSE;
-        for (j = 0; j < as->as_cols->len; ++j)
-        {
-            struct as_col *as_col;
+    if (!gtk_tree_view_get_visible_range (treev, &start, &end))
+        return G_SOURCE_CONTINUE;
+    model = (GtkTreeModel *) priv->store;
+    ok = gtk_tree_model_get_iter (model, &it, start)
+        && gtk_tree_model_get_iter (model, &it_end, end);
+    gtk_tree_path_free (start);
+    gtk_tree_path_free (end);
+    if (!ok)
+        return G_SOURCE_CONTINUE;
 
-            as_col = &g_array_index (as->as_cols, struct as_col, j);
-            if (as_col->nb > 0)
-            {
-                active = refresh = TRUE;
-                break;
-            }
-        }
-        if (!refresh)
+    do
+    {
+        struct active_spinners *as;
+        GtkTreePath *path = NULL;
+        DonnaNode *node;
+        guint i;
+
+        gtk_tree_model_get (model, &it, TREE_VIEW_COL_NODE, &node, -1);
+        if (!node)
+            continue;
+        as = g_hash_table_lookup (priv->active_spinners, node);
+        g_object_unref (node);
+        if (!as)
             continue;
 
-        if (priv->is_tree)
+        for (i = 0; i < as->as_cols->len; ++i)
         {
-            list = g_hash_table_lookup (priv->hashtable, as->node);
-            for ( ; list; list = list->next)
-            {
-                GtkTreeIter *iter = list->data;
-                GtkTreePath *path;
+            struct as_col *as_col;
+            GdkRectangle rect;
+            gint x, y;
 
-                path = gtk_tree_model_get_path (model, iter);
-                gtk_tree_model_row_changed (model, path, iter);
-                gtk_tree_path_free (path);
-            }
-        }
-        else
-        {
-            GtkTreeIter *iter;
-            GtkTreePath *path;
+            as_col = &g_array_index (as->as_cols, struct as_col, i);
+            if (as_col->nb == 0)
+                continue;
 
-            /* since it's an as we can assume that (a) it is in hashtable, and
-             * (b) it has an iter */
-            iter = g_hash_table_lookup (priv->hashtable, as->node);
-            if (iter)
-            {
-                path = gtk_tree_model_get_path (model, iter);
-                gtk_tree_model_row_changed (model, path, iter);
-                gtk_tree_path_free (path);
-            }
+            if (!path)
+                path = gtk_tree_model_get_path (model, &it);
+            gtk_tree_view_get_cell_area (treev, path, as_col->column, &rect);
+            gtk_tree_view_convert_bin_window_to_widget_coords (treev,
+                    rect.x, rect.y, &x, &y);
+            gtk_widget_queue_draw_area ((GtkWidget *) tree, x, y,
+                    rect.width, rect.height);
         }
-    }
-
-    if (!active)
-    {
-        /* there are active spinners only for error messages */
-        g_source_remove (priv->active_spinners_id);
-        priv->active_spinners_id = 0;
-        priv->active_spinners_pulse = 0;
-        return FALSE;
-    }
+        if (path)
+            gtk_tree_path_free (path);
+    } while (!itereq (&it, &it_end) && next_shown_row (treev, model, &it));
 
-    ++priv->active_spinners_pulse;
-    return TRUE;
+    return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -6141,7 +6792,7 @@ rend_func (GtkTreeViewColumn  *column,
     {
         struct active_spinners *as;
 
-        if (!priv->active_spinners->len)
+        if (g_hash_table_size (priv->active_spinners) == 0)
         {
             if (index == INTERNAL_RENDERER_PIXBUF)
                 rend_on_demand (tree, model, iter, get_column_by_column (tree, column),
@@ -6157,7 +6808,7 @@ rend_func (GtkTreeViewColumn  *column,
         if (!node)
             return;
 
-        as = get_as_for_node (tree, node, NULL, FALSE);
+        as = get_as_for_node (tree, node, FALSE);
         if (as)
         {
             for (i = 0; i < as->as_cols->len; ++i)
@@ -6821,30 +7472,19 @@ free:
     free_node_children_data (data);
 }
 
-struct node_updated_data
-{
-    DonnaTreeView   *tree;
-    DonnaNode       *node;
-    gchar           *name;
-};
-
+/* returns whether the update of property name on node should trigger a refresh
+ * of its row(s). Must be called with refresh_node_props_mutex */
 static gboolean
-real_node_updated_cb (struct node_updated_data *data)
+is_update_refreshing (DonnaTreeViewPrivate *priv,
+                      DonnaNode            *node,
+                      const gchar          *name)
 {
-    DonnaTreeView *tree = data->tree;
-    DonnaTreeViewPrivate *priv = tree->priv;
-    GtkTreeModel *model = (GtkTreeModel *) priv->store;
-    GSList *list, *l;
+    GSList *list;
     guint i;
 
-    /* do we have this node on tree? */
-    if (!g_hash_table_lookup_extended (priv->hashtable, data->node,
-                NULL, (gpointer) &l))
-        goto done;
-
     /* list: we might need to bypass the properties from column: if name, or
      * there's a VF applied FIXME */
-    if (priv->is_tree || !streq (data->name, "name"))
+    if (priv->is_tree || !streq (name, "name"))
     {
         /* should that property cause a refresh? */
         for (i = 0; i < priv->col_props->len; ++i)
@@ -6852,69 +7492,144 @@ real_node_updated_cb (struct node_updated_data *data)
             struct col_prop *cp;
 
             cp = &g_array_index (priv->col_props, struct col_prop, i);
-            if (streq (data->name, cp->prop))
+            if (streq (name, cp->prop))
                 break;
         }
         if (i >= priv->col_props->len)
-            goto done;
+            return FALSE;
     }
 
     /* should we ignore this prop/node combo ? See refresh_node_prop_cb */
-    g_mutex_lock (&priv->refresh_node_props_mutex);
     for (list = priv->refresh_node_props; list; list = list->next)
     {
         struct refresh_node_props_data *d = list->data;
 
-        if (d->node == data->node)
+        if (d->node == node)
         {
             for (i = 0; i < d->props->len; ++i)
             {
-                if (streq (data->name, d->props->pdata[i]))
-                    break;
+                if (streq (name, d->props->pdata[i]))
+                    return FALSE;
             }
-            if (i < d->props->len)
-                break;
         }
     }
-    g_mutex_unlock (&priv->refresh_node_props_mutex);
-    if (list)
-        goto done;
 
-    /* trigger refresh */
-    if (priv->is_tree)
+    return TRUE;
+}
+
+static gboolean
+pending_updates_cb (DonnaTreeView *tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    GHashTable *updates;
+    GHashTableIter it;
+    DonnaNode *node;
+    GPtrArray *names;
+    GPtrArray *nodes;
+    gboolean check_content = FALSE;
+    guint n;
+
+    /* we take refresh_node_props_mutex before releasing pending_updates_mutex,
+     * so a refresh task ending now (release_refresh_node_props_data()) can't
+     * remove its data until this batch has been filtered */
+    g_mutex_lock (&priv->pending_updates_mutex);
+    updates = priv->pending_updates;
+    priv->pending_updates = NULL;
+    priv->sid_pending_updates = 0;
+    g_mutex_lock (&priv->refresh_node_props_mutex);
+    g_mutex_unlock (&priv->pending_updates_mutex);
+
+    if (G_UNLIKELY (!updates))
+    {
+        g_mutex_unlock (&priv->refresh_node_props_mutex);
+        return G_SOURCE_REMOVE;
+    }
+
+    /* first get the nodes that need a refresh */
+    nodes = g_ptr_array_sized_new (g_hash_table_size (updates));
+    g_hash_table_iter_init (&it, updates);
+    while (g_hash_table_iter_next (&it, (gpointer) &node, (gpointer) &names))
     {
-        /* on all rows for that node */
-        for ( ; l; l = l->next)
+        gboolean refresh = FALSE;
+        guint i;
+
+        for (i = 0; i < names->len; ++i)
         {
-            GtkTreeIter *iter = l->data;
-            GtkTreePath *path;
+            const gchar *name = names->pdata[i];
 
-            path = gtk_tree_model_get_path (model, iter);
-            gtk_tree_model_row_changed (model, path, iter);
-            gtk_tree_path_free (path);
+            if (streq (name, "name"))
+                check_content = TRUE;
+            else if (streq (name, "size"))
+            {
+                check_content = TRUE;
+                agg_update_size (priv, node);
+            }
+            else if (streq (name, "location") && priv->is_tree
+                    && g_hash_table_contains (priv->hashtable, node))
+            {
+                /* re-key it in the index, so it doesn't point to a location
+                 * the node isn't at anymore */
+                unindex_node (priv, node);
+                g_hash_table_insert (priv->locations,
+                        donna_node_get_full_location (node), node);
+            }
+            if (!refresh)
+                refresh = is_update_refreshing (priv, node, name);
         }
+        if (refresh)
+            g_ptr_array_add (nodes, node);
     }
-    else
+    /* refreshes that were done have now been filtered out */
+    clear_done_refresh_node_props (priv);
+    g_mutex_unlock (&priv->refresh_node_props_mutex);
+
+    for (n = 0; n < nodes->len; ++n)
     {
-        GtkTreeIter *iter = (GtkTreeIter *) l;
+        GSList *l;
 
-        if (refilter_node (tree, data->node, iter))
+        node = nodes->pdata[n];
+        /* do we have this node on tree? */
+        if (!g_hash_table_lookup_extended (priv->hashtable, node,
+                    NULL, (gpointer) &l))
+            continue;
+
+        /* trigger refresh, once per row */
+        if (priv->is_tree)
         {
-            GtkTreePath *path;
+            /* on all rows for that node */
+            for ( ; l; l = l->next)
+            {
+                GtkTreeIter *iter = l->data;
+                GtkTreePath *path;
 
-            path = gtk_tree_model_get_path (model, iter);
-            gtk_tree_model_row_changed (model, path, iter);
-            gtk_tree_path_free (path);
+                path = gtk_tree_model_get_path (model, iter);
+                gtk_tree_model_row_changed (model, path, iter);
+                gtk_tree_path_free (path);
+            }
+        }
+        else
+        {
+            GtkTreeIter *iter = (GtkTreeIter *) l;
+
+            if (refilter_node (tree, node, iter))
+            {
+                GtkTreePath *path;
+
+                path = gtk_tree_model_get_path (model, iter);
+                gtk_tree_model_row_changed (model, path, iter);
+                gtk_tree_path_free (path);
+            }
         }
     }
+    /* nodes are owned by updates */
+    g_ptr_array_unref (nodes);
+    g_hash_table_unref (updates);
 
-done:
-    if (streq (data->name, "name") || streq (data->name, "size"))
+    if (check_content)
         check_statuses (tree, STATUS_CHANGED_ON_CONTENT);
-    g_object_unref (data->node);
-    g_free (data->name);
-    g_free (data);
-    return FALSE;
+
+    return G_SOURCE_REMOVE;
 }
 
 static void
@@ -6923,18 +7638,57 @@ node_updated_cb (DonnaProvider  *provider,
                  const gchar    *name,
                  DonnaTreeView  *tree)
 {
-    struct node_updated_data *data;
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GPtrArray *names;
+    const gchar *iname;
+    guint i;
 
-    if (tree->priv->refresh_on_hold)
+    if (priv->refresh_on_hold)
+    {
+        /* rows will all be redrawn when done, but aggregates need to know
+         * which sizes changed (see refresh_node_cb()) */
+        if (!priv->is_tree && priv->agg_size_statuses > 0
+                && streq (name, "size"))
+        {
+            g_mutex_lock (&priv->pending_updates_mutex);
+            if (!priv->held_sizes)
+                priv->held_sizes = g_hash_table_new_full (g_direct_hash,
+                        g_direct_equal, g_object_unref, NULL);
+            if (!g_hash_table_contains (priv->held_sizes, node))
+                g_hash_table_add (priv->held_sizes, g_object_ref (node));
+            g_mutex_unlock (&priv->pending_updates_mutex);
+        }
         return;
+    }
 
-    /* we might not be in the main thread, but we need to be */
+    /* we might not be in the main thread, but we need to be. Updates are
+     * queued, so each node is only processed once (e.g. a refresh will update
+     * a few properties on each node) right before the next redraw */
 
-    data = g_new (struct node_updated_data, 1);
-    data->tree = tree;
-    data->node = g_object_ref (node);
-    data->name = g_strdup (name);
-    g_main_context_invoke (NULL, (GSourceFunc) real_node_updated_cb, data);
+    iname = g_intern_string (name);
+    g_mutex_lock (&priv->pending_updates_mutex);
+    if (!priv->pending_updates)
+        priv->pending_updates = g_hash_table_new_full (g_direct_hash,
+                g_direct_equal, g_object_unref,
+                (GDestroyNotify) g_ptr_array_unref);
+
+    names = g_hash_table_lookup (priv->pending_updates, node);
+    if (!names)
+    {
+        names = g_ptr_array_sized_new (8);
+        g_hash_table_insert (priv->pending_updates, g_object_ref (node), names);
+    }
+    /* interned, so we can compare pointers */
+    for (i = 0; i < names->len; ++i)
+        if (names->pdata[i] == iname)
+            break;
+    if (i >= names->len)
+        g_ptr_array_add (names, (gpointer) iname);
+
+    if (priv->sid_pending_updates == 0)
+        priv->sid_pending_updates = g_idle_add_full (GDK_PRIORITY_REDRAW - 1,
+                (GSourceFunc) pending_updates_cb, tree, NULL);
+    g_mutex_unlock (&priv->pending_updates_mutex);
 }
 
 struct node_deleted_data
@@ -7233,14 +7987,14 @@ add_pending_nodes (DonnaTreeView *tree)
             GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID, order);
     priv->filling_list = TRUE;
 
-    i = 0;
-    while (priv->nodes_to_add->len > 0)
+    for (i = 0; i < priv->nodes_to_add->len; )
     {
-        add_node_to_list (tree, priv->nodes_to_add->pdata[0], FALSE);
-        g_ptr_array_remove_index (priv->nodes_to_add, 0);
+        add_node_to_list (tree, priv->nodes_to_add->pdata[i], FALSE);
         if (++i == max)
             break;
     }
+    /* remove them all at once, instead of shifting the array for each one */
+    g_ptr_array_remove_range (priv->nodes_to_add, 0, i);
     if (priv->nodes_to_add->len == 0)
     {
         g_ptr_array_unref (priv->nodes_to_add);
@@ -7728,6 +8482,7 @@ add_node_to_list (DonnaTreeView *tree, DonnaNode *node, gboolean checked)
     }
 
     g_hash_table_insert (priv->hashtable, g_object_ref (node), NULL);
+    agg_add_node (priv, node, FALSE);
     refilter_node (tree, node, NULL);
 }
 
@@ -7840,8 +8595,12 @@ add_node_to_tree (DonnaTreeView *tree,
     it   = gtk_tree_iter_copy (&iter);
     list = g_hash_table_lookup (priv->hashtable, node);
     if (!list)
+    {
         /* we're adding a new node, take a ref on it */
         g_object_ref (node);
+        g_hash_table_insert (priv->locations,
+                donna_node_get_full_location (node), node);
+    }
     list = g_slist_prepend (list, it);
     g_hash_table_insert (priv->hashtable, node, list);
     /* new root? */
@@ -8346,6 +9105,33 @@ free_arrangement (DonnaArrangement *arr)
     g_free (arr);
 }
 
+void
+_donna_tree_view_free_arrangement (DonnaArrangement *arr)
+{
+    free_arrangement (arr);
+}
+
+DonnaArrangement *
+_donna_tree_view_dup_arrangement (DonnaArrangement *arr)
+{
+    DonnaArrangement *dup;
+
+    dup = g_new (DonnaArrangement, 1);
+    *dup = *arr;
+    dup->columns            = g_strdup (arr->columns);
+    dup->main_column        = g_strdup (arr->main_column);
+    dup->columns_source     = g_strdup (arr->columns_source);
+    dup->sort_column        = g_strdup (arr->sort_column);
+    dup->sort_source        = g_strdup (arr->sort_source);
+    dup->second_sort_column = g_strdup (arr->second_sort_column);
+    dup->second_sort_source = g_strdup (arr->second_sort_source);
+    dup->columns_options    = g_strdup (arr->columns_options);
+    dup->color_filters      = g_slist_copy_deep (arr->color_filters,
+            (GCopyFunc) g_object_ref, NULL);
+
+    return dup;
+}
+
 static gint
 no_sort (GtkTreeModel *model, GtkTreeIter *i1, GtkTreeIter *i2, gpointer data)
 {
@@ -9017,44 +9803,113 @@ select_arrangement_accumulator (GSignalInvocationHint  *hint,
     return keep_emission;
 }
 
-static inline DonnaArrangement *
-select_arrangement (DonnaTreeView *tree, DonnaNode *location)
+/* returns the arrangement from our own config only (tree_views/<NAME> and
+ * defaults/<MODE>s), i.e. what's used to complete the one from
+ * select-arrangement. It is cached until config changes, so we don't have to
+ * read it all again on every location change */
+static DonnaArrangement *
+get_arrangement_defaults (DonnaTreeView *tree)
 {
     DonnaTreeViewPrivate *priv = tree->priv;
     DonnaConfig *config;
-    DonnaArrangement *arr = NULL;
-    gchar *s;
-
-    /* list only: emit select-arrangement */
-    if (!priv->is_tree)
-        g_signal_emit (tree, donna_tree_view_signals[SIGNAL_SELECT_ARRANGEMENT], 0,
-                priv->name, location, &arr);
-
-    if (!arr)
-        arr = g_new0 (DonnaArrangement, 1);
+    DonnaArrangement *arr;
+    guint version;
 
     config = donna_app_peek_config (priv->app);
-
-    if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS))
-        /* try loading our from our own arrangement */
+    /* must be done before reading config; see donna_config_get_version() */
+    version = donna_config_get_version (config);
+    if (priv->arr_defaults && priv->arr_defaults_version == version)
+        return priv->arr_defaults;
+
+    free_arrangement (priv->arr_defaults);
+    arr = priv->arr_defaults = g_new0 (DonnaArrangement, 1);
+    priv->arr_defaults_version = version;
+
+    /* try loading our from our own arrangement */
+    if (!donna_config_arr_load_columns (config, arr,
+                "tree_views/%s/arrangement", priv->name))
+        /* fallback on default for our mode */
         if (!donna_config_arr_load_columns (config, arr,
-                    "tree_views/%s/arrangement", priv->name))
-            /* fallback on default for our mode */
-            if (!donna_config_arr_load_columns (config, arr,
-                        "defaults/%s/arrangement",
-                        (priv->is_tree) ? "trees" : "lists"))
-            {
-                /* if all else fails, use a column "name" */
-                arr->columns = g_strdup ("name");
-                arr->flags |= DONNA_ARRANGEMENT_HAS_COLUMNS;
-            }
-
-    if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SORT))
-        if (!donna_config_arr_load_sort (config, arr,
-                    "tree_views/%s/arrangement", priv->name)
-                && !donna_config_arr_load_sort (config, arr,
                     "defaults/%s/arrangement",
                     (priv->is_tree) ? "trees" : "lists"))
+        {
+            /* if all else fails, use a column "name" */
+            arr->columns = g_strdup ("name");
+            arr->flags |= DONNA_ARRANGEMENT_HAS_COLUMNS;
+        }
+
+    /* if not found, select_arrangement() will default to the first column */
+    if (!donna_config_arr_load_sort (config, arr,
+                "tree_views/%s/arrangement", priv->name))
+        donna_config_arr_load_sort (config, arr,
+                "defaults/%s/arrangement",
+                (priv->is_tree) ? "trees" : "lists");
+
+    /* Note: even here, this one is optional */
+    if (!donna_config_arr_load_second_sort (config, arr,
+                "tree_views/%s/arrangement",
+                priv->name))
+        donna_config_arr_load_second_sort (config, arr,
+                "defaults/%s/arrangement",
+                (priv->is_tree) ? "trees" : "lists");
+
+    if (!donna_config_arr_load_columns_options (config, arr,
+                "tree_views/%s/arrangement",
+                priv->name)
+            && !donna_config_arr_load_columns_options (config, arr,
+                "defaults/%s/arrangement",
+                (priv->is_tree) ? "trees" : "lists"))
+        /* else: we say we have something, it is NULL. This will force
+         * updating the columntype-data without using an arr_name */
+        arr->flags |= DONNA_ARRANGEMENT_HAS_COLUMNS_OPTIONS;
+
+    if (!donna_config_arr_load_color_filters (config, priv->app, arr,
+                "tree_views/%s/arrangement", priv->name))
+        donna_config_arr_load_color_filters (config, priv->app, arr,
+                "defaults/%s/arrangement",
+                (priv->is_tree) ? "trees" : "lists");
+
+    return arr;
+}
+
+static inline DonnaArrangement *
+select_arrangement (DonnaTreeView *tree, DonnaNode *location)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    DonnaArrangement *arr = NULL;
+    DonnaArrangement *def;
+    gchar *s;
+
+    /* list only: emit select-arrangement */
+    if (!priv->is_tree)
+        g_signal_emit (tree, donna_tree_view_signals[SIGNAL_SELECT_ARRANGEMENT], 0,
+                priv->name, location, &arr);
+
+    if (!arr)
+        arr = g_new0 (DonnaArrangement, 1);
+
+    def = get_arrangement_defaults (tree);
+
+    if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS))
+    {
+        arr->flags |= def->flags & (DONNA_ARRANGEMENT_HAS_COLUMNS
+                | DONNA_ARRANGEMENT_COLUMNS_ALWAYS);
+        arr->columns        = g_strdup (def->columns);
+        arr->main_column    = g_strdup (def->main_column);
+        arr->columns_source = g_strdup (def->columns_source);
+    }
+
+    if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SORT))
+    {
+        if (def->flags & DONNA_ARRANGEMENT_HAS_SORT)
+        {
+            arr->flags |= def->flags & (DONNA_ARRANGEMENT_HAS_SORT
+                    | DONNA_ARRANGEMENT_SORT_ALWAYS);
+            arr->sort_column = g_strdup (def->sort_column);
+            arr->sort_order  = def->sort_order;
+            arr->sort_source = g_strdup (def->sort_source);
+        }
+        else
         {
             /* we can't find anything, default to first column */
             s = strchr (arr->columns, ',');
@@ -9065,36 +9920,35 @@ select_arrangement (DonnaTreeView *tree, DonnaNode *location)
                 arr->sort_column = g_strdup (arr->columns);
             arr->flags |= DONNA_ARRANGEMENT_HAS_SORT;
         }
+    }
 
-    /* Note: even here, this one is optional */
-    if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SECOND_SORT))
-        if (!donna_config_arr_load_second_sort (config, arr,
-                    "tree_views/%s/arrangement",
-                    priv->name))
-            donna_config_arr_load_second_sort (config, arr,
-                    "defaults/%s/arrangement",
-                    (priv->is_tree) ? "trees" : "lists");
+    if (!(arr->flags & DONNA_ARRANGEMENT_HAS_SECOND_SORT)
+            && (def->flags & DONNA_ARRANGEMENT_HAS_SECOND_SORT))
+    {
+        arr->flags |= def->flags & (DONNA_ARRANGEMENT_HAS_SECOND_SORT
+                | DONNA_ARRANGEMENT_SECOND_SORT_ALWAYS);
+        arr->second_sort_column = g_strdup (def->second_sort_column);
+        arr->second_sort_order  = def->second_sort_order;
+        arr->second_sort_sticky = def->second_sort_sticky;
+        arr->second_sort_source = g_strdup (def->second_sort_source);
+    }
 
     if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLUMNS_OPTIONS))
     {
-        if (!donna_config_arr_load_columns_options (config, arr,
-                    "tree_views/%s/arrangement",
-                    priv->name)
-                && !donna_config_arr_load_columns_options (config, arr,
-                    "defaults/%s/arrangement",
-                    (priv->is_tree) ? "trees" : "lists"))
-            /* else: we say we have something, it is NULL. This will force
-             * updating the columntype-data without using an arr_name */
-            arr->flags |= DONNA_ARRANGEMENT_HAS_COLUMNS_OPTIONS;
+        arr->flags |= def->flags & (DONNA_ARRANGEMENT_HAS_COLUMNS_OPTIONS
+                | DONNA_ARRANGEMENT_COLUMNS_OPTIONS_ALWAYS);
+        arr->columns_options = g_strdup (def->columns_options);
     }
 
     if (!(arr->flags & DONNA_ARRANGEMENT_HAS_COLOR_FILTERS))
     {
-        if (!donna_config_arr_load_color_filters (config, priv->app, arr,
-                    "tree_views/%s/arrangement", priv->name))
-            donna_config_arr_load_color_filters (config, priv->app, arr,
-                    "defaults/%s/arrangement",
-                    (priv->is_tree) ? "trees" : "lists");
+        /* ours are added after the ones already there (loaded with type
+         * COMBINE) */
+        arr->flags |= def->flags & DONNA_ARRANGEMENT_HAS_COLOR_FILTERS;
+        if (def->color_filters)
+            arr->color_filters = g_slist_concat (arr->color_filters,
+                    g_slist_copy_deep (def->color_filters,
+                        (GCopyFunc) g_object_ref, NULL));
 
         /* special: color filters might have been loaded with a type COMBINE,
          * which resulted in them loaded but no flag set (in order to keep
@@ -9229,38 +10083,21 @@ free_set_node_prop_data (struct set_node_prop_data *data)
 static struct active_spinners *
 get_as_for_node (DonnaTreeView  *tree,
                  DonnaNode      *node,
-                 guint          *index,
                  gboolean        create)
 {
     DonnaTreeViewPrivate *priv = tree->priv;
     struct active_spinners *as;
-    guint i;
 
-    /* is there already an as for this node? */
-    for (i = 0; i < priv->active_spinners->len; ++i)
+    as = g_hash_table_lookup (priv->active_spinners, node);
+    if (!as && create)
     {
-        as = priv->active_spinners->pdata[i];
-        if (as->node == node)
-            break;
-    }
-
-    if (i >= priv->active_spinners->len)
-    {
-        if (create)
-        {
-            as = g_new0 (struct active_spinners, 1);
-            as->node = g_object_ref (node);
-            as->as_cols = g_array_new (FALSE, FALSE, sizeof (struct as_col));
+        as = g_new0 (struct active_spinners, 1);
+        as->node = g_object_ref (node);
+        as->as_cols = g_array_new (FALSE, FALSE, sizeof (struct as_col));
 
-            g_ptr_array_add (priv->active_spinners, as);
-        }
-        else
-            as = NULL;
+        g_hash_table_insert (priv->active_spinners, node, as);
     }
 
-    if (index)
-        *index = i;
-
     return as;
 }
 
@@ -9313,10 +10150,9 @@ set_node_prop_callbak (DonnaTask                 *task,
     if (timeout_called || task_failed)
     {
         struct active_spinners *as;
-        guint as_idx; /* in case we need to remove this as */
         gboolean refresh = FALSE;
 
-        as = get_as_for_node (data->tree, data->node, &as_idx, task_failed);
+        as = get_as_for_node (data->tree, data->node, task_failed);
         if (!as)
             goto free;
 
@@ -9359,7 +10195,10 @@ set_node_prop_callbak (DonnaTask                 *task,
                 g_ptr_array_remove_fast (as_col->tasks, task);
 
             if (timeout_called)
+            {
                 --as_col->nb;
+                --priv->active_spinners_nb;
+            }
 
             if (as_col->nb == 0)
             {
@@ -9381,8 +10220,7 @@ set_node_prop_callbak (DonnaTask                 *task,
                 {
                     /* can we remove the whole as? */
                     if (as->as_cols->len == 1)
-                        g_ptr_array_remove_index_fast (priv->active_spinners,
-                                as_idx);
+                        g_hash_table_remove (priv->active_spinners, data->node);
                     else
                         g_array_remove_index_fast (as->as_cols, j);
                 }
@@ -9429,12 +10267,12 @@ set_node_prop_callbak (DonnaTask                 *task,
             }
         }
 
-        /* no more as == we can stop spinner_fn. If there's still one (or more)
-         * but only for error messages, on its next call spinner_fn will see it
-         * and stop itself */
-        if (!priv->active_spinners->len && priv->active_spinners_id)
+        /* no more running spinners == we can stop the animation. (There
+         * might still be as for error messages.) */
+        if (priv->active_spinners_nb == 0 && priv->active_spinners_id)
         {
-            g_source_remove (priv->active_spinners_id);
+            gtk_widget_remove_tick_callback ((GtkWidget *) data->tree,
+                    priv->active_spinners_id);
             priv->active_spinners_id = 0;
             priv->active_spinners_pulse = 0;
         }
@@ -9474,7 +10312,7 @@ set_node_prop_timeout (DonnaTask *task, struct set_node_prop_data *data)
         return;
     }
 
-    as = get_as_for_node (data->tree, data->node, NULL, TRUE);
+    as = get_as_for_node (data->tree, data->node, TRUE);
     /* for every column using that property */
     for (i = 0; i < arr->len; ++i)
     {
@@ -9512,6 +10350,7 @@ set_node_prop_timeout (DonnaTask *task, struct set_node_prop_data *data)
         }
         else
             ++as_col->nb;
+        ++priv->active_spinners_nb;
 
         g_ptr_array_add (as_col->tasks, g_object_ref (task));
     }
@@ -9547,8 +10386,9 @@ set_node_prop_timeout (DonnaTask *task, struct set_node_prop_data *data)
 #endif
 
     if (!priv->active_spinners_id)
-        priv->active_spinners_id = g_timeout_add (42,
-                (GSourceFunc) spinner_fn, data->tree);
+        priv->active_spinners_id = gtk_widget_add_tick_callback (
+                (GtkWidget *) data->tree, (GtkTickCallback) spinner_tick,
+                NULL, NULL);
 
     g_ptr_array_free (arr, TRUE);
 }
@@ -9826,6 +10666,97 @@ get_best_existing_iter_for_node (DonnaTreeView  *tree,
     return (iter_vis) ? iter_vis : iter_non_vis;
 }
 
+/* mode tree only -- returns the node on tree for the full location fl, cut at
+ * end (i.e. one of its ancestors when end is the position of a '/'), if any. No
+ * reference is added */
+static DonnaNode *
+get_node_for_location (DonnaTreeViewPrivate *priv, gchar *fl, gchar *end)
+{
+    DonnaNode *node;
+    gchar c = *end;
+
+    *end = '\0';
+    node = g_hash_table_lookup (priv->locations, fl);
+    if (node)
+    {
+        gchar *cur = donna_node_get_full_location (node);
+
+        /* the node might have been renamed while updates were on hold, in
+         * which case the index is stale and it isn't the node we want */
+        if (!streq (cur, fl))
+            node = NULL;
+        g_free (cur);
+    }
+    *end = c;
+    return node;
+}
+
+static gint
+cmp_root_iters (GtkTreeIter *iter1, GtkTreeIter *iter2, GtkTreeModel *model)
+{
+    GtkTreePath *path;
+    gint i1, i2;
+
+    path = gtk_tree_model_get_path (model, iter1);
+    i1 = gtk_tree_path_get_indices (path)[0];
+    gtk_tree_path_free (path);
+    path = gtk_tree_model_get_path (model, iter2);
+    i2 = gtk_tree_path_get_indices (path)[0];
+    gtk_tree_path_free (path);
+    return i1 - i2;
+}
+
+/* mode tree only -- node must be in a non-flat domain */
+/* returns the iters of roots that are node or one of its ancestors, in the
+ * order they are on tree. Since node's domain isn't flat, ancestors can only be
+ * at the location of each '/' in node's location, so we only look those up
+ * instead of going through all roots (and their locations) */
+static GSList *
+get_root_iters_for_node (DonnaTreeView  *tree,
+                         DonnaNode      *node,
+                         DonnaProvider  *provider,
+                         const gchar    *location)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GSList *roots = NULL;
+    GSList *l;
+    DonnaNode *n;
+    gchar *fl;
+    gchar *loc;
+    gchar *end;
+
+    fl = g_strconcat (donna_provider_get_domain (provider), ":", location, NULL);
+    loc = fl + strlen (fl) - strlen (location);
+
+    /* "/" is the root, i.e. ancestor of everything */
+    end = (*loc == '/') ? loc + 1 : strchr (loc, '/');
+    for (;;)
+    {
+        if (end && *end != '\0')
+            n = get_node_for_location (priv, fl, end);
+        else
+        {
+            n = g_hash_table_lookup (priv->locations, fl);
+            if (n != node)
+                n = NULL;
+            end = NULL;
+        }
+
+        if (n)
+            for (l = g_hash_table_lookup (priv->hashtable, n); l; l = l->next)
+                if (gtk_tree_store_iter_depth (priv->store, l->data) == 0)
+                    roots = g_slist_insert_sorted_with_data (roots, l->data,
+                            (GCompareDataFunc) cmp_root_iters, priv->store);
+
+        if (!end)
+            break;
+        end = strchr (end + 1, '/');
+    }
+
+    g_free (fl);
+    return roots;
+}
+
 /* mode tree only -- node must be in a non-flat domain */
 static gboolean
 is_node_ancestor (DonnaNode         *node,
@@ -9873,15 +10804,18 @@ get_iter_expanding_if_needed (DonnaTreeView *tree,
     GtkTreeIter *iter;
     DonnaProvider *provider;
     DonnaNode *n;
+    gchar *fl;
     gchar *location;
     size_t len;
     gchar *s;
-    gchar *ss;
 
     model = (GtkTreeModel *) priv->store;
     iter = iter_root;
     provider = donna_node_peek_provider (node);
-    location = donna_node_get_location (node);
+    /* full location, so we can look up nodes on tree by (parent) location. See
+     * get_node_for_location() */
+    fl = donna_node_get_full_location (node);
+    location = fl + strlen (donna_provider_get_domain (provider)) + 1;
     if (was_match)
         *was_match = FALSE;
 
@@ -9889,6 +10823,9 @@ get_iter_expanding_if_needed (DonnaTreeView *tree,
     gtk_tree_model_get (model, iter,
             TREE_COL_NODE,  &n,
             -1);
+    s = donna_node_get_location (n);
+    len = strlen (s);
+    g_free (s);
     for (;;)
     {
         GtkTreeIter *prev_iter;
@@ -9898,28 +10835,17 @@ get_iter_expanding_if_needed (DonnaTreeView *tree,
         if (n == node)
         {
             /* this _is_ the iter we're looking for */
-            g_free (location);
+            g_free (fl);
             g_object_unref (n);
             if (was_match)
                 *was_match = TRUE;
             return iter;
         }
-
-        /* get the node's location, and obtain the location of the next child */
-        ss = donna_node_get_location (n);
-        len = strlen (ss);
-        g_free (ss);
         g_object_unref (n);
-        s = strchr (location + len + 1, '/');
-        if (s)
-            s = g_strndup (location, (gsize) (s - location));
-        else
-            s = (gchar *) location;
 
-        /* get the corresponding node */
-        n = donna_provider_get_node (provider, (const gchar *) s, NULL);
-        if (s != location)
-            g_free (s);
+        /* get the location of the next child */
+        s = strchr (location + len + 1, '/');
+        len = (s) ? (size_t) (s - location) : strlen (location);
 
         if (only_accessible)
         {
@@ -9930,8 +10856,28 @@ get_iter_expanding_if_needed (DonnaTreeView *tree,
         else
             last_iter = iter;
 
-        /* now get the child iter for that node */
+        /* get the corresponding node, from the index if it's on tree */
         prev_iter = iter;
+        n = get_node_for_location (priv, fl, location + len);
+        if (n)
+            g_object_ref (n);
+        else
+        {
+            gchar c = location[len];
+
+            /* not indexed doesn't mean not on tree, e.g. if it was renamed
+             * while updates were on hold, so we still need to look for it */
+            location[len] = '\0';
+            n = donna_provider_get_node (provider, location, NULL);
+            location[len] = c;
+            if (!n)
+            {
+                g_free (fl);
+                return (only_accessible) ? last_iter : NULL;
+            }
+        }
+
+        /* now get the child iter for that node */
         iter = get_child_iter_for_node (tree, prev_iter, n);
         if (!iter)
         {
@@ -9946,14 +10892,14 @@ get_iter_expanding_if_needed (DonnaTreeView *tree,
                     if (!add_node_to_tree (tree, prev_iter, n, &it))
                     {
                         g_object_unref (n);
-                        g_free (location);
+                        g_free (fl);
                         return NULL;
                     }
                 }
                 else if (!add_node_to_tree_filtered (tree, prev_iter, n, &it))
                 {
                     g_object_unref (n);
-                    g_free (location);
+                    g_free (fl);
                     return NULL;
                 }
 
@@ -9970,14 +10916,14 @@ get_iter_expanding_if_needed (DonnaTreeView *tree,
             else
             {
                 g_object_unref (n);
-                g_free (location);
+                g_free (fl);
                 return last_iter;
             }
         }
         else if (only_accessible && !is_row_accessible (tree, iter))
         {
             g_object_unref (n);
-            g_free (location);
+            g_free (fl);
             return last_iter;
         }
 
@@ -10072,6 +11018,8 @@ get_closest_iter_for_node (DonnaTreeView *tree,
 #define LM_VISIBLE  (1 << 1)
     gboolean last_is_in_cur_root = FALSE;
     gint last_level = -1;
+    GSList *roots;
+    GSList *l;
 
     model  = (GtkTreeModel *) priv->store;
 
@@ -10099,170 +11047,156 @@ get_closest_iter_for_node (DonnaTreeView *tree,
     gtk_tree_view_convert_tree_to_bin_window_coords (treev,
             0, rect_visible.y, &rect_visible.x, &rect_visible.y);
 
-    /* try all existing tree roots (if any) */
-    if (gtk_tree_model_iter_children (model, &iter, NULL))
-        do
+    /* try all roots that are node or one of its ancestors (if any) */
+    roots = get_root_iters_for_node (tree, node, provider, location);
+    for (l = roots; l; l = l->next)
+    {
+        GtkTreeIter *i = l->data;
+        gboolean match;
+
+        /* we might have to skip current root (probably already processed
+         * before calling this */
+        iter = *i;
+        if (skip_current_root && itereq (&iter, cur_root))
+            continue;
+
+        gtk_tree_model_get (model, &iter, TREE_COL_NODE, &n, -1);
+        /* hashtable has a ref on it */
+        g_object_unref (n);
+
+        /* find the closest "accessible" iter for node under i */
+        i = get_iter_expanding_if_needed (tree, i, node, TRUE, FALSE, &match);
+        if (i)
         {
-            /* we might have to skip current root (probably already processed
-             * before calling this */
-            if (skip_current_root && itereq (&iter, cur_root))
-                continue;
+            GtkTreePath *path;
 
-            gtk_tree_model_get (model, &iter, TREE_COL_NODE, &n, -1);
-            if (n == node || is_node_ancestor (n, node, provider, location))
+            /* determine if it is visible or not */
+            path = gtk_tree_model_get_path (model, i);
+            gtk_tree_view_get_background_area (treev, path, NULL, &rect);
+            gtk_tree_path_free (path);
+            if (rect.y >= rect_visible.y
+                    && rect.y + rect.height <= rect_visible.y +
+                    rect_visible.height)
             {
-                GSList *list;
-                GtkTreeIter *i = NULL;
-                gboolean match;
-
-                /* get the iter from the hashtable (we cannot end up return the
-                 * pointer to a local iter) */
-                if (priv->is_tree)
+                if (match)
                 {
-                    list = g_hash_table_lookup (priv->hashtable, n);
-                    for ( ; list; list = list->next)
-                        if (itereq (&iter, (GtkTreeIter *) list->data))
-                        {
-                            i = list->data;
-                            break;
-                        }
+                    /* visible match, this is it */
+                    if (is_match)
+                        *is_match = match;
+                    g_slist_free (roots);
+                    return get_iter_expanding_if_needed (tree, i, node,
+                            FALSE, FALSE, NULL);
                 }
-                else
-                    i = g_hash_table_lookup (priv->hashtable, n);
-
-                /* find the closest "accessible" iter for node under i */
-                i = get_iter_expanding_if_needed (tree, i, node, TRUE, FALSE, &match);
-                if (i)
+                else if (last_match == LM_VISIBLE)
                 {
-                    GtkTreePath *path;
+                    /* we already have a visible non-match... */
 
-                    /* determine if it is visible or not */
-                    path = gtk_tree_model_get_path (model, i);
-                    gtk_tree_view_get_background_area (treev, path, NULL, &rect);
-                    gtk_tree_path_free (path);
-                    if (rect.y >= rect_visible.y
-                            && rect.y + rect.height <= rect_visible.y +
-                            rect_visible.height)
+                    if (cur_root && itereq (&iter, cur_root))
                     {
-                        if (match)
-                        {
-                            /* visible match, this is it */
-                            if (is_match)
-                                *is_match = match;
-                            return get_iter_expanding_if_needed (tree, i, node,
-                                    FALSE, FALSE, NULL);
-                        }
-                        else if (last_match == LM_VISIBLE)
-                        {
-                            /* we already have a visible non-match... */
-
-                            if (cur_root && itereq (&iter, cur_root))
-                            {
-                                /* ...but this one is in the current root, so
-                                 * takes precedence */
-                                last_level = -1;
-                                last_match = LM_VISIBLE;
-                                last_iter = i;
-                                last_is_in_cur_root = TRUE;
-                            }
-                            else if (!last_is_in_cur_root)
-                            {
-                                gint level;
+                        /* ...but this one is in the current root, so
+                         * takes precedence */
+                        last_level = -1;
+                        last_match = LM_VISIBLE;
+                        last_iter = i;
+                        last_is_in_cur_root = TRUE;
+                    }
+                    else if (!last_is_in_cur_root)
+                    {
+                        gint level;
 
-                                /* ...neither are in current root, check the
-                                 * "level" to use the closest one */
+                        /* ...neither are in current root, check the
+                         * "level" to use the closest one */
 
-                                if (last_level < 0)
-                                    last_level = _get_level (model, last_iter, NULL);
-                                level = _get_level (NULL, NULL, n);
+                        if (last_level < 0)
+                            last_level = _get_level (model, last_iter, NULL);
+                        level = _get_level (NULL, NULL, n);
 
-                                if (level > last_level)
-                                {
-                                    last_level = level;
-                                    last_match = LM_VISIBLE;
-                                    last_iter = i;
-                                    last_is_in_cur_root = FALSE;
-                                }
-                            }
-                        }
-                        else if (last_match == 0)
+                        if (level > last_level)
                         {
-                            /* first result, or we alreayd had a non-match, but
-                             * it was not visible */
-                            last_level = -1;
+                            last_level = level;
                             last_match = LM_VISIBLE;
                             last_iter = i;
-                            last_is_in_cur_root = cur_root && itereq (&iter, cur_root);
+                            last_is_in_cur_root = FALSE;
                         }
                     }
-                    else
+                }
+                else if (last_match == 0)
+                {
+                    /* first result, or we alreayd had a non-match, but
+                     * it was not visible */
+                    last_level = -1;
+                    last_match = LM_VISIBLE;
+                    last_iter = i;
+                    last_is_in_cur_root = cur_root && itereq (&iter, cur_root);
+                }
+            }
+            else
+            {
+                if (match)
+                {
+                    if (last_match != LM_MATCH)
                     {
-                        if (match)
-                        {
-                            if (last_match != LM_MATCH)
-                            {
-                                /* we didn't have a match (i.e. we had nothing,
-                                 * or a visible non-match) */
-                                last_level = -1;
-                                last_match = LM_MATCH;
-                                last_iter = i;
-                                last_is_in_cur_root = itereq (&iter, cur_root);
-                            }
-                            else if (cur_root && itereq (&iter, cur_root))
-                            {
-                                /* we already have a non-visible match, but this
-                                 * one is in the current root */
-                                last_level = -1;
-                                last_match = LM_MATCH;
-                                last_iter = i;
-                                last_is_in_cur_root = TRUE;
-                            }
-                        }
-                        else if (!last_iter)
-                        {
-                            /* first result */
-                            last_level = -1;
-                            last_match = 0;
-                            last_iter = i;
-                            last_is_in_cur_root = cur_root && itereq (&iter, cur_root);
-                        }
-                        else if (last_match == 0)
-                        {
-                            /* we already had a non-visible non-match... */
+                        /* we didn't have a match (i.e. we had nothing,
+                         * or a visible non-match) */
+                        last_level = -1;
+                        last_match = LM_MATCH;
+                        last_iter = i;
+                        last_is_in_cur_root = itereq (&iter, cur_root);
+                    }
+                    else if (cur_root && itereq (&iter, cur_root))
+                    {
+                        /* we already have a non-visible match, but this
+                         * one is in the current root */
+                        last_level = -1;
+                        last_match = LM_MATCH;
+                        last_iter = i;
+                        last_is_in_cur_root = TRUE;
+                    }
+                }
+                else if (!last_iter)
+                {
+                    /* first result */
+                    last_level = -1;
+                    last_match = 0;
+                    last_iter = i;
+                    last_is_in_cur_root = cur_root && itereq (&iter, cur_root);
+                }
+                else if (last_match == 0)
+                {
+                    /* we already had a non-visible non-match... */
 
-                            if (cur_root && itereq (&iter, cur_root))
-                            {
-                                /* ...but this one is in the current root */
-                                last_level = -1;
-                                last_match = 0;
-                                last_iter = i;
-                                last_is_in_cur_root = TRUE;
-                            }
-                            else if (!last_is_in_cur_root)
-                            {
-                                gint level;
+                    if (cur_root && itereq (&iter, cur_root))
+                    {
+                        /* ...but this one is in the current root */
+                        last_level = -1;
+                        last_match = 0;
+                        last_iter = i;
+                        last_is_in_cur_root = TRUE;
+                    }
+                    else if (!last_is_in_cur_root)
+                    {
+                        gint level;
 
-                                /* ...neither are in current root, check the
-                                 * "level" to use the closest one */
+                        /* ...neither are in current root, check the
+                         * "level" to use the closest one */
 
-                                if (last_level < 0)
-                                    last_level = _get_level (model, last_iter, NULL);
-                                level = _get_level (NULL, NULL, n);
+                        if (last_level < 0)
+                            last_level = _get_level (model, last_iter, NULL);
+                        level = _get_level (NULL, NULL, n);
 
-                                if (level > last_level)
-                                {
-                                    last_level = level;
-                                    last_match = LM_VISIBLE;
-                                    last_iter = i;
-                                    last_is_in_cur_root = FALSE;
-                                }
-                            }
+                        if (level > last_level)
+                        {
+                            last_level = level;
+                            last_match = LM_VISIBLE;
+                            last_iter = i;
+                            last_is_in_cur_root = FALSE;
                         }
                     }
                 }
             }
         }
-        while (gtk_tree_model_iter_next (model, &iter));
+    }
+    g_slist_free (roots);
 
     if (is_match)
         *is_match = (last_match & LM_MATCH) ? TRUE : FALSE;
@@ -11006,10 +11940,7 @@ change_location (DonnaTreeView *tree,
     }
     else if (cl == CHANGING_LOCATION_SLOW)
     {
-        DonnaRowId rid = { DONNA_ARG_TYPE_PATH, (gpointer) ":last" };
         struct node_get_children_list_data *data = _data;
-        GHashTableIter ht_it;
-        GtkTreeIter *iter;
 
         /* is this still valid (or did the user click away already) ? */
         if (data->node)
@@ -11057,22 +11988,7 @@ change_location (DonnaTreeView *tree,
         if (gtk_tree_view_is_rubber_banding_pending ((GtkTreeView *) tree, TRUE))
             gtk_tree_view_stop_rubber_banding ((GtkTreeView *) tree, FALSE);
 #endif
-        /* clear the list (see selection_changed_cb() for why filling_list) */
-        priv->filling_list = TRUE;
-        /* speed up -- see below for why */
-        donna_tree_view_set_focus (tree, &rid, NULL);
-        gtk_tree_store_clear (priv->store);
-        priv->filling_list = FALSE;
-        /* also the hashtable. First we need to free the iters & unref the
-         * nodes, then actually clear it */
-        g_hash_table_iter_init (&ht_it, priv->hashtable);
-        while (g_hash_table_iter_next (&ht_it, (gpointer) &node, (gpointer) &iter))
-        {
-            if (iter)
-                gtk_tree_iter_free (iter);
-            g_object_unref (node);
-        }
-        g_hash_table_remove_all (priv->hashtable);
+        clear_list (tree);
         /* and show the "please wait" message */
         set_draw_state (tree, DRAW_WAIT);
         /* no more files on list */
@@ -11085,11 +12001,6 @@ change_location (DonnaTreeView *tree,
 
         if (priv->cl < CHANGING_LOCATION_GOT_CHILD)
         {
-            DonnaRowId rid = { DONNA_ARG_TYPE_PATH, (gpointer) ":last" };
-            GHashTableIter ht_it;
-            GtkTreeIter *iter;
-            DonnaNode *n;
-
 #ifdef GTK_IS_JJK
             /* make sure we don't try to perform a rubber band on two different
              * content, as that would be very likely to segfault in GTK, in
@@ -11097,26 +12008,7 @@ change_location (DonnaTreeView *tree,
             if (gtk_tree_view_is_rubber_banding_pending ((GtkTreeView *) tree, TRUE))
                 gtk_tree_view_stop_rubber_banding ((GtkTreeView *) tree, FALSE);
 #endif
-            /* clear the list (see selection_changed_cb() for why filling_list) */
-            priv->filling_list = TRUE;
-            /* set focus to last row, to speed things up. Because when clearing
-             * the store the treeview will react to each and every signal
-             * row-deleted, and figure out where to and move the focus, which
-             * when there's thousands of rows and the focus was on the first,
-             * slows thigns down quite a bit */
-            donna_tree_view_set_focus (tree, &rid, NULL);
-            gtk_tree_store_clear (priv->store);
-            priv->filling_list = FALSE;
-            /* also the hashtable. First we need to free the iters & unref the
-             * nodes, then actually clear it */
-            g_hash_table_iter_init (&ht_it, priv->hashtable);
-            while (g_hash_table_iter_next (&ht_it, (gpointer) &n, (gpointer) &iter))
-            {
-                if (iter)
-                    gtk_tree_iter_free (iter);
-                g_object_unref (n);
-            }
-            g_hash_table_remove_all (priv->hashtable);
+            clear_list (tree);
             /* no special drawing */
             set_draw_state (tree, DRAW_NOTHING);
         }
@@ -12513,51 +13405,164 @@ donna_tree_view_toggle_row (DonnaTreeView      *tree,
     return ret;
 }
 
-static void full_expand_children (DonnaTreeView *tree, GtkTreeIter *iter);
+/* long operations (e.g. full expand on a big tree) are split into steps, which
+ * are processed from an idle source for at most WORK_SLICE at a time, so they
+ * never block the UI (input, redraws) for long */
+#define WORK_SLICE          (8 * G_TIME_SPAN_MILLISECOND)
 
-static inline void
-full_expand (DonnaTreeView *tree, GtkTreeIter *iter)
+/* process one step of work; returns whether there's more to do */
+typedef gboolean (*work_step_fn)            (DonnaTreeView  *tree,
+                                             gpointer        data);
+
+struct work
+{
+    const gchar     *desc;
+    work_step_fn     step;
+    gpointer         data;
+    GDestroyNotify   destroy;
+    guint            done;
+};
+
+static void
+free_work (struct work *work)
+{
+    if (work->destroy)
+        work->destroy (work->data);
+    g_slice_free (struct work, work);
+}
+
+static gboolean
+process_works (DonnaTreeView *tree)
 {
     DonnaTreeViewPrivate *priv = tree->priv;
-    GtkTreeModel *model = (GtkTreeModel *) priv->store;
-    enum tree_expand es;
+    gint64 end = g_get_monotonic_time () + WORK_SLICE;
 
-    gtk_tree_model_get (model, iter,
-            TREE_COL_EXPAND_STATE,  &es,
-            -1);
-    switch (es)
+    while (!g_queue_is_empty (&priv->works) && g_get_monotonic_time () < end)
     {
-        case TREE_EXPAND_UNKNOWN:
-        case TREE_EXPAND_NEVER:
-            /* will import/create get_children task. Will also call ourself
-             * on iter, or make sure it gets called from the task's cb */
-            expand_row (tree, iter, /* expand */ TRUE,
-                    /* scroll to current */ FALSE, full_expand_children);
-            break;
+        struct work *work = g_queue_peek_head (&priv->works);
+        gboolean more;
 
-        case TREE_EXPAND_PARTIAL:
-        case TREE_EXPAND_MAXI:
-            {
-                GtkTreePath *path;
-                path = gtk_tree_model_get_path (model, iter);
-                gtk_tree_view_expand_row ((GtkTreeView *) tree, path, FALSE);
-                gtk_tree_path_free (path);
-                /* recursion */
-                full_expand_children (tree, iter);
-            }
-            break;
+        more = work->step (tree, work->data);
+        ++work->done;
+        if (more)
+            continue;
 
-        case TREE_EXPAND_NONE:
-        case TREE_EXPAND_WIP:
-            break;
+        DONNA_DEBUG (TREE_VIEW, priv->name,
+                g_debug2 ("TreeView '%s': %s done (%u steps)",
+                    priv->name, work->desc, work->done));
+        g_queue_pop_head (&priv->works);
+        free_work (work);
+    }
+
+    if (g_queue_is_empty (&priv->works))
+    {
+        priv->sid_works = 0;
+        return G_SOURCE_REMOVE;
     }
+
+    DONNA_DEBUG (TREE_VIEW, priv->name,
+            struct work *work = g_queue_peek_head (&priv->works);
+            g_debug3 ("TreeView '%s': %s in progress (%u steps done), "
+                "%u operation(s) pending",
+                priv->name, work->desc, work->done,
+                g_queue_get_length (&priv->works)));
+    return G_SOURCE_CONTINUE;
 }
 
+/* queue some work, step will be called (from main thread) until it returns
+ * FALSE, or cancel_works() is called. destroy is called on data when done */
 static void
-full_expand_children (DonnaTreeView *tree, GtkTreeIter *iter)
+queue_work (DonnaTreeView   *tree,
+            const gchar     *desc,
+            work_step_fn     step,
+            gpointer         data,
+            GDestroyNotify   destroy)
 {
     DonnaTreeViewPrivate *priv = tree->priv;
-    GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    struct work *work;
+
+    work = g_slice_new0 (struct work);
+    work->desc    = desc;
+    work->step    = step;
+    work->data    = data;
+    work->destroy = destroy;
+    g_queue_push_tail (&priv->works, work);
+
+    /* DEFAULT_IDLE so input & redraws are processed in between */
+    if (priv->sid_works == 0)
+        priv->sid_works = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                (GSourceFunc) process_works, tree, NULL);
+}
+
+static void
+cancel_works (DonnaTreeView *tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    struct work *work;
+
+    if (priv->sid_works > 0)
+    {
+        g_source_remove (priv->sid_works);
+        priv->sid_works = 0;
+    }
+
+    while ((work = g_queue_pop_head (&priv->works)))
+    {
+        DONNA_DEBUG (TREE_VIEW, priv->name,
+                g_debug2 ("TreeView '%s': %s cancelled (%u steps done)",
+                    priv->name, work->desc, work->done));
+        free_work (work);
+    }
+}
+
+/* mode tree only -- whether iter is (still) a row of node on tree */
+static gboolean
+is_row_of_node (DonnaTreeViewPrivate *priv, DonnaNode *node, GtkTreeIter *iter)
+{
+    GSList *l;
+
+    for (l = g_hash_table_lookup (priv->hashtable, node); l; l = l->next)
+        if (itereq (iter, (GtkTreeIter *) l->data))
+            return TRUE;
+    return FALSE;
+}
+
+/* mode tree only -- rows to full expand/collapse: nodes (with a ref) & their
+ * iter */
+struct fe_row
+{
+    DonnaNode   *node;
+    GtkTreeIter  iter;
+};
+
+static void
+free_fe_row (struct fe_row *row)
+{
+    g_object_unref (row->node);
+    g_slice_free (struct fe_row, row);
+}
+
+static void
+free_fe_rows (GQueue *rows)
+{
+    g_queue_free_full (rows, (GDestroyNotify) free_fe_row);
+}
+
+static void
+queue_fe_row (GQueue *rows, DonnaNode *node, GtkTreeIter *iter)
+{
+    struct fe_row *row;
+
+    row = g_slice_new (struct fe_row);
+    row->node = node;
+    row->iter = *iter;
+    g_queue_push_tail (rows, row);
+}
+
+static void
+queue_fe_children (DonnaTreeView *tree, GQueue *rows, GtkTreeIter *iter)
+{
+    GtkTreeModel *model = (GtkTreeModel *) tree->priv->store;
     GtkTreeIter child;
 
     if (G_UNLIKELY (!gtk_tree_model_iter_children (model, &child, iter)))
@@ -12565,10 +13570,109 @@ full_expand_children (DonnaTreeView *tree, GtkTreeIter *iter)
 
     do
     {
-        full_expand (tree, &child);
+        DonnaNode *node;
+
+        gtk_tree_model_get (model, &child,
+                TREE_COL_NODE,  &node,
+                -1);
+        /* fake node */
+        if (!node)
+            continue;
+        queue_fe_row (rows, node, &child);
     } while (gtk_tree_model_iter_next (model, &child));
 }
 
+static void full_expand_children (DonnaTreeView *tree, GtkTreeIter *iter);
+
+static gboolean
+full_expand_step (DonnaTreeView *tree, GQueue *rows)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    struct fe_row *row;
+    enum tree_expand es;
+
+    row = g_queue_pop_head (rows);
+    if (G_UNLIKELY (!row))
+        return FALSE;
+
+    /* make sure the row still exists, since things might have changed since
+     * it was queued */
+    if (!is_row_of_node (priv, row->node, &row->iter))
+    {
+        free_fe_row (row);
+        return !g_queue_is_empty (rows);
+    }
+
+    gtk_tree_model_get (model, &row->iter,
+            TREE_COL_EXPAND_STATE,  &es,
+            -1);
+    switch (es)
+    {
+        case TREE_EXPAND_UNKNOWN:
+        case TREE_EXPAND_NEVER:
+            /* will import/create get_children task. Will also call
+             * full_expand_children() on iter, or make sure it gets called from
+             * the task's cb */
+            expand_row (tree, &row->iter, /* expand */ TRUE,
+                    /* scroll to current */ FALSE, full_expand_children);
+            break;
+
+        case TREE_EXPAND_PARTIAL:
+        case TREE_EXPAND_MAXI:
+            {
+                GtkTreePath *path;
+                path = gtk_tree_model_get_path (model, &row->iter);
+                gtk_tree_view_expand_row ((GtkTreeView *) tree, path, FALSE);
+                gtk_tree_path_free (path);
+                /* children will be processed in the next steps */
+                queue_fe_children (tree, rows, &row->iter);
+            }
+            break;
+
+        case TREE_EXPAND_NONE:
+        case TREE_EXPAND_WIP:
+            break;
+    }
+
+    free_fe_row (row);
+    return !g_queue_is_empty (rows);
+}
+
+static inline void
+full_expand (DonnaTreeView *tree, GtkTreeIter *iter)
+{
+    GQueue *rows;
+    DonnaNode *node;
+
+    gtk_tree_model_get ((GtkTreeModel *) tree->priv->store, iter,
+            TREE_COL_NODE,  &node,
+            -1);
+    if (G_UNLIKELY (!node))
+        return;
+
+    rows = g_queue_new ();
+    queue_fe_row (rows, node, iter);
+    queue_work (tree, "Full expand", (work_step_fn) full_expand_step,
+            rows, (GDestroyNotify) free_fe_rows);
+}
+
+static void
+full_expand_children (DonnaTreeView *tree, GtkTreeIter *iter)
+{
+    GQueue *rows;
+
+    rows = g_queue_new ();
+    queue_fe_children (tree, rows, iter);
+    if (g_queue_is_empty (rows))
+    {
+        g_queue_free (rows);
+        return;
+    }
+    queue_work (tree, "Full expand", (work_step_fn) full_expand_step,
+            rows, (GDestroyNotify) free_fe_rows);
+}
+
 /**
  * donna_tree_view_full_expand:
  * @tree: A #DonnaTreeView
@@ -12618,21 +13722,57 @@ donna_tree_view_full_expand (DonnaTreeView      *tree,
     return TRUE;
 }
 
-static void
-reset_expand_flag (GtkTreeModel *model, GtkTreeIter *iter)
+static gboolean
+reset_expand_flag_step (DonnaTreeView *tree, GQueue *rows)
 {
-    GtkTreeIter child;
+    DonnaTreeViewPrivate *priv = tree->priv;
+    struct fe_row *row;
+    GtkTreePath *path;
+    gboolean expanded;
 
-    if (G_UNLIKELY (!gtk_tree_model_iter_children (model, &child, iter)))
-        return;
+    row = g_queue_pop_head (rows);
+    if (G_UNLIKELY (!row))
+        return FALSE;
 
-    do
+    if (!is_row_of_node (priv, row->node, &row->iter))
+    {
+        free_fe_row (row);
+        return !g_queue_is_empty (rows);
+    }
+
+    /* if the row was expanded again since the collapse, its flag is right and
+     * so are its children's, so leave the whole branch alone */
+    path = gtk_tree_model_get_path ((GtkTreeModel *) priv->store, &row->iter);
+    expanded = gtk_tree_view_row_expanded ((GtkTreeView *) tree, path);
+    gtk_tree_path_free (path);
+    if (!expanded)
     {
-        gtk_tree_store_set ((GtkTreeStore *) model, &child,
+        gtk_tree_store_set (priv->store, &row->iter,
                 TREE_COL_EXPAND_FLAG,   FALSE,
                 -1);
-        reset_expand_flag (model, &child);
-    } while (gtk_tree_model_iter_next (model, &child));
+        queue_fe_children (tree, rows, &row->iter);
+    }
+
+    free_fe_row (row);
+    return !g_queue_is_empty (rows);
+}
+
+/* recursively set the EXPAND_FLAG of all children of iter to FALSE. This is
+ * done in steps (see queue_work()) since it can go through a lot of rows */
+static void
+reset_expand_flag (DonnaTreeView *tree, GtkTreeIter *iter)
+{
+    GQueue *rows;
+
+    rows = g_queue_new ();
+    queue_fe_children (tree, rows, iter);
+    if (g_queue_is_empty (rows))
+    {
+        g_queue_free (rows);
+        return;
+    }
+    queue_work (tree, "Full collapse", (work_step_fn) reset_expand_flag_step,
+            rows, (GDestroyNotify) free_fe_rows);
 }
 
 /**
@@ -12686,7 +13826,7 @@ donna_tree_view_full_collapse (DonnaTreeView      *tree,
     gtk_tree_path_free (path);
 
     /* we also need to recursively set the EXPAND_FLAG to FALSE */
-    reset_expand_flag ((GtkTreeModel *) priv->store, &iter);
+    reset_expand_flag (tree, &iter);
 
     return TRUE;
 }
@@ -14754,40 +15894,117 @@ donna_tree_view_move_root (DonnaTreeView     *tree,
     return TRUE;
 }
 
-/* assumes ownership of str */
-static gboolean
-save_to_file (DonnaTreeView *tree,
-              const gchar   *filename,
-              GString       *str,
-              GError       **error)
+/* returns the file name to use for @filename, to be freed if different */
+static gchar *
+get_file (DonnaTreeView *tree, const gchar *filename)
 {
-    gchar *file;
-
     if (*filename == '/')
     {
         if (!g_get_filename_charsets (NULL))
-            file = g_filename_from_utf8 (filename, -1, NULL, NULL, NULL);
+            return g_filename_from_utf8 (filename, -1, NULL, NULL, NULL);
         else
-            file = (gchar *) filename;
+            return (gchar *) filename;
     }
     else
-        file = donna_app_get_conf_filename (tree->priv->app, filename);
+        return donna_app_get_conf_filename (tree->priv->app, filename);
+}
+
+/* list/tree files are written in chunks, so memory use doesn't grow with the
+ * number of rows being saved */
+#define SAVE_CHUNK_SIZE     (64 * 1024)
+
+struct save_file
+{
+    const gchar     *filename;
+    GOutputStream   *stream;
+    GString         *str;
+    GError          *err;
+};
+
+static gboolean
+save_file_open (DonnaTreeView       *tree,
+                const gchar         *filename,
+                struct save_file    *sf,
+                GError             **error)
+{
+    GFile *file;
+    gchar *f;
+
+    f = get_file (tree, filename);
+    file = g_file_new_for_path (f);
+    if (f != filename)
+        g_free (f);
 
-    if (!g_file_set_contents (file, str->str, (gssize) str->len, error))
+    /* much like g_file_set_contents() the file is only replaced on close */
+    sf->stream = (GOutputStream *) g_file_replace (file, NULL, FALSE,
+            G_FILE_CREATE_NONE, NULL, error);
+    g_object_unref (file);
+    if (!sf->stream)
     {
         g_prefix_error (error, "TreeView '%s': Failed to save to file '%s': ",
                 tree->priv->name, filename);
-        g_string_free (str, TRUE);
-        if (file != filename)
-            g_free (file);
         return FALSE;
     }
 
-    g_string_free (str, TRUE);
-    if (file != filename)
-        g_free (file);
+    sf->filename = filename;
+    sf->str = g_string_sized_new (SAVE_CHUNK_SIZE);
+    sf->err = NULL;
+    return TRUE;
+}
+
+/* writes what was buffered, unless there isn't enough yet (and not forced) */
+static void
+save_file_flush (struct save_file *sf, gboolean force)
+{
+    if (sf->str->len == 0 || (!force && sf->str->len < SAVE_CHUNK_SIZE))
+        return;
+
+    /* on error we keep going (to avoid error checking everywhere), simply
+     * discarding everything; The error will be reported on close */
+    if (!sf->err)
+        g_output_stream_write_all (sf->stream, sf->str->str, sf->str->len,
+                NULL, NULL, &sf->err);
+    g_string_truncate (sf->str, 0);
+}
+
+/* writes @data as is, e.g. for binary content */
+static void
+save_file_write (struct save_file *sf, gconstpointer data, gsize len)
+{
+    save_file_flush (sf, TRUE);
+    if (!sf->err && len > 0)
+        g_output_stream_write_all (sf->stream, data, len, NULL, NULL, &sf->err);
+}
+
+static gboolean
+save_file_close (DonnaTreeView *tree, struct save_file *sf, GError **error)
+{
+    save_file_flush (sf, TRUE);
+    g_string_free (sf->str, TRUE);
+
+    if (!sf->err)
+        g_output_stream_close (sf->stream, NULL, &sf->err);
+    else
+    {
+        GCancellable *cancellable;
+
+        /* closing cancelled means the original file isn't replaced */
+        cancellable = g_cancellable_new ();
+        g_cancellable_cancel (cancellable);
+        g_output_stream_close (sf->stream, cancellable, NULL);
+        g_object_unref (cancellable);
+    }
+    g_object_unref (sf->stream);
+
+    if (sf->err)
+    {
+        g_propagate_prefixed_error (error, sf->err,
+                "TreeView '%s': Failed to save to file '%s': ",
+                tree->priv->name, sf->filename);
+        return FALSE;
+    }
 
-    g_info ("TreeView '%s': Saved to file '%s'", tree->priv->name, filename);
+    g_info ("TreeView '%s': Saved to file '%s'", tree->priv->name, sf->filename);
 
     return TRUE;
 }
@@ -14837,6 +16054,7 @@ donna_tree_view_save_list_file (DonnaTreeView      *tree,
     GtkTreeModel *model;
     GtkTreeIter iter;
     DonnaNode *node;
+    struct save_file sf;
     GString *str;
     gchar *s;
 
@@ -14862,11 +16080,14 @@ donna_tree_view_save_list_file (DonnaTreeView      *tree,
         return FALSE;
     }
 
+    if (!save_file_open (tree, filename, &sf, error))
+        return FALSE;
+    str = sf.str;
     model = (GtkTreeModel *) priv->store;
 
     /* 1. current location */
     s = donna_node_get_full_location (priv->location);
-    str = g_string_new (s);
+    g_string_append (str, s);
     g_string_append_c (str, '\n');
     g_free (s);
 
@@ -14953,13 +16174,14 @@ donna_tree_view_save_list_file (DonnaTreeView      *tree,
                         g_string_append_c (str, '\n');
                         g_free (s);
                         g_object_unref (node);
+                        save_file_flush (&sf, FALSE);
                     }
                 }
             } while (gtk_tree_model_iter_next (model, &iter));
         }
     }
 
-    return save_to_file (tree, filename, str, error);
+    return save_file_close (tree, &sf, error);
 }
 
 static gboolean
@@ -14971,16 +16193,7 @@ load_from_file (DonnaTreeView   *tree,
     DonnaTreeViewPrivate *priv = tree->priv;
     gchar *file;
 
-    if (*filename == '/')
-    {
-        if (!g_get_filename_charsets (NULL))
-            file = g_filename_from_utf8 (filename, -1, NULL, NULL, NULL);
-        else
-            file = (gchar *) filename;
-    }
-    else
-        file = donna_app_get_conf_filename (priv->app, filename);
-
+    file = get_file (tree, filename);
     if (!g_file_get_contents (file, data, NULL, error))
     {
         g_prefix_error (error, "TreeView '%s': Failed to load from file; "
@@ -15325,7 +16538,7 @@ donna_tree_view_load_list_file (DonnaTreeView      *tree,
 
 static void
 save_row (DonnaTreeView     *tree,
-          GString           *str,
+          struct save_file  *sf,
           GtkTreeIter       *iter,
           guint              level,
           gboolean           is_in_tree,
@@ -15337,6 +16550,7 @@ save_row (DonnaTreeView     *tree,
     enum tree_expand es;
     gboolean expand_flag;
     GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    GString *str = sf->str;
     GtkTreeIter child;
     guint i;
     gboolean need_space = level > 0;
@@ -15451,10 +16665,11 @@ save_row (DonnaTreeView     *tree,
 
         /* done */
         g_string_append_c (str, '\n');
+        save_file_flush (sf, FALSE);
 
         /* process children */
         if (gtk_tree_model_iter_children (model, &child, iter))
-            do save_row (tree, str, &child, level + 1,
+            do save_row (tree, sf, &child, level + 1,
                     es == TREE_EXPAND_PARTIAL,
                     visuals);
             while (gtk_tree_model_iter_next (model, &child));
@@ -15535,6 +16750,7 @@ donna_tree_view_save_tree_file (DonnaTreeView      *tree,
     DonnaTreeViewPrivate *priv;
     GtkTreeModel *model;
     GtkTreeIter iter;
+    struct save_file sf;
     GString *str;
 
     g_return_val_if_fail (DONNA_IS_TREE_VIEW (tree), FALSE);
@@ -15560,12 +16776,14 @@ donna_tree_view_save_tree_file (DonnaTreeView      *tree,
         return FALSE;
     }
 
-    str = g_string_new (NULL);
+    if (!save_file_open (tree, filename, &sf, error))
+        return FALSE;
+    str = sf.str;
 
     do
     {
         /* export the root, and all its children (recursively) */
-        save_row (tree, str, &iter, 0, TRUE, visuals);
+        save_row (tree, &sf, &iter, 0, TRUE, visuals);
         /* export visuals not (yet) loaded */
         if (priv->tree_visuals)
         {
@@ -15664,378 +16882,1185 @@ donna_tree_view_save_tree_file (DonnaTreeView      *tree,
                         g_string_append_c (str, ' ');
                         g_string_append (str, fl);
                         g_string_append_c (str, '\n');
+                        save_file_flush (&sf, FALSE);
                     }
                 }
             }
         }
     }
-    while (gtk_tree_model_iter_next (model, &iter));
+    while (gtk_tree_model_iter_next (model, &iter));
+
+    return save_file_close (tree, &sf, error);
+}
+
+/* mode tree only -- remember visuals for a row not (yet) on tree, under @root */
+static void
+add_pending_visuals (DonnaTreeViewPrivate   *priv,
+                     GtkTreeIter            *root,
+                     const gchar            *fl,
+                     const gchar            *name,
+                     const gchar            *icon,
+                     const gchar            *box,
+                     const gchar            *highlight,
+                     const gchar            *click_mode)
+{
+    GSList *l = NULL;
+    struct visuals *visual;
+
+    visual = g_slice_new0 (struct visuals);
+    visual->root = *root;
+    visual->name = g_strdup (name);
+    if (icon)
+    {
+        if (*icon == '/')
+        {
+            GFile *file;
+
+            file = g_file_new_for_path (icon);
+            visual->icon = g_file_icon_new (file);
+            g_object_unref (file);
+        }
+        else
+            visual->icon = g_themed_icon_new (icon);
+    }
+    visual->box = g_strdup (box);
+    visual->highlight = g_strdup (highlight);
+    visual->click_mode = g_strdup (click_mode);
+
+    if (priv->tree_visuals)
+        l = g_hash_table_lookup (priv->tree_visuals, fl);
+    else
+        priv->tree_visuals = g_hash_table_new_full (
+                g_str_hash, g_str_equal,
+                g_free, NULL);
+
+    l = g_slist_prepend (l, visual);
+    g_hash_table_insert (priv->tree_visuals, g_strdup (fl), l);
+}
+
+/* mode tree only -- removes all rows, the current branch last */
+static void
+clear_tree (DonnaTreeView *tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    GtkTreeIter *root;
+    GtkTreeIter it;
+
+    /* We get the current root iter to make sure we remove the current branch
+     * (if any) last, to avoid having the location be changed for no reason
+     * (which would affect sync_with, and also therefore (via sync) could lead
+     * to the root being re-added. */
+    if (priv->location_iter.stamp != 0)
+        root = get_root_iter (tree, &priv->location_iter);
+    else
+        root = NULL;
+
+    if (gtk_tree_model_iter_children (model, &it, NULL))
+        for (;;)
+        {
+            if (root && itereq (&it, root))
+            {
+                if (!gtk_tree_model_iter_next (model, &it))
+                    break;
+            }
+            else
+            {
+                if (!remove_row_from_tree (tree, &it, RR_NOT_REMOVAL))
+                    break;
+            }
+        }
+    if (root)
+    {
+        it = *root; /* we must own the iter */
+        remove_row_from_tree (tree, &it, RR_NOT_REMOVAL);
+    }
+}
+
+/* mode tree only -- the tree file is streamed, and its rows added one line per
+ * step (see load_tree_step()) */
+struct load_tree
+{
+    const gchar         *filename;
+    GDataInputStream    *stream;
+    /* error reading from stream */
+    GError              *error;
+    DonnaTreeVisual      visuals;
+    /* last row added on each level, i.e. parents for the next lines */
+    GArray              *levels;
+    gint                 last_level;
+    GtkTreeIter          it;
+};
+
+struct lt_level
+{
+    DonnaNode   *node;
+    GtkTreeIter  iter;
+};
+
+static inline void
+clear_lt_level (struct lt_level *lvl)
+{
+    if (lvl->node)
+    {
+        g_object_unref (lvl->node);
+        lvl->node = NULL;
+    }
+    lvl->iter.stamp = 0;
+}
+
+#define load_visual(c_open, c_close, UPPER, var)    \
+    if (*s == c_open)                               \
+    {                                               \
+        gchar *d;                                   \
+        d = s + 1;                                  \
+        s = strchr (d, c_close);                    \
+        if (!s)                                     \
+        {                                           \
+            g_warning ("TreeView '%s': Invalid data in tree file '%s'", \
+                    priv->name, lt->filename);      \
+            goto next;                              \
+        }                                           \
+        if (visuals & DONNA_TREE_VISUAL_##UPPER)    \
+        {                                           \
+            *s = '\0';                              \
+            var = d;                                \
+        }                                           \
+        if (*++s == ' ')                            \
+            ++s;                                    \
+    }
+
+static gboolean
+load_tree_step (DonnaTreeView *tree, struct load_tree *lt)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    DonnaTreeVisual visuals = lt->visuals;
+    GError *err = NULL;
+    GtkTreeIter parent;
+    struct lt_level *lvl;
+    DonnaNode *node;
+    gint level          = 0;
+    gchar *name         = NULL;
+    gchar *icon         = NULL;
+    gchar *box          = NULL;
+    gchar *highlight    = NULL;
+    gchar *click_mode   = NULL;
+    gboolean is_in_tree;
+    gboolean is_future_location = FALSE;
+    gboolean expand = FALSE;
+    enum tree_expand es = TREE_EXPAND_UNKNOWN;
+    gchar *line;
+    gchar *s;
+
+    line = g_data_input_stream_read_line (lt->stream, NULL, NULL, &lt->error);
+    if (!line)
+        return FALSE;
+    s = line;
+
+    /* visuals only? */
+    if (*s == '=')
+    {
+        is_in_tree = FALSE;
+        ++s;
+        if (*s == ' ')
+            ++s;
+    }
+    else
+    {
+        is_in_tree = TRUE;
+        /* get the level */
+        for ( ; *s == '-'; ++s, ++level)
+            ;
+        if (level > 0 && *s == ' ')
+            ++s;
+    }
+
+    /* visuals */
+    load_visual ('"', '"', NAME, name)
+    load_visual ('@', '@', ICON, icon)
+    load_visual ('{', '}', BOX, box)
+    load_visual ('[', ']', HIGHLIGHT, highlight)
+    load_visual ('(', ')', CLICK_MODE, click_mode)
+
+    /* flags */
+    if (*s == '!')
+    {
+        is_future_location = TRUE;
+        ++s;
+    }
+    if (*s == '<')
+    {
+        expand = TRUE;
+        ++s;
+    }
+    if (*s == '+')
+    {
+        es = TREE_EXPAND_PARTIAL;
+        ++s;
+    }
+    else if (*s == '*')
+    {
+        es = TREE_EXPAND_MAXI;
+        ++s;
+    }
+
+    /* last_level was same/deeper down */
+    if (lt->last_level >= level && lt->last_level >= 0)
+        clear_lt_level (&g_array_index (lt->levels, struct lt_level, level));
+
+    /* make sure we want to add it */
+    if (is_in_tree && !priv->show_hidden)
+    {
+
+        /* get node */
+        node = donna_app_get_node (priv->app, s, FALSE, &err);
+        if (!node)
+        {
+            g_warning ("TreeView '%s': Failed to get node for '%s': %s",
+                    priv->name, s, (err) ? err->message : "(no error message)");
+            g_clear_error (&err);
+            is_in_tree = FALSE;
+        }
+        else
+        {
+            gchar *s_name = donna_node_get_name (node);
+            if (s_name && *s_name == '.')
+                is_in_tree = FALSE;
+            g_free (s_name);
+        }
+    }
+    else
+        node = NULL;
+
+    if (is_in_tree)
+    {
+        if (!node)
+        {
+            node = donna_app_get_node (priv->app, s, FALSE, &err);
+            if (!node)
+            {
+                g_warning ("TreeView '%s': Failed to get node for '%s': %s",
+                        priv->name, s, (err) ? err->message : "(no error message)");
+                g_clear_error (&err);
+                goto next;
+            }
+        }
+
+        /* get parent iter */
+        parent.stamp = 0;
+        if (level > 0 && (guint) level <= lt->levels->len)
+        {
+            lvl = &g_array_index (lt->levels, struct lt_level, level - 1);
+            if (lvl->node)
+            {
+                /* things might have changed since the parent was added */
+                if (!is_row_of_node (priv, lvl->node, &lvl->iter))
+                {
+                    g_object_unref (node);
+                    goto next;
+                }
+                parent = lvl->iter;
+            }
+        }
+
+        /* add to tree */
+        add_node_to_tree (tree, (parent.stamp != 0) ? &parent : NULL, node, &lt->it);
+
+        /* set up the iter for this level (so we can add children) */
+        if ((guint) level >= lt->levels->len)
+            g_array_set_size (lt->levels, (guint) level + 2);
+        lvl = &g_array_index (lt->levels, struct lt_level, level);
+        clear_lt_level (lvl);
+        lvl->node = g_object_ref (node);
+        lvl->iter = lt->it;
+        lt->last_level = level;
+
+        /* set visuals */
+        if (name)
+            set_tree_visual (tree, &lt->it,
+                    DONNA_TREE_VISUAL_NAME, name, NULL);
+        if (icon)
+            set_tree_visual (tree, &lt->it,
+                    DONNA_TREE_VISUAL_ICON, icon, NULL);
+        if (box)
+            set_tree_visual (tree, &lt->it,
+                    DONNA_TREE_VISUAL_BOX, box, NULL);
+        if (highlight)
+            set_tree_visual (tree, &lt->it,
+                    DONNA_TREE_VISUAL_HIGHLIGHT, highlight, NULL);
+        if (click_mode)
+            set_tree_visual (tree, &lt->it,
+                    DONNA_TREE_VISUAL_CLICK_MODE, click_mode, NULL);
+
+        if (es == TREE_EXPAND_PARTIAL && priv->is_minitree)
+            set_es (priv, &lt->it, es);
+        else if (es == TREE_EXPAND_MAXI && !expand)
+            /* only get the children & load them, no expansion */
+            expand_row (tree, &lt->it, FALSE, FALSE, NULL);
+
+        if (expand)
+        {
+            GtkTreePath *path;
+
+            path = gtk_tree_model_get_path ((GtkTreeModel*) priv->store, &lt->it);
+            gtk_tree_view_expand_row ((GtkTreeView *) tree, path, FALSE);
+            if (is_future_location)
+                gtk_tree_view_set_focused_row ((GtkTreeView *) tree, path);
+            gtk_tree_path_free (path);
+        }
+
+        if (is_future_location)
+        {
+            if (!expand)
+            {
+                GtkTreePath *path;
+
+                path = gtk_tree_model_get_path ((GtkTreeModel*) priv->store, &lt->it);
+                gtk_tree_view_set_focused_row ((GtkTreeView *) tree, path);
+                gtk_tree_path_free (path);
+            }
+            gtk_tree_selection_select_iter (
+                    gtk_tree_view_get_selection ((GtkTreeView *) tree),
+                    &lt->it);
+        }
+    }
+    /* add visuals for non-loaded row */
+    else if (name || icon || box || highlight || click_mode)
+    {
+        /* get current root */
+        if (!gtk_tree_model_iter_nth_child (model, &lt->it, NULL,
+                    gtk_tree_model_iter_n_children (model, NULL)))
+        {
+        }
+
+        add_pending_visuals (priv, &lt->it, s,
+                name, icon, box, highlight, click_mode);
+    }
+
+    donna_g_object_unref (node);
+
+next:
+    g_free (line);
+    return TRUE;
+}
+
+#undef load_visual
+
+/**
+ * donna_tree_view_load_tree_file:
+ * @tree: A #DonnaTreeView
+ * @filename: Name of the tree file to load from
+ * @visuals: Which #tree-visuals to load from the tree file
+ * @error: (allow-none): Return location of a #GError, or %NULL
+ *
+ * Loads the content of @tree from tree file @filename, usually a file
+ * previously saved using donna_tree_view_save_tree_file()
+ *
+ * @filename can be either a full path to a file, or it will be processed
+ * through donna_app_get_conf_filename()
+ *
+ * For more information on the format of the file, see
+ * donna_tree_view_save_tree_file()
+ *
+ * Tree files can include #tree-visuals, only those specified in @visuals will
+ * be loaded into @tree.
+ *
+ * The file is read line by line as rows are added, so it is never loaded in
+ * memory as a whole. All rows have been added when this function returns.
+ * Failing to load a row (e.g. failing to get a node) is only logged, and
+ * loading continues. Should an error occur while reading the file after the
+ * tree was cleared, the loading stops there (i.e. the tree was only partially
+ * loaded) and %FALSE is returned.
+ *
+ * Note that this is obviously only supported on trees. For lists, see
+ * donna_tree_view_load_list_file()
+ *
+ * Returns: %TRUE on success, else %FALSE
+ */
+gboolean
+donna_tree_view_load_tree_file (DonnaTreeView      *tree,
+                                const gchar        *filename,
+                                DonnaTreeVisual     visuals,
+                                GError            **error)
+{
+    DonnaTreeViewPrivate *priv;
+    GFileInputStream *fis;
+    GDataInputStream *stream;
+    GFile *file;
+    struct load_tree lt = { NULL, };
+    gssize len;
+    gboolean ret = TRUE;
+    gchar *f;
+    guint i;
+
+    g_return_val_if_fail (DONNA_IS_TREE_VIEW (tree), FALSE);
+    g_return_val_if_fail (filename != NULL, FALSE);
+    priv = tree->priv;
+
+    if (!priv->is_tree)
+    {
+        g_set_error (error, DONNA_TREE_VIEW_ERROR,
+                DONNA_TREE_VIEW_ERROR_INVALID_MODE,
+                "TreeView '%s': Cannot load tree file in mode List",
+                priv->name);
+        return FALSE;
+    }
+
+    f = get_file (tree, filename);
+    file = g_file_new_for_path (f);
+    if (f != filename)
+        g_free (f);
+    fis = g_file_read (file, NULL, error);
+    g_object_unref (file);
+    if (!fis)
+    {
+        g_prefix_error (error, "TreeView '%s': Failed to load from file; "
+                "Error reading '%s': ",
+                priv->name, filename);
+        return FALSE;
+    }
+    stream = g_data_input_stream_new ((GInputStream *) fis);
+    g_object_unref (fis);
+
+    /* fill the buffer, so we know there's data before we clear the tree */
+    len = g_buffered_input_stream_fill ((GBufferedInputStream *) stream, -1,
+            NULL, error);
+    if (len <= 0)
+    {
+        if (len < 0)
+            g_prefix_error (error, "TreeView '%s': Failed to load from file; "
+                    "Error reading '%s': ",
+                    priv->name, filename);
+        else
+            g_set_error (error, DONNA_TREE_VIEW_ERROR,
+                    DONNA_TREE_VIEW_ERROR_OTHER,
+                    "TreeView '%s': Failed to load from file; "
+                    "Invalid data in '%s'",
+                    priv->name, filename);
+        g_object_unref (stream);
+        return FALSE;
+    }
+
+    /* since the tree gets cleared, any previous loading (or full expand) still
+     * in progress is now moot */
+    cancel_works (tree);
+
+    /* first off, let's clear the tree */
+    clear_tree (tree);
+
+    /* if the tree was fresh, we might need to load an arrangement */
+    if (!priv->arrangement)
+        donna_tree_view_build_arrangement (tree, FALSE);
+
+    lt.filename    = filename;
+    lt.stream      = stream;
+    lt.visuals     = visuals;
+    lt.levels      = g_array_sized_new (FALSE, TRUE, sizeof (struct lt_level), 8);
+    /* so we can actually use those directly */
+    g_array_set_size (lt.levels, 8);
+    lt.last_level  = -1;
+
+    while (load_tree_step (tree, &lt))
+        ;
+
+    if (lt.error)
+    {
+        g_propagate_prefixed_error (error, lt.error,
+                "TreeView '%s': Failed to finish loading from file; "
+                "Error reading '%s': ",
+                priv->name, filename);
+        ret = FALSE;
+    }
+    else
+        g_info ("TreeView '%s': Loaded from file '%s'", priv->name, filename);
+
+    for (i = 0; i < lt.levels->len; ++i)
+        clear_lt_level (&g_array_index (lt.levels, struct lt_level, i));
+    g_array_free (lt.levels, TRUE);
+    g_object_unref (stream);
+
+    return ret;
+}
+
+/* Tree snapshots: binary version of tree files, see
+ * donna_tree_view_save_tree_snapshot()
+ *
+ * The file (in native endianness, it is only meant to be read back on the same
+ * machine) is made of a header, the rows in the order they're to be added (i.e.
+ * parents before children), and the string table: NUL-terminated strings,
+ * each one only stored once, starting with an empty one so offset 0 can be
+ * used as "none".
+ * Rows only refer to their parent, so the whole file can be mmap-ed and
+ * used directly, after a single validation pass.
+ */
+
+#define SNAPSHOT_MAGIC          "DNTSNAPS"
+#define SNAPSHOT_VERSION        1
+
+/* in the same order as the DonnaTreeVisual flags, i.e. (1 << SNAPSHOT_NAME) ==
+ * DONNA_TREE_VISUAL_NAME, etc */
+enum
+{
+    SNAPSHOT_NAME = 0,
+    SNAPSHOT_ICON,
+    SNAPSHOT_BOX,
+    SNAPSHOT_HIGHLIGHT,
+    SNAPSHOT_CLICK_MODE,
+    NB_SNAPSHOT_VISUALS
+};
+
+/* flags of a row; lowest bits are its enum tree_expand */
+#define SNAPSHOT_ES_MASK        0x0f
+#define SNAPSHOT_EXPANDED       (1 << 4)
+#define SNAPSHOT_LOCATION       (1 << 5)
+#define SNAPSHOT_SELECTED       (1 << 6)
+/* a descendant is the location/selected, so the row's children must be
+ * loaded right away */
+#define SNAPSHOT_PINNED         (1 << 7)
+/* not a row, visuals of a row not loaded on tree, parent being its root */
+#define SNAPSHOT_VISUALS_ONLY   (1 << 8)
+
+struct snapshot_header
+{
+    gchar   magic[8];
+    guint32 version;
+    guint32 visuals;        /* DonnaTreeVisual saved */
+    guint32 nb_rows;
+    guint32 strings_len;
+};
+
+struct snapshot_row
+{
+    guint32 parent;         /* index of the parent row + 1, or 0 for roots */
+    guint32 flags;
+    guint32 location;       /* offset in strings of the full location */
+    guint32 visuals[NB_SNAPSHOT_VISUALS]; /* offsets in strings, or 0 */
+};
+
+static const gint snapshot_cols[NB_SNAPSHOT_VISUALS] = {
+    TREE_COL_NAME,
+    TREE_COL_ICON,
+    TREE_COL_BOX,
+    TREE_COL_HIGHLIGHT,
+    TREE_COL_CLICK_MODE
+};
+
+struct save_snapshot
+{
+    DonnaTreeVisual  visuals;
+    GArray          *rows;
+    GString         *strings;
+    /* string -> offset in strings */
+    GHashTable      *interned;
+};
+
+static guint32
+snapshot_intern (struct save_snapshot *ss, const gchar *s)
+{
+    gpointer offset;
+    guint32 o;
+
+    if (!s || *s == '\0')
+        return 0;
+
+    if (g_hash_table_lookup_extended (ss->interned, s, NULL, &offset))
+        return GPOINTER_TO_UINT (offset);
+
+    o = (guint32) ss->strings->len;
+    g_string_append_len (ss->strings, s, (gssize) strlen (s) + 1);
+    g_hash_table_insert (ss->interned, g_strdup (s), GUINT_TO_POINTER (o));
+    return o;
+}
+
+/* icons can only be restored from a filename or icon name, e.g. not from a
+ * ". GThemedIcon icon-name1 icon-name2" kinda string */
+static guint32
+snapshot_intern_icon (struct save_snapshot *ss, GIcon *icon)
+{
+    guint32 o = 0;
+    gchar *s;
+
+    if (!icon)
+        return 0;
+
+    s = g_icon_to_string (icon);
+    if (G_LIKELY (s && *s != '.'))
+        o = snapshot_intern (ss, s);
+    g_free (s);
+    return o;
+}
+
+/* same logic as save_row() as to which rows are included; Returns whether the
+ * row or one of its descendants is the location/selected */
+static gboolean
+snapshot_add_row (DonnaTreeView         *tree,
+                  struct save_snapshot  *ss,
+                  GtkTreeIter           *iter,
+                  guint32                parent,
+                  gboolean               is_in_tree)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GtkTreeModel *model = (GtkTreeModel *) priv->store;
+    struct snapshot_row row = { 0, };
+    DonnaNode *node;
+    DonnaTreeVisual v;
+    enum tree_expand es;
+    gboolean expand_flag;
+    gboolean pinned = FALSE;
+    GtkTreeIter child;
+    guint32 index;
+    guint i;
+    gchar *s;
+
+    gtk_tree_model_get (model, iter,
+            TREE_COL_NODE,          &node,
+            TREE_COL_VISUALS,       &v,
+            TREE_COL_EXPAND_STATE,  &es,
+            TREE_COL_EXPAND_FLAG,   &expand_flag,
+            -1);
+
+    /* fake node, nothing to do */
+    if (!node)
+        return FALSE;
+
+    is_in_tree = is_in_tree || expand_flag
+        || es == TREE_EXPAND_PARTIAL || es == TREE_EXPAND_MAXI
+        || (ss->visuals & v);
+    if (!is_in_tree)
+    {
+        g_object_unref (node);
+        return FALSE;
+    }
+
+    row.parent = parent;
+    row.flags  = (guint32) es & SNAPSHOT_ES_MASK;
+    if (expand_flag)
+        row.flags |= SNAPSHOT_EXPANDED;
+    if (itereq (iter, &priv->location_iter))
+        row.flags |= SNAPSHOT_LOCATION;
+    if (gtk_tree_selection_iter_is_selected (
+                gtk_tree_view_get_selection ((GtkTreeView *) tree), iter))
+        row.flags |= SNAPSHOT_SELECTED;
+
+    for (i = 0; i < NB_SNAPSHOT_VISUALS; ++i)
+    {
+        DonnaTreeVisual visual = (DonnaTreeVisual) (1 << i);
+
+        if (!(ss->visuals & visual) || !(v & visual))
+            continue;
+
+        if (i == SNAPSHOT_ICON)
+        {
+            GIcon *icon;
+
+            gtk_tree_model_get (model, iter, TREE_COL_ICON, &icon, -1);
+            row.visuals[i] = snapshot_intern_icon (ss, icon);
+            donna_g_object_unref (icon);
+        }
+        else
+        {
+            gtk_tree_model_get (model, iter, snapshot_cols[i], &s, -1);
+            row.visuals[i] = snapshot_intern (ss, s);
+            g_free (s);
+        }
+    }
+
+    s = donna_node_get_full_location (node);
+    row.location = snapshot_intern (ss, s);
+    g_free (s);
+
+    index = ss->rows->len;
+    g_array_append_val (ss->rows, row);
+
+    if (gtk_tree_model_iter_children (model, &child, iter))
+        do
+        {
+            if (snapshot_add_row (tree, ss, &child, index + 1,
+                        es == TREE_EXPAND_PARTIAL))
+                pinned = TRUE;
+        }
+        while (gtk_tree_model_iter_next (model, &child));
+
+    if (pinned)
+        g_array_index (ss->rows, struct snapshot_row, index).flags
+            |= SNAPSHOT_PINNED;
+
+    g_object_unref (node);
+    return pinned || (row.flags & (SNAPSHOT_LOCATION | SNAPSHOT_SELECTED));
+}
+
+/**
+ * donna_tree_view_save_tree_snapshot:
+ * @tree: A #DonnaTreeView
+ * @filename: Name of the file to save to
+ * @visuals: Which #tree-visuals to include in the snapshot
+ * @error: (allow-none): Return location of a #GError, or %NULL
+ *
+ * Saves the tree @tree into a tree snapshot, so it can be loaded back later
+ * using donna_tree_view_load_tree_snapshot()
+ *
+ * @filename can be either a full path to a file, or it will be processed
+ * through donna_app_get_conf_filename()
+ *
+ * A tree snapshot holds the same information as a tree file (see
+ * donna_tree_view_save_tree_file()) plus which rows were selected, only in a
+ * compact binary format, meant to be read back quickly (e.g. to restore a large
+ * tree on startup). It isn't meant to be edited, and might not be readable
+ * from another version of donnatella (or another machine).
+ *
+ * Selected rows are made sure to be loaded when loading the snapshot, but the
+ * selection itself isn't restored: only the location gets selected.
+ *
+ * Note that this is obviously only supported on trees.
+ *
+ * Returns: %TRUE on success, else %FALSE
+ */
+gboolean
+donna_tree_view_save_tree_snapshot (DonnaTreeView      *tree,
+                                    const gchar        *filename,
+                                    DonnaTreeVisual     visuals,
+                                    GError            **error)
+{
+    DonnaTreeViewPrivate *priv;
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    struct save_snapshot ss;
+    struct snapshot_header header = { { 0, }, 0, };
+    struct save_file sf;
+
+    g_return_val_if_fail (DONNA_IS_TREE_VIEW (tree), FALSE);
+    g_return_val_if_fail (filename != NULL, FALSE);
+    priv = tree->priv;
+    model = (GtkTreeModel *) priv->store;
+
+    if (!priv->is_tree)
+    {
+        g_set_error (error, DONNA_TREE_VIEW_ERROR,
+                DONNA_TREE_VIEW_ERROR_INVALID_MODE,
+                "TreeView '%s': Cannot save tree snapshot in mode List",
+                priv->name);
+        return FALSE;
+    }
+
+    if (G_UNLIKELY (!gtk_tree_model_iter_children (model, &iter, NULL)))
+    {
+        g_set_error (error, DONNA_TREE_VIEW_ERROR,
+                DONNA_TREE_VIEW_ERROR_NOT_FOUND,
+                "TreeView '%s': Cannot save to file, nothing in tree",
+                priv->name);
+        return FALSE;
+    }
+
+    ss.visuals  = visuals;
+    ss.rows     = g_array_new (FALSE, FALSE, sizeof (struct snapshot_row));
+    ss.strings  = g_string_new (NULL);
+    /* offset 0: empty string, i.e. none */
+    g_string_append_c (ss.strings, '\0');
+    ss.interned = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    do
+    {
+        guint32 root = ss.rows->len;
+
+        /* export the root, and all its children (recursively) */
+        snapshot_add_row (tree, &ss, &iter, 0, TRUE);
+        if (G_UNLIKELY (ss.rows->len == root))
+            continue;
+
+        /* export visuals not (yet) loaded */
+        if (priv->tree_visuals)
+        {
+            GHashTableIter it;
+            const gchar *fl;
+            GSList *l;
+
+            g_hash_table_iter_init (&it, priv->tree_visuals);
+            while (g_hash_table_iter_next (&it, (gpointer) &fl, (gpointer) &l))
+            {
+                for ( ; l; l = l->next)
+                {
+                    struct visuals *visual = l->data;
+                    struct snapshot_row row = { 0, };
+
+                    if (!itereq (&visual->root, &iter))
+                        continue;
+
+                    row.parent = root + 1;
+                    row.flags  = SNAPSHOT_VISUALS_ONLY;
+                    if (visuals & DONNA_TREE_VISUAL_NAME)
+                        row.visuals[SNAPSHOT_NAME] = snapshot_intern (&ss,
+                                visual->name);
+                    if (visuals & DONNA_TREE_VISUAL_ICON)
+                        row.visuals[SNAPSHOT_ICON] = snapshot_intern_icon (&ss,
+                                visual->icon);
+                    if (visuals & DONNA_TREE_VISUAL_BOX)
+                        row.visuals[SNAPSHOT_BOX] = snapshot_intern (&ss,
+                                visual->box);
+                    if (visuals & DONNA_TREE_VISUAL_HIGHLIGHT)
+                        row.visuals[SNAPSHOT_HIGHLIGHT] = snapshot_intern (&ss,
+                                visual->highlight);
+                    if (visuals & DONNA_TREE_VISUAL_CLICK_MODE)
+                        row.visuals[SNAPSHOT_CLICK_MODE] = snapshot_intern (&ss,
+                                visual->click_mode);
+
+                    if (row.visuals[SNAPSHOT_NAME] || row.visuals[SNAPSHOT_ICON]
+                            || row.visuals[SNAPSHOT_BOX]
+                            || row.visuals[SNAPSHOT_HIGHLIGHT]
+                            || row.visuals[SNAPSHOT_CLICK_MODE])
+                    {
+                        row.location = snapshot_intern (&ss, fl);
+                        g_array_append_val (ss.rows, row);
+                    }
+                }
+            }
+        }
+    }
+    while (gtk_tree_model_iter_next (model, &iter));
+
+    memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (header.magic));
+    header.version      = SNAPSHOT_VERSION;
+    header.visuals      = (guint32) visuals;
+    header.nb_rows      = ss.rows->len;
+    header.strings_len  = (guint32) ss.strings->len;
+
+    g_hash_table_unref (ss.interned);
+    if (!save_file_open (tree, filename, &sf, error))
+    {
+        g_array_free (ss.rows, TRUE);
+        g_string_free (ss.strings, TRUE);
+        return FALSE;
+    }
+    save_file_write (&sf, &header, sizeof (header));
+    save_file_write (&sf, ss.rows->data,
+            (gsize) ss.rows->len * sizeof (struct snapshot_row));
+    save_file_write (&sf, ss.strings->str, ss.strings->len);
+    g_array_free (ss.rows, TRUE);
+    g_string_free (ss.strings, TRUE);
+
+    return save_file_close (tree, &sf, error);
+}
+
+/* mode tree only -- rows of a snapshot are added progressively, one per step
+ * (see queue_work()) */
+struct load_snapshot
+{
+    gchar                       *filename;
+    GMappedFile                 *mf;
+    const struct snapshot_row   *rows;
+    guint32                      nb_rows;
+    const gchar                 *strings;
+    guint32                      cur;
+    DonnaTreeVisual              visuals;
+    /* ancestors of the current row */
+    GArray                      *stack;
+};
+
+struct snapshot_level
+{
+    guint32      row;
+    /* NULL if the row wasn't loaded, only its visuals remembered */
+    DonnaNode   *node;
+    GtkTreeIter  iter;
+    /* children aren't loaded (until the row gets expanded) */
+    gboolean     defer_children;
+};
+
+static void
+pop_snapshot_level (GArray *stack)
+{
+    struct snapshot_level *lvl;
+
+    lvl = &g_array_index (stack, struct snapshot_level, stack->len - 1);
+    donna_g_object_unref (lvl->node);
+    g_array_set_size (stack, stack->len - 1);
+}
+
+static void
+free_load_snapshot (struct load_snapshot *ls)
+{
+    while (ls->stack->len > 0)
+        pop_snapshot_level (ls->stack);
+    g_array_free (ls->stack, TRUE);
+    g_mapped_file_unref (ls->mf);
+    g_free (ls->filename);
+    g_slice_free (struct load_snapshot, ls);
+}
+
+static gboolean
+validate_snapshot (const gchar *data, gsize len)
+{
+    const struct snapshot_header *h = (const struct snapshot_header *) data;
+    const struct snapshot_row *rows;
+    guint32 i;
+
+    if (!data || len < sizeof (struct snapshot_header)
+            || memcmp (h->magic, SNAPSHOT_MAGIC, sizeof (h->magic)) != 0
+            || h->version != SNAPSHOT_VERSION
+            || len != sizeof (struct snapshot_header)
+                + (gsize) h->nb_rows * sizeof (struct snapshot_row)
+                + (gsize) h->strings_len
+            || h->strings_len == 0 || data[len - 1] != '\0')
+        return FALSE;
+
+    rows = (const struct snapshot_row *) (data + sizeof (struct snapshot_header));
+    for (i = 0; i < h->nb_rows; ++i)
+    {
+        guint v;
+
+        /* parents always come first; visuals-only rows must have one */
+        if (rows[i].parent > i
+                || ((rows[i].flags & SNAPSHOT_VISUALS_ONLY) && rows[i].parent == 0)
+                || (rows[i].flags & SNAPSHOT_ES_MASK) > TREE_EXPAND_MAXI
+                || rows[i].location == 0
+                || rows[i].location >= h->strings_len)
+            return FALSE;
+        for (v = 0; v < NB_SNAPSHOT_VISUALS; ++v)
+            if (rows[i].visuals[v] >= h->strings_len)
+                return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+load_snapshot_step (DonnaTreeView *tree, struct load_snapshot *ls)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+    GError *err = NULL;
+    const struct snapshot_row *row;
+    struct snapshot_level *parent = NULL;
+    struct snapshot_level lvl = { 0, };
+    const gchar *v[NB_SNAPSHOT_VISUALS];
+    const gchar *fl;
+    DonnaNode *node;
+    enum tree_expand es;
+    gboolean expand;
+    GtkTreeIter it;
+    guint i;
+
+    if (ls->cur >= ls->nb_rows)
+    {
+        g_info ("TreeView '%s': Loaded snapshot '%s'", priv->name, ls->filename);
+        return FALSE;
+    }
+
+    lvl.row = ls->cur++;
+    row = &ls->rows[lvl.row];
+    fl = ls->strings + row->location;
+
+    /* move up to the parent */
+    while (ls->stack->len > 0)
+    {
+        parent = &g_array_index (ls->stack, struct snapshot_level,
+                ls->stack->len - 1);
+        if (parent->row + 1 == row->parent)
+            break;
+        pop_snapshot_level (ls->stack);
+        parent = NULL;
+    }
+    /* parent wasn't loaded (e.g. failed to get node), so neither is this */
+    if (row->parent > 0 && !parent)
+        return TRUE;
+
+    for (i = 0; i < NB_SNAPSHOT_VISUALS; ++i)
+        v[i] = ((ls->visuals & (1 << i)) && row->visuals[i] > 0)
+            ? ls->strings + row->visuals[i] : NULL;
+
+    if ((row->flags & SNAPSHOT_VISUALS_ONLY) || (parent && parent->defer_children))
+    {
+        /* the root is always the first level */
+        struct snapshot_level *root = &g_array_index (ls->stack,
+                struct snapshot_level, 0);
+
+        if (v[SNAPSHOT_NAME] || v[SNAPSHOT_ICON] || v[SNAPSHOT_BOX]
+                || v[SNAPSHOT_HIGHLIGHT] || v[SNAPSHOT_CLICK_MODE])
+            add_pending_visuals (priv, &root->iter, fl,
+                    v[SNAPSHOT_NAME], v[SNAPSHOT_ICON], v[SNAPSHOT_BOX],
+                    v[SNAPSHOT_HIGHLIGHT], v[SNAPSHOT_CLICK_MODE]);
+
+        /* so its children are also deferred */
+        if (!(row->flags & SNAPSHOT_VISUALS_ONLY))
+        {
+            lvl.defer_children = TRUE;
+            g_array_append_val (ls->stack, lvl);
+        }
+        return TRUE;
+    }
+
+    node = donna_app_get_node (priv->app, fl, FALSE, &err);
+    if (!node)
+    {
+        g_warning ("TreeView '%s': Failed to get node for '%s': %s",
+                priv->name, fl, (err) ? err->message : "(no error message)");
+        g_clear_error (&err);
+        return TRUE;
+    }
+
+    if (!priv->show_hidden)
+    {
+        gchar *name = donna_node_get_name (node);
+        gboolean is_hidden = name && *name == '.';
+
+        g_free (name);
+        if (is_hidden)
+        {
+            g_object_unref (node);
+            return TRUE;
+        }
+    }
+
+    /* things might have changed since the parent was added */
+    if (parent && !is_row_of_node (priv, parent->node, &parent->iter))
+    {
+        g_object_unref (node);
+        return TRUE;
+    }
+
+    add_node_to_tree (tree, (parent) ? &parent->iter : NULL, node, &it);
+
+    for (i = 0; i < NB_SNAPSHOT_VISUALS; ++i)
+        if (v[i])
+            set_tree_visual (tree, &it, (DonnaTreeVisual) (1 << i), v[i], NULL);
+
+    es = row->flags & SNAPSHOT_ES_MASK;
+    expand = (row->flags & SNAPSHOT_EXPANDED) != 0;
+    /* a collapsed row with all children loaded: we don't load them until the
+     * row gets expanded, unless they're needed (location/selection) */
+    lvl.defer_children = es == TREE_EXPAND_MAXI && !expand
+        && !(row->flags & SNAPSHOT_PINNED);
+
+    if (es == TREE_EXPAND_PARTIAL && priv->is_minitree)
+        set_es (priv, &it, es);
+    else if (es == TREE_EXPAND_MAXI && !expand && !lvl.defer_children)
+        /* only get the children & load them, no expansion */
+        expand_row (tree, &it, FALSE, FALSE, NULL);
+
+    if (expand || (row->flags & SNAPSHOT_LOCATION))
+    {
+        GtkTreePath *path;
+
+        path = gtk_tree_model_get_path ((GtkTreeModel *) priv->store, &it);
+        if (expand)
+            gtk_tree_view_expand_row ((GtkTreeView *) tree, path, FALSE);
+        if (row->flags & SNAPSHOT_LOCATION)
+            gtk_tree_view_set_focused_row ((GtkTreeView *) tree, path);
+        gtk_tree_path_free (path);
+    }
 
-    return save_to_file (tree, filename, str, error);
+    /* like load_tree_step() only the location gets selected: in
+     * SELECTION_BROWSE selecting a row means going there. Rows flagged
+     * SNAPSHOT_SELECTED are only made sure to be loaded (pinned) */
+    if (row->flags & SNAPSHOT_LOCATION)
+        gtk_tree_selection_select_iter (
+                gtk_tree_view_get_selection ((GtkTreeView *) tree),
+                &it);
+
+    /* takes our ref on node */
+    lvl.node = node;
+    lvl.iter = it;
+    g_array_append_val (ls->stack, lvl);
+
+    return TRUE;
 }
 
 /**
- * donna_tree_view_load_tree_file:
+ * donna_tree_view_load_tree_snapshot:
  * @tree: A #DonnaTreeView
- * @filename: Name of the tree file to load from
- * @visuals: Which #tree-visuals to load from the tree file
+ * @filename: Name of the tree snapshot to load from
+ * @visuals: Which #tree-visuals to load from the snapshot
  * @error: (allow-none): Return location of a #GError, or %NULL
  *
- * Loads the content of @tree from tree file @filename, usually a file
- * previously saved using donna_tree_view_save_tree_file()
+ * Loads the content of @tree from tree snapshot @filename, previously saved
+ * using donna_tree_view_save_tree_snapshot()
  *
  * @filename can be either a full path to a file, or it will be processed
  * through donna_app_get_conf_filename()
  *
- * For more information on the format of the file, see
- * donna_tree_view_save_tree_file()
+ * Much like donna_tree_view_load_tree_file() the tree is cleared and rows are
+ * then added, only progressively (in time slices, from an idle source), i.e.
+ * the loading completes after this function returns. Only the tree visuals
+ * specified in @visuals will be loaded into @tree.
  *
- * Tree files can include #tree-visuals, only those specified in @visuals will
- * be loaded into @tree.
+ * Rows that were collapsed (with their children loaded) will have their
+ * children loaded only when expanded, their tree visuals applied then.
  *
- * Note that this is obviously only supported on trees. For lists, see
- * donna_tree_view_load_list_file()
+ * Note that this is obviously only supported on trees.
  *
- * Returns: %TRUE on success, else %FALSE
+ * Returns: %TRUE if the loading was started, else %FALSE
  */
 gboolean
-donna_tree_view_load_tree_file (DonnaTreeView      *tree,
-                                const gchar        *filename,
-                                DonnaTreeVisual     visuals,
-                                GError            **error)
+donna_tree_view_load_tree_snapshot (DonnaTreeView      *tree,
+                                    const gchar        *filename,
+                                    DonnaTreeVisual     visuals,
+                                    GError            **error)
 {
     DonnaTreeViewPrivate *priv;
-    GtkTreeModel *model;
-    GtkTreeIter *root;
-    GtkTreeIter it;
-    gchar *data;
-    gchar *e;
-    gchar *s;
-    GArray *array;
-    gint last_level = -1;
+    struct load_snapshot *ls;
+    GMappedFile *mf;
+    const gchar *data;
+    gchar *f;
 
     g_return_val_if_fail (DONNA_IS_TREE_VIEW (tree), FALSE);
     g_return_val_if_fail (filename != NULL, FALSE);
     priv = tree->priv;
-    model = (GtkTreeModel *) priv->store;
 
     if (!priv->is_tree)
     {
         g_set_error (error, DONNA_TREE_VIEW_ERROR,
                 DONNA_TREE_VIEW_ERROR_INVALID_MODE,
-                "TreeView '%s': Cannot load tree file in mode List",
+                "TreeView '%s': Cannot load tree snapshot in mode List",
                 priv->name);
         return FALSE;
     }
 
-    if (!load_from_file (tree, filename, &data, error))
+    f = get_file (tree, filename);
+    mf = g_mapped_file_new (f, FALSE, error);
+    if (f != filename)
+        g_free (f);
+    if (!mf)
+    {
+        g_prefix_error (error, "TreeView '%s': Failed to load from file; "
+                "Error reading '%s': ",
+                priv->name, filename);
         return FALSE;
+    }
 
-    e = strchr (data, '\n');
-    if (!e)
+    data = g_mapped_file_get_contents (mf);
+    if (!validate_snapshot (data, g_mapped_file_get_length (mf)))
     {
         g_set_error (error, DONNA_TREE_VIEW_ERROR,
                 DONNA_TREE_VIEW_ERROR_OTHER,
                 "TreeView '%s': Failed to load from file; "
-                "Invalid data in '%s'",
+                "Invalid tree snapshot '%s'",
                 priv->name, filename);
-        g_free (data);
+        g_mapped_file_unref (mf);
         return FALSE;
     }
 
-    /* first off, let's clear the tree. We get the current root iter to make
-     * sure we remove the current branch (if any) last, to avoid having the
-     * location be changed for no reason (which would affect sync_with, and also
-     * therefore (via sync) could lead to the root being re-added. */
-    if (priv->location_iter.stamp != 0)
-        root = get_root_iter (tree, &priv->location_iter);
-    else
-        root = NULL;
-
-    if (gtk_tree_model_iter_children (model, &it, NULL))
-        for (;;)
-        {
-            if (root && itereq (&it, root))
-            {
-                if (!gtk_tree_model_iter_next (model, &it))
-                    break;
-            }
-            else
-            {
-                if (!remove_row_from_tree (tree, &it, RR_NOT_REMOVAL))
-                    break;
-            }
-        }
-    if (root)
-    {
-        it = *root; /* we must own the iter */
-        remove_row_from_tree (tree, &it, RR_NOT_REMOVAL);
-    }
-
-#define load_visual(c_open, c_close, UPPER, var)    \
-    if (*s == c_open)                               \
-    {                                               \
-        gchar *d;                                   \
-        d = s + 1;                                  \
-        s = strchr (d, c_close);                    \
-        if (!s)                                     \
-        {                                           \
-        }                                           \
-        if (visuals & DONNA_TREE_VISUAL_##UPPER)    \
-        {                                           \
-            *s = '\0';                              \
-            var = d;                                \
-        }                                           \
-        if (*++s == ' ')                            \
-            ++s;                                    \
-    }
+    /* since the tree gets cleared, any previous loading (or full expand) still
+     * in progress is now moot */
+    cancel_works (tree);
+    clear_tree (tree);
 
     /* if the tree was fresh, we might need to load an arrangement */
     if (!priv->arrangement)
         donna_tree_view_build_arrangement (tree, FALSE);
 
-    array = g_array_sized_new (FALSE, TRUE, sizeof (GtkTreeIter), 8);
-    /* so we can actually use those directly */
-    g_array_set_size (array, 8);
-
-    s = data;
-    do
-    {
-        GError *err = NULL;
-        GtkTreeIter parent;
-        DonnaNode *node;
-        gint level          = 0;
-        gchar *name         = NULL;
-        gchar *icon         = NULL;
-        gchar *box          = NULL;
-        gchar *highlight    = NULL;
-        gchar *click_mode   = NULL;
-        gboolean is_in_tree;
-        gboolean is_future_location = FALSE;
-        gboolean expand = FALSE;
-        enum tree_expand es = TREE_EXPAND_UNKNOWN;
-
-        *e = '\0';
-
-        /* visuals only? */
-        if (*s == '=')
-        {
-            is_in_tree = FALSE;
-            ++s;
-            if (*s == ' ')
-                ++s;
-        }
-        else
-        {
-            is_in_tree = TRUE;
-            /* get the level */
-            for ( ; *s == '-'; ++s, ++level)
-                ;
-            if (level > 0 && *s == ' ')
-                ++s;
-        }
-
-        /* visuals */
-        load_visual ('"', '"', NAME, name)
-        load_visual ('@', '@', ICON, icon)
-        load_visual ('{', '}', BOX, box)
-        load_visual ('[', ']', HIGHLIGHT, highlight)
-        load_visual ('(', ')', CLICK_MODE, click_mode)
-
-        /* flags */
-        if (*s == '!')
-        {
-            is_future_location = TRUE;
-            ++s;
-        }
-        if (*s == '<')
-        {
-            expand = TRUE;
-            ++s;
-        }
-        if (*s == '+')
-        {
-            es = TREE_EXPAND_PARTIAL;
-            ++s;
-        }
-        else if (*s == '*')
-        {
-            es = TREE_EXPAND_MAXI;
-            ++s;
-        }
-
-        /* last_level was same/deeper down */
-        if (last_level >= level && last_level >= 0)
-        {
-            GtkTreeIter *iter;
-            iter = &g_array_index (array, GtkTreeIter, level);
-            iter->stamp = 0;
-        }
-
-        /* make sure we want to add it */
-        if (is_in_tree && !priv->show_hidden)
-        {
-
-            /* get node */
-            node = donna_app_get_node (priv->app, s, FALSE, &err);
-            if (!node)
-            {
-                g_warning ("TreeView '%s': Failed to get node for '%s': %s",
-                        priv->name, s, (err) ? err->message : "(no error message)");
-                is_in_tree = FALSE;
-            }
-            else
-            {
-                gchar *s_name = donna_node_get_name (node);
-                if (s_name && *s_name == '.')
-                    is_in_tree = FALSE;
-                g_free (s_name);
-            }
-        }
-        else
-            node = NULL;
-
-        if (is_in_tree)
-        {
-            GtkTreeIter *iter;
-
-            if (!node)
-            {
-                node = donna_app_get_node (priv->app, s, FALSE, &err);
-                if (!node)
-                {
-                    g_warning ("TreeView '%s': Failed to get node for '%s': %s",
-                            priv->name, s, (err) ? err->message : "(no error message)");
-                    goto next;
-                }
-            }
-
-            /* get parent iter */
-            if (level > 0)
-            {
-                iter = &g_array_index (array, GtkTreeIter, level - 1);
-                parent = *iter;
-            }
-            else
-            {
-                iter = NULL;
-                parent.stamp = 0;
-            }
-
-            /* add to tree */
-            add_node_to_tree (tree, (parent.stamp != 0) ? &parent : NULL, node, &it);
-
-            /* set up the iter for this level (so we can add children) */
-            if ((guint) level >= array->len)
-                g_array_set_size (array, (guint) level + 2);
-            iter = &g_array_index (array, GtkTreeIter, level);
-            *iter = it;
-            last_level = level;
-
-            /* set visuals */
-            if (name)
-                set_tree_visual (tree, &it,
-                        DONNA_TREE_VISUAL_NAME, name, NULL);
-            if (icon)
-                set_tree_visual (tree, &it,
-                        DONNA_TREE_VISUAL_ICON, icon, NULL);
-            if (box)
-                set_tree_visual (tree, &it,
-                        DONNA_TREE_VISUAL_BOX, box, NULL);
-            if (highlight)
-                set_tree_visual (tree, &it,
-                        DONNA_TREE_VISUAL_HIGHLIGHT, highlight, NULL);
-            if (click_mode)
-                set_tree_visual (tree, &it,
-                        DONNA_TREE_VISUAL_CLICK_MODE, click_mode, NULL);
-
-            if (es == TREE_EXPAND_PARTIAL && priv->is_minitree)
-                set_es (priv, &it, es);
-            else if (es == TREE_EXPAND_MAXI && !expand)
-                /* only get the children & load them, no expansion */
-                expand_row (tree, &it, FALSE, FALSE, NULL);
-
-            if (expand)
-            {
-                GtkTreePath *path;
-
-                path = gtk_tree_model_get_path ((GtkTreeModel*) priv->store, &it);
-                gtk_tree_view_expand_row ((GtkTreeView *) tree, path, FALSE);
-                if (is_future_location)
-                    gtk_tree_view_set_focused_row ((GtkTreeView *) tree, path);
-                gtk_tree_path_free (path);
-            }
-
-            if (is_future_location)
-            {
-                if (!expand)
-                {
-                    GtkTreePath *path;
-
-                    path = gtk_tree_model_get_path ((GtkTreeModel*) priv->store, &it);
-                    gtk_tree_view_set_focused_row ((GtkTreeView *) tree, path);
-                    gtk_tree_path_free (path);
-                }
-                gtk_tree_selection_select_iter (
-                        gtk_tree_view_get_selection ((GtkTreeView *) tree),
-                        &it);
-            }
-        }
-        /* add visuals for non-loaded row */
-        else if (name || icon || box || highlight || click_mode)
-        {
-            GSList *l = NULL;
-            struct visuals *visual;
-
-            /* get current root */
-            if (!gtk_tree_model_iter_nth_child (model, &it, NULL,
-                        gtk_tree_model_iter_n_children (model, NULL)))
-            {
-            }
-
-            visual = g_slice_new0 (struct visuals);
-            visual->root = it;
-            visual->name = g_strdup (name);
-            if (icon)
-            {
-                if (*icon == '/')
-                {
-                    GFile *file;
-
-                    file = g_file_new_for_path (icon);
-                    visual->icon = g_file_icon_new (file);
-                    g_object_unref (file);
-                }
-                else
-                    visual->icon = g_themed_icon_new (icon);
-            }
-            visual->box = g_strdup (box);
-            visual->highlight = g_strdup (highlight);
-            visual->click_mode = g_strdup (click_mode);
-
-            if (priv->tree_visuals)
-                l = g_hash_table_lookup (priv->tree_visuals, s);
-            else
-                priv->tree_visuals = g_hash_table_new_full (
-                        g_str_hash, g_str_equal,
-                        g_free, NULL);
-
-            l = g_slist_prepend (l, visual);
-            g_hash_table_insert (priv->tree_visuals, g_strdup (s), l);
-        }
-
-        donna_g_object_unref (node);
-
-next:
-        s = e + 1;
-    } while ((e = strchr (s, '\n')));
-
-#undef load_visual
-
-    g_array_free (array, TRUE);
-    g_free (data);
-
-    g_info ("TreeView '%s': Loaded from file '%s'", priv->name, filename);
+    ls = g_slice_new0 (struct load_snapshot);
+    ls->filename    = g_strdup (filename);
+    ls->mf          = mf;
+    ls->rows        = (const struct snapshot_row *)
+        (data + sizeof (struct snapshot_header));
+    ls->nb_rows     = ((const struct snapshot_header *) data)->nb_rows;
+    ls->strings     = data + sizeof (struct snapshot_header)
+        + (gsize) ls->nb_rows * sizeof (struct snapshot_row);
+    ls->visuals     = visuals;
+    ls->stack       = g_array_sized_new (FALSE, FALSE,
+            sizeof (struct snapshot_level), 8);
+
+    queue_work (tree, "Loading tree snapshot", (work_step_fn) load_snapshot_step,
+            ls, (GDestroyNotify) free_load_snapshot);
 
     return TRUE;
 }
@@ -16326,7 +18351,8 @@ may_get_children_refresh (DonnaTreeView *tree, GtkTreeIter *iter)
  * %DONNA_TREE_VIEW_REFRESH_VISIBLE and %DONNA_TREE_VIEW_REFRESH_SIMPLE will
  * both simply ask each node to refrsh all its properties, but the former will
  * only do so on visible nodes while the later will do it on all nodes in the
- * treeview.
+ * treeview. Cached values (of custom properties) are ignored, see
+ * %DONNA_NODE_REFRESH_BYPASS_CACHE
  *
  * %DONNA_TREE_VIEW_REFRESH_NORMAL will perform the "standard" refresh
  * operation, which also includes refreshing the list of children. For trees,
@@ -16456,6 +18482,9 @@ donna_tree_view_refresh (DonnaTreeView          *tree,
             for (i = 0; i < tasks->len; ++i)
             {
                 DonnaTask *task = tasks->pdata[i];
+                /* user asked for a refresh, so get actual values */
+                g_object_set_data ((GObject *) task,
+                        DONNA_NODE_REFRESH_BYPASS_CACHE, GINT_TO_POINTER (TRUE));
                 donna_task_set_callback (task,
                         (task_callback_fn) refresh_node_cb, data, NULL);
                 donna_app_run_task (priv->app, task);
@@ -17186,15 +19215,13 @@ donna_tree_view_reset_keys (DonnaTreeView *tree)
     check_statuses (tree, STATUS_CHANGED_ON_KEYS | STATUS_CHANGED_ON_KEY_MODE);
 }
 
-/* mode list only */
 /**
  * donna_tree_view_abort:
  * @tree: A #DonnaTreeView
  *
  * Abort any running task changing @tree's current location as well as task to
- * refresh properties (from columns preloading properties)
- *
- * Note that this obviously only works on lists (i.e. is a no-op on trees).
+ * refresh properties (from columns preloading properties), and any long
+ * operation still being processed (e.g. full expand on trees)
  */
 void
 donna_tree_view_abort (DonnaTreeView *tree)
@@ -17210,6 +19237,7 @@ donna_tree_view_abort (DonnaTreeView *tree)
         donna_task_cancel (task);
         g_object_set_data ((GObject *) tree, DATA_PRELOAD_TASK, NULL);
     }
+    cancel_works (tree);
 }
 
 /**
@@ -21413,7 +23441,7 @@ query_tooltip_cb (GtkTreeView   *treev,
                 struct active_spinners *as;
                 guint i;
 
-                as = get_as_for_node (tree, node, NULL, FALSE);
+                as = get_as_for_node (tree, node, FALSE);
                 if (!as)
                 {
                     /* no as and a visible renderer == RP_ON_DEMAND */
@@ -22131,7 +24159,6 @@ trigger_click (DonnaTreeView *tree, DonnaClick click, GdkEventButton *event)
         {
             DonnaNode *node;
             struct active_spinners *as = NULL;
-            guint as_idx;
             guint i;
 
             gtk_tree_model_get (model, &iter,
@@ -22153,7 +24180,7 @@ trigger_click (DonnaTreeView *tree, DonnaClick click, GdkEventButton *event)
             }
             else if (renderer == int_renderers[INTERNAL_RENDERER_PIXBUF])
 #endif
-                as = get_as_for_node (tree, node, &as_idx, FALSE);
+                as = get_as_for_node (tree, node, FALSE);
 
             if (!as)
             {
@@ -22212,8 +24239,7 @@ trigger_click (DonnaTreeView *tree, DonnaClick click, GdkEventButton *event)
                         {
                             /* can we remove the whole as? */
                             if (as->as_cols->len == 1)
-                                g_ptr_array_remove_index_fast (priv->active_spinners,
-                                        as_idx);
+                                g_hash_table_remove (priv->active_spinners, node);
                             else
                                 g_array_remove_index_fast (as->as_cols, i);
 
@@ -23136,6 +25162,7 @@ selection_changed_cb (GtkTreeSelection *selection, DonnaTreeView *tree)
      * little slow (when there was lots of items).
      * It is also set from selection_nodes() since on each (un)select_iter()
      * call there's a signal emitted, which slows things down a bit. */
+    priv->agg_sel_valid = FALSE;
     if (!priv->filling_list)
         check_statuses (tree, STATUS_CHANGED_ON_CONTENT);
     if (!priv->is_tree)
@@ -23361,6 +25388,12 @@ donna_tree_view_draw (GtkWidget *w, cairo_t *cr)
     /* chain up, so the drawing actually gets done */
     GTK_WIDGET_CLASS (donna_tree_view_parent_class)->draw (w, cr);
 
+    /* a redraw is how we know the visible range might have changed (e.g.
+     * scrolling), so the preloading can focus on it */
+    if (!priv->is_tree
+            && g_object_get_data ((GObject *) tree, DATA_PRELOAD_TASK))
+        update_preload_range (tree);
+
     if (priv->is_tree || priv->draw_state == DRAW_NOTHING)
         return FALSE;
 
@@ -23495,6 +25528,7 @@ status_provider_create_status (DonnaStatusProvider    *sp,
     status.name = g_strdup (name);
     status.fmt  = s;
     status.changed_on = 0;
+    status.uses_sizes = FALSE;
 
     if (!donna_config_get_int (config, NULL, &status.digits,
                 "statusbar/%s/digits", name))
@@ -23533,17 +25567,19 @@ status_provider_create_status (DonnaStatusProvider    *sp,
                 status.changed_on |= STATUS_CHANGED_ON_VF;
                 break;
 
+            case 'H':
+            case 'V':
+            case 'A':
+                status.uses_sizes = TRUE;
+                /* fall through */
             case 'l':
             case 'L':
             case 'f':
             case 's':
             case 'S':
             case 'h':
-            case 'H':
             case 'v':
-            case 'V':
             case 'a':
-            case 'A':
             case 'n':
             case 'N':
                 status.changed_on |= STATUS_CHANGED_ON_CONTENT;
@@ -23552,6 +25588,8 @@ status_provider_create_status (DonnaStatusProvider    *sp,
         s += 2;
     }
 
+    if (status.uses_sizes)
+        agg_set_uses_sizes (priv, TRUE);
     g_array_append_val (priv->statuses, status);
     return status.id;
 }
@@ -23569,6 +25607,8 @@ status_provider_free_status (DonnaStatusProvider    *sp,
 
         if (status->id == id)
         {
+            if (status->uses_sizes)
+                agg_set_uses_sizes (priv, FALSE);
             g_array_remove_index_fast (priv->statuses, i);
             break;
         }
@@ -23624,24 +25664,51 @@ calculate_size (DonnaNode *node, gpointer value, struct calc_size *cs)
 }
 
 static gboolean
-calculate_size_selected (GtkTreeModel    *model,
-                         GtkTreePath     *path,
-                         GtkTreeIter     *iter,
-                         guint64         *total)
+calculate_size_selected (GtkTreeModel           *model,
+                         GtkTreePath            *path,
+                         GtkTreeIter            *iter,
+                         DonnaTreeViewPrivate   *priv)
 {
     DonnaNode *node;
     guint64 size;
 
+    ++priv->agg_nb_selected;
     gtk_tree_model_get (model, iter, TREE_VIEW_COL_NODE, &node, -1);
     if (!node)
         return FALSE;
     if (donna_node_get_node_type (node) == DONNA_NODE_ITEM
             && donna_node_get_size (node, TRUE, &size) == DONNA_NODE_VALUE_SET)
-        *total += size;
+        priv->agg_size_selected += size;
     g_object_unref (node);
     return FALSE; /* keep iterating */
 }
 
+/* selection aggregates are computed (in one go) when needed, and then remain
+ * valid until the selection changes, or the size of a node does */
+static void
+ensure_selection_aggregates (DonnaTreeView *tree, GtkTreeSelection *sel)
+{
+    DonnaTreeViewPrivate *priv = tree->priv;
+
+    if (priv->agg_sel_valid)
+        return;
+
+    priv->agg_nb_selected = 0;
+    priv->agg_size_selected = 0;
+    gtk_tree_selection_selected_foreach (sel,
+            (GtkTreeSelectionForeachFunc) calculate_size_selected, priv);
+    priv->agg_sel_valid = TRUE;
+}
+
+/* mode list uses the running aggregate, mode tree needs to count rows */
+static inline gint
+get_nb_visible (DonnaTreeViewPrivate *priv)
+{
+    if (priv->is_tree)
+        return _gtk_tree_model_get_count ((GtkTreeModel *) priv->store);
+    return (gint) priv->agg_nb_visible;
+}
+
 struct sp_conv
 {
     DonnaTreeView *tree;
@@ -23713,7 +25780,7 @@ sp_custom_conv (const gchar          c,
              * specified), with 'a' it is when everything is visible that we
              * don't. Allows to do "2 items" and "2/3 items" easily */
             if (sp_conv->nb_v == -1)
-                sp_conv->nb_v = _gtk_tree_model_get_count ((GtkTreeModel *) priv->store);
+                sp_conv->nb_v = get_nb_visible (priv);
             ref = sp_conv->nb_v;
         }
         else if (c == 'v')
@@ -23800,24 +25867,33 @@ sp_custom_conv (const gchar          c,
     switch (c)
     {
         case 'A':
-            g_hash_table_foreach (priv->hashtable, (GHFunc) calculate_size, &cs);
+            if (priv->is_tree)
+                g_hash_table_foreach (priv->hashtable, (GHFunc) calculate_size, &cs);
+            else
+                cs.size = priv->agg_size_visible + priv->agg_size_hidden;
             break;
 
         case 'V':
             cs.cs = CS_VISIBLE;
-            g_hash_table_foreach (priv->hashtable, (GHFunc) calculate_size, &cs);
+            if (priv->is_tree)
+                g_hash_table_foreach (priv->hashtable, (GHFunc) calculate_size, &cs);
+            else
+                cs.size = priv->agg_size_visible;
             break;
 
         case 'H':
             cs.cs = CS_HIDDEN;
-            g_hash_table_foreach (priv->hashtable, (GHFunc) calculate_size, &cs);
+            if (priv->is_tree)
+                g_hash_table_foreach (priv->hashtable, (GHFunc) calculate_size, &cs);
+            else
+                cs.size = priv->agg_size_hidden;
             break;
 
         case 'S':
             if (!sp_conv->sel)
                 sp_conv->sel = gtk_tree_view_get_selection ((GtkTreeView *) sp_conv->tree);
-            gtk_tree_selection_selected_foreach (sp_conv->sel,
-                    (GtkTreeSelectionForeachFunc) calculate_size_selected, &cs.size);
+            ensure_selection_aggregates (sp_conv->tree, sp_conv->sel);
+            cs.size = priv->agg_size_selected;
             break;
     }
 
@@ -23947,7 +26023,7 @@ status_provider_conv (const gchar     c,
         case 'v':
             *type = DONNA_ARG_TYPE_INT;
             if (sp_conv->nb_v == -1)
-                sp_conv->nb_v = _gtk_tree_model_get_count ((GtkTreeModel *) priv->store);
+                sp_conv->nb_v = get_nb_visible (priv);
             if (extra)
             {
                 *type = _DONNA_ARG_TYPE_CUSTOM;
@@ -23965,7 +26041,7 @@ status_provider_conv (const gchar     c,
             if (sp_conv->nb_a == -1)
                 sp_conv->nb_a = (gint) g_hash_table_size (priv->hashtable);
             if (sp_conv->nb_v == -1)
-                sp_conv->nb_v = _gtk_tree_model_get_count ((GtkTreeModel *) priv->store);
+                sp_conv->nb_v = get_nb_visible (priv);
             if (sp_conv->nb_h == -1)
                 sp_conv->nb_h = sp_conv->nb_a - sp_conv->nb_v;
             if (extra)
@@ -23984,7 +26060,10 @@ status_provider_conv (const gchar     c,
             if (!sp_conv->sel)
                 sp_conv->sel = gtk_tree_view_get_selection ((GtkTreeView *) sp_conv->tree);
             if (sp_conv->nb_s == -1)
-                sp_conv->nb_s = gtk_tree_selection_count_selected_rows (sp_conv->sel);
+            {
+                ensure_selection_aggregates (sp_conv->tree, sp_conv->sel);
+                sp_conv->nb_s = priv->agg_nb_selected;
+            }
             if (extra)
             {
                 *type = _DONNA_ARG_TYPE_CUSTOM;
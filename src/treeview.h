@@ -345,6 +345,16 @@ gboolean        donna_tree_view_load_tree_file  (DonnaTreeView      *tree,
                                                  const gchar        *filename,
                                                  DonnaTreeVisual     visuals,
                                                  GError            **error);
+gboolean        donna_tree_view_save_tree_snapshot (
+                                                 DonnaTreeView      *tree,
+                                                 const gchar        *filename,
+                                                 DonnaTreeVisual     visuals,
+                                                 GError            **error);
+gboolean        donna_tree_view_load_tree_snapshot (
+                                                 DonnaTreeView      *tree,
+                                                 const gchar        *filename,
+                                                 DonnaTreeVisual     visuals,
+                                                 GError            **error);
 gboolean        donna_tree_view_add_root        (DonnaTreeView      *tree,
                                                  DonnaNode          *node,
                                                  GError            **error);
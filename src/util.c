@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <time.h>
 #include "util.h"
 
 gsize
@@ -154,9 +155,12 @@ get_nb_from_dates (GDateTime **d1,
 }
 
 gchar *
-donna_print_time (guint64 ts, const gchar *fmt, DonnaTimeOptions *options)
+donna_print_time_full (guint64           ts,
+                       const gchar      *fmt,
+                       DonnaTimeOptions *options,
+                       GDateTime        *_now)
 {
-    GDateTime *now = NULL;
+    GDateTime *now = (_now) ? g_date_time_ref (_now) : NULL;
     GDateTime *dt;
     gchar *ret;
     const gchar *f = fmt;
@@ -475,6 +479,444 @@ age_done:
     return ret;
 }
 
+gchar *
+donna_print_time (guint64 ts, const gchar *fmt, DonnaTimeOptions *options)
+{
+    return donna_print_time_full (ts, fmt, options, NULL);
+}
+
+/* compiled time formats
+ *
+ * A DonnaTimeFormat is a format string as used by donna_print_time() split
+ * into segments once, so rendering doesn't have to scan it again. Segments are
+ * either plain strftime() formats, or the fluid format (%f), whose variants are
+ * also pre-built. Formats that can't be handled by strftime() (%o/%O, glib-only
+ * specifiers, or non-UTF8 locale) are flagged to go through
+ * donna_print_time_full() instead.
+ *
+ * A DonnaTimeCache holds local time breakdowns of midnight for recently used
+ * days, so getting the struct tm for a timestamp is usually just a bucket
+ * lookup (no timezone lookup), and a snapshot of "now" that remains the same
+ * until donna_time_cache_reset_now() is called, e.g. once per frame.
+ */
+
+#define TIME_CACHE_BUCKETS      64  /* must be a power of 2 */
+#define SECONDS_PER_DAY         (24 * 3600)
+
+enum seg_type
+{
+    SEG_STRFTIME = 0,
+    SEG_FLUID
+};
+
+struct seg
+{
+    enum seg_type    type;
+    gchar           *fmt;
+};
+
+struct _DonnaTimeFormat
+{
+    gchar           *fmt;
+    /* must go through donna_print_time_full() */
+    gboolean         use_glib;
+    guint            nb_segs;
+    struct seg      *segs;
+    /* formats for %f */
+    gchar           *fluid_today;
+    gchar           *fluid_yesterday;
+    gchar           *fluid_weekday;
+    gchar           *fluid_date;
+};
+
+struct day_bucket
+{
+    /* timestamp of midnight (local) */
+    gint64           start;
+    /* timestamp of next midnight, or start if not cacheable (DST change) */
+    gint64           end;
+    /* number of (local) days since epoch */
+    gint64           day;
+    /* local breakdown of midnight */
+    struct tm        tm;
+};
+
+struct _DonnaTimeCache
+{
+    /* last seen UTC offset, used to pick buckets */
+    glong            gmtoff;
+    struct day_bucket buckets[TIME_CACHE_BUCKETS];
+    gboolean         has_now;
+    gint64           now_day;
+    gint             now_year;
+    GDateTime       *now;
+};
+
+static inline gint64
+day_from_local_ts (gint64 ts)
+{
+    if (ts >= 0)
+        return ts / SECONDS_PER_DAY;
+    return -((-ts + SECONDS_PER_DAY - 1) / SECONDS_PER_DAY);
+}
+
+/* whether fmt only uses specifiers that strftime() will handle the same way
+ * g_date_time_format() does */
+static gboolean
+is_strftime_compatible (const gchar *fmt)
+{
+    const gchar *s;
+
+    if (!g_utf8_validate (fmt, -1, NULL))
+        return FALSE;
+
+    for (s = strchr (fmt, '%'); s; s = strchr (s, '%'))
+    {
+        ++s;
+        /* flags & modifiers */
+        while (*s == '-' || *s == '_' || *s == '0' || *s == 'E' || *s == 'O')
+            ++s;
+        /* glib only: %:z & co */
+        if (*s == ':' || *s == '\0')
+            return FALSE;
+        ++s;
+    }
+    return TRUE;
+}
+
+DonnaTimeFormat *
+donna_time_format_new (const gchar *fmt, DonnaTimeOptions *options)
+{
+    DonnaTimeFormat *tf;
+    GArray *segs;
+    GString *str;
+    const gchar *time_fmt;
+    const gchar *date_fmt;
+    const gchar *s;
+
+    g_return_val_if_fail (fmt != NULL, NULL);
+
+    tf = g_slice_new0 (DonnaTimeFormat);
+    tf->fmt = g_strdup (fmt);
+
+    time_fmt = (options && options->fluid_time_format)
+        ? options->fluid_time_format : "%X";
+    date_fmt = (options && options->fluid_date_format)
+        ? options->fluid_date_format : "%x";
+
+    if (!g_get_charset (NULL) || !is_strftime_compatible (fmt)
+            || !is_strftime_compatible (time_fmt)
+            || !is_strftime_compatible (date_fmt))
+    {
+        tf->use_glib = TRUE;
+        return tf;
+    }
+
+    segs = g_array_new (FALSE, FALSE, sizeof (struct seg));
+    str = g_string_new (NULL);
+    for (s = fmt; *s != '\0'; ++s)
+    {
+        if (*s != '%')
+        {
+            g_string_append_c (str, *s);
+            continue;
+        }
+
+        if (s[1] == 'o' || s[1] == 'O')
+        {
+            /* age: not worth doing here, go the full way */
+            tf->use_glib = TRUE;
+            break;
+        }
+        else if (s[1] == 'f')
+        {
+            struct seg seg = { SEG_FLUID, NULL };
+
+            if (str->len > 0)
+            {
+                struct seg seg_str = { SEG_STRFTIME, g_strdup (str->str) };
+
+                g_array_append_val (segs, seg_str);
+                g_string_truncate (str, 0);
+            }
+            g_array_append_val (segs, seg);
+            ++s;
+        }
+        else if (s[1] == '%')
+        {
+            g_string_append (str, "%%");
+            ++s;
+        }
+        else
+            g_string_append_c (str, *s);
+    }
+
+    if (tf->use_glib)
+    {
+        guint i;
+
+        for (i = 0; i < segs->len; ++i)
+            g_free (g_array_index (segs, struct seg, i).fmt);
+        g_array_free (segs, TRUE);
+        g_string_free (str, TRUE);
+        return tf;
+    }
+
+    if (str->len > 0)
+    {
+        struct seg seg_str = { SEG_STRFTIME, g_strdup (str->str) };
+
+        g_array_append_val (segs, seg_str);
+    }
+    g_string_free (str, TRUE);
+
+    tf->nb_segs = segs->len;
+    tf->segs = (struct seg *) g_array_free (segs, FALSE);
+
+    tf->fluid_today     = g_strdup (time_fmt);
+    tf->fluid_yesterday = g_strconcat ("Yesterday ", time_fmt, NULL);
+    tf->fluid_weekday   = g_strconcat (
+            (options && options->fluid_short_weekday) ? "%a " : "%A ",
+            time_fmt, NULL);
+    tf->fluid_date      = g_strdup (date_fmt);
+
+    return tf;
+}
+
+void
+donna_time_format_free (DonnaTimeFormat *tf)
+{
+    guint i;
+
+    if (!tf)
+        return;
+
+    for (i = 0; i < tf->nb_segs; ++i)
+        g_free (tf->segs[i].fmt);
+    g_free (tf->segs);
+    g_free (tf->fmt);
+    g_free (tf->fluid_today);
+    g_free (tf->fluid_yesterday);
+    g_free (tf->fluid_weekday);
+    g_free (tf->fluid_date);
+    g_slice_free (DonnaTimeFormat, tf);
+}
+
+DonnaTimeCache *
+donna_time_cache_new (void)
+{
+    /* so localtime_r() uses the current timezone */
+    tzset ();
+    return g_new0 (DonnaTimeCache, 1);
+}
+
+void
+donna_time_cache_reset_now (DonnaTimeCache *cache)
+{
+    g_return_if_fail (cache != NULL);
+
+    cache->has_now = FALSE;
+    if (cache->now)
+    {
+        g_date_time_unref (cache->now);
+        cache->now = NULL;
+    }
+}
+
+/**
+ * donna_time_cache_get_now:
+ * @cache: A #DonnaTimeCache
+ *
+ * Returns the snapshot of "now" from @cache, creating it if needed. It remains
+ * the same until donna_time_cache_reset_now() is called.
+ *
+ * Returns: (transfer none): The #GDateTime for "now"
+ */
+GDateTime *
+donna_time_cache_get_now (DonnaTimeCache *cache)
+{
+    g_return_val_if_fail (cache != NULL, NULL);
+
+    if (!cache->now)
+        cache->now = g_date_time_new_now_local ();
+    return cache->now;
+}
+
+void
+donna_time_cache_free (DonnaTimeCache *cache)
+{
+    if (!cache)
+        return;
+
+    donna_time_cache_reset_now (cache);
+    g_free (cache);
+}
+
+static gboolean
+time_cache_get_tm (DonnaTimeCache    *cache,
+                   gint64             ts,
+                   struct tm         *tm,
+                   gint64            *day)
+{
+    struct day_bucket *b;
+    struct tm tm_end;
+    time_t t;
+    gint64 secs;
+
+    b = &cache->buckets[(guint64) day_from_local_ts (ts + cache->gmtoff)
+        & (TIME_CACHE_BUCKETS - 1)];
+    if (b->start <= ts && ts < b->end)
+        goto hit;
+
+    t = (time_t) ts;
+    if (!localtime_r (&t, tm))
+        return FALSE;
+    cache->gmtoff = tm->tm_gmtoff;
+    *day = day_from_local_ts (ts + tm->tm_gmtoff);
+
+    b = &cache->buckets[(guint64) *day & (TIME_CACHE_BUCKETS - 1)];
+    b->start = ts - (tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec);
+    b->end   = b->start;
+    b->day   = *day;
+
+    /* only cache the day if there's no UTC offset change during it */
+    t = (time_t) b->start;
+    if (!localtime_r (&t, &b->tm) || b->tm.tm_gmtoff != tm->tm_gmtoff)
+        return TRUE;
+    t = (time_t) (b->start + SECONDS_PER_DAY - 1);
+    if (!localtime_r (&t, &tm_end) || tm_end.tm_gmtoff != tm->tm_gmtoff)
+        return TRUE;
+    b->end = b->start + SECONDS_PER_DAY;
+
+hit:
+    secs = ts - b->start;
+    *tm = b->tm;
+    tm->tm_hour = (gint) (secs / 3600);
+    tm->tm_min  = (gint) ((secs / 60) % 60);
+    tm->tm_sec  = (gint) (secs % 60);
+    *day = b->day;
+    return TRUE;
+}
+
+static inline void
+time_cache_ensure_now (DonnaTimeCache *cache)
+{
+    struct tm tm;
+
+    if (cache->has_now)
+        return;
+
+    if (time_cache_get_tm (cache, (gint64) time (NULL), &tm, &cache->now_day))
+        cache->now_year = tm.tm_year + 1900;
+    else
+    {
+        cache->now_day = 0;
+        cache->now_year = 1970;
+    }
+    cache->has_now = TRUE;
+}
+
+static inline const gchar *
+get_fluid_format (DonnaTimeFormat   *tf,
+                  DonnaTimeCache    *cache,
+                  struct tm         *tm,
+                  gint64             day)
+{
+    gint year = tm->tm_year + 1900;
+
+    time_cache_ensure_now (cache);
+
+    if (day == cache->now_day)
+        return tf->fluid_today;
+    else if (year > cache->now_year || year < cache->now_year - 1)
+        return tf->fluid_date;
+    else if (day == cache->now_day - 1)
+        return tf->fluid_yesterday;
+    else if (day > cache->now_day - 7)
+        return tf->fluid_weekday;
+    else
+        return tf->fluid_date;
+}
+
+/**
+ * donna_time_format_print:
+ * @tf: A compiled format, from donna_time_format_new()
+ * @cache: A #DonnaTimeCache
+ * @ts: The timestamp to print
+ * @options: The #DonnaTimeOptions @tf was compiled with
+ * @str: Buffer to write into
+ * @max: Size of @str
+ *
+ * Prints @ts using the format @tf into @str, same as donna_print_time() would
+ * but without allocations nor timezone lookups for the common case.
+ *
+ * If the returned value is @max or more, @str was too small and its content
+ * should not be used.
+ *
+ * Returns: Length of the printed string (not including NUL)
+ */
+gsize
+donna_time_format_print (DonnaTimeFormat    *tf,
+                         DonnaTimeCache     *cache,
+                         guint64             ts,
+                         DonnaTimeOptions   *options,
+                         gchar              *str,
+                         gsize               max)
+{
+    struct tm tm;
+    gint64 day;
+    gsize total = 0;
+    guint i;
+
+    g_return_val_if_fail (tf != NULL, max);
+    g_return_val_if_fail (cache != NULL, max);
+
+    if (tf->use_glib || !time_cache_get_tm (cache, (gint64) ts, &tm, &day))
+    {
+        gchar *s;
+
+        s = donna_print_time_full (ts, tf->fmt, options,
+                donna_time_cache_get_now (cache));
+        if (!s)
+            total = 0;
+        else
+            total = strlen (s);
+        if (total < max)
+        {
+            if (s)
+                memcpy (str, s, total + 1);
+            else
+                *str = '\0';
+        }
+        g_free (s);
+        return total;
+    }
+
+    if (max > 0)
+        *str = '\0';
+    for (i = 0; i < tf->nb_segs; ++i)
+    {
+        const gchar *fmt;
+        gsize len;
+
+        if (tf->segs[i].type == SEG_FLUID)
+            fmt = get_fluid_format (tf, cache, &tm, day);
+        else
+            fmt = tf->segs[i].fmt;
+
+        if (total >= max)
+            return max;
+        len = strftime (str + total, max - total, fmt, &tm);
+        /* strftime() gives no way to tell an empty result from one that didn't
+         * fit; assume the later, caller will then go the slow way */
+        if (len == 0 && *fmt != '\0')
+            return max;
+        total += len;
+    }
+
+    return total;
+}
+
 GValue *
 duplicate_gvalue (const GValue *src)
 {
@@ -37,6 +37,9 @@ typedef struct
     gboolean     fluid_short_weekday;
 } DonnaTimeOptions;
 
+typedef struct _DonnaTimeFormat     DonnaTimeFormat;
+typedef struct _DonnaTimeCache      DonnaTimeCache;
+
 gsize           donna_print_size                (gchar              *str,
                                                  gsize               max,
                                                  const gchar        *fmt,
@@ -46,6 +49,23 @@ gsize           donna_print_size                (gchar              *str,
 gchar *         donna_print_time                (guint64             ts,
                                                  const gchar        *fmt,
                                                  DonnaTimeOptions   *options);
+gchar *         donna_print_time_full           (guint64             ts,
+                                                 const gchar        *fmt,
+                                                 DonnaTimeOptions   *options,
+                                                 GDateTime          *now);
+DonnaTimeFormat * donna_time_format_new         (const gchar        *fmt,
+                                                 DonnaTimeOptions   *options);
+void            donna_time_format_free          (DonnaTimeFormat    *tf);
+gsize           donna_time_format_print         (DonnaTimeFormat    *tf,
+                                                 DonnaTimeCache     *cache,
+                                                 guint64             ts,
+                                                 DonnaTimeOptions   *options,
+                                                 gchar              *str,
+                                                 gsize               max);
+DonnaTimeCache * donna_time_cache_new           (void);
+void            donna_time_cache_reset_now      (DonnaTimeCache     *cache);
+GDateTime *     donna_time_cache_get_now        (DonnaTimeCache     *cache);
+void            donna_time_cache_free           (DonnaTimeCache     *cache);
 GValue *        duplicate_gvalue                (const GValue       *src);
 gboolean        donna_g_ptr_array_contains      (GPtrArray          *arr,
                                                  gpointer            value,